@@ -1,13 +1,19 @@
 #include <benchmark/benchmark.h>
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <random>
+#include <ratio>
 #include <vector>
 
+#include "prometheus/duration_histogram.h"
 #include "prometheus/family.h"
+#include "prometheus/hdr_histogram.h"
 #include "prometheus/histogram.h"
 #include "prometheus/registry.h"
+#include "prometheus/static_histogram.h"
 
 using prometheus::Histogram;
 
@@ -68,3 +74,236 @@ static void BM_Histogram_Collect(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_Histogram_Collect)->Range(0, 4096);
+
+enum class Layout { Linear, Exponential, Irregular };
+
+static Histogram::BucketBoundaries CreateBuckets(Layout layout,
+                                                 std::size_t count) {
+  switch (layout) {
+    case Layout::Linear:
+      return prometheus::LinearBuckets(0, 1, count);
+    case Layout::Exponential:
+      return prometheus::ExponentialBuckets(1, 1.01, count);
+    case Layout::Irregular:
+      break;
+  }
+  // exponential with jitter, defeats the layout detection
+  auto bucket_boundaries = prometheus::ExponentialBuckets(1, 1.01, count);
+  for (std::size_t i = 1; i < count; i += 2) {
+    bucket_boundaries[i] =
+        (bucket_boundaries[i - 1] + bucket_boundaries[i]) / 2;
+  }
+  return bucket_boundaries;
+}
+
+static void BM_Histogram_Observe_Layout(benchmark::State& state) {
+  const auto layout = static_cast<Layout>(state.range(0));
+  const auto number_of_buckets = static_cast<std::size_t>(state.range(1));
+
+  const auto bucket_boundaries = CreateBuckets(layout, number_of_buckets);
+  Histogram histogram{bucket_boundaries};
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<> d(bucket_boundaries.front(),
+                                     bucket_boundaries.back());
+  std::vector<double> observations(4096);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram.Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_Histogram_Observe_Layout)
+    ->ArgNames({"layout", "buckets"})
+    ->ArgsProduct({{static_cast<int>(Layout::Linear),
+                    static_cast<int>(Layout::Exponential),
+                    static_cast<int>(Layout::Irregular)},
+                   {16, 256, 4096}});
+
+static void BM_Histogram_Observe_Batch(benchmark::State& state) {
+  const auto batch_size = static_cast<std::size_t>(state.range(0));
+  const auto per_sample = state.range(1) != 0;
+
+  Histogram histogram{prometheus::ExponentialBuckets(1, 2, 20)};
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(5, 2);
+  std::vector<double> observations(batch_size);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  while (state.KeepRunning()) {
+    if (per_sample) {
+      for (auto observation : observations) {
+        histogram.Observe(observation);
+      }
+    } else {
+      histogram.ObserveBatch(observations.data(), observations.size());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_Histogram_Observe_Batch)
+    ->ArgNames({"batch", "per_sample"})
+    ->ArgsProduct({{16, 1024, 10000}, {0, 1}});
+
+static void BM_StaticHistogram_Observe(benchmark::State& state) {
+  using Buckets = prometheus::StaticHistogram<
+      std::ratio<5, 1000>, std::ratio<1, 100>, std::ratio<25, 1000>,
+      std::ratio<5, 100>, std::ratio<1, 10>, std::ratio<25, 100>,
+      std::ratio<5, 10>, std::ratio<1>, std::ratio<25, 10>, std::ratio<5>,
+      std::ratio<10>>;
+
+  Buckets histogram;
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(-2, 2);
+  std::vector<double> observations(4096);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram.Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_StaticHistogram_Observe);
+
+static void BM_Histogram_Observe_DefaultBuckets(benchmark::State& state) {
+  Histogram histogram{
+      {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10}};
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(-2, 2);
+  std::vector<double> observations(4096);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram.Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_Histogram_Observe_DefaultBuckets);
+
+static void BM_DurationHistogram_Observe(benchmark::State& state) {
+  using std::chrono::milliseconds;
+  prometheus::DurationHistogram histogram{
+      {milliseconds{5}, milliseconds{10}, milliseconds{25}, milliseconds{50},
+       milliseconds{100}, milliseconds{250}, milliseconds{500},
+       milliseconds{1000}, milliseconds{2500}, milliseconds{5000},
+       milliseconds{10000}}};
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(-2, 2);
+  std::vector<std::chrono::nanoseconds> observations(4096);
+  for (auto& observation : observations) {
+    observation = std::chrono::nanoseconds{
+        static_cast<std::chrono::nanoseconds::rep>(d(gen) * 1e9)};
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram.Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_DurationHistogram_Observe)->ThreadRange(1, 8);
+
+static void BM_HdrHistogram_Observe(benchmark::State& state) {
+  const auto significant_digits = static_cast<int>(state.range(0));
+  prometheus::HdrHistogram histogram{1e-6, 3600, significant_digits,
+                                     {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                      1, 2.5, 5, 10}};
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(-2, 2);
+  std::vector<double> observations(4096);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram.Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_HdrHistogram_Observe)->DenseRange(1, 5);
+
+static void BM_HdrHistogram_Collect(benchmark::State& state) {
+  const auto significant_digits = static_cast<int>(state.range(0));
+  prometheus::HdrHistogram histogram{1e-6, 3600, significant_digits,
+                                     {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                      1, 2.5, 5, 10}};
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<> d(-2, 2);
+  for (int i = 0; i < 4096; ++i) {
+    histogram.Observe(d(gen));
+  }
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(histogram.Collect());
+  }
+}
+BENCHMARK(BM_HdrHistogram_Collect)->DenseRange(1, 5);
+
+// Ingest records of "value seen count times", either as count single
+// observations (second argument 0) or as one weighted observation (1).
+static void BM_Histogram_Observe_PreAggregated(benchmark::State& state) {
+  const auto count = static_cast<std::uint64_t>(state.range(0));
+  const auto weighted = state.range(1) != 0;
+
+  Histogram histogram{prometheus::ExponentialBuckets(1, 2, 12)};
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> d(0, 4096);
+
+  while (state.KeepRunning()) {
+    const auto value = static_cast<double>(d(gen));
+    if (weighted) {
+      histogram.Observe(value, count);
+    } else {
+      for (std::uint64_t i = 0; i < count; ++i) {
+        histogram.Observe(value);
+      }
+    }
+  }
+}
+BENCHMARK(BM_Histogram_Observe_PreAggregated)
+    ->ArgsProduct({{1, 16, 256}, {0, 1}});
+
+// Latencies clustered in a few adjacent buckets, observed by all threads into
+// a single histogram. Argument 0 serializes on the mutex, 1 stripes the
+// buckets over one shard per hardware thread.
+static void BM_Histogram_Observe_Contended(benchmark::State& state) {
+  static std::unique_ptr<Histogram> histogram;
+  if (state.thread_index() == 0) {
+    const auto buckets = prometheus::ExponentialBuckets(0.001, 2, 12);
+    histogram = state.range(0) == 0
+                    ? std::unique_ptr<Histogram>(new Histogram{buckets})
+                    : std::unique_ptr<Histogram>(new Histogram{buckets, 0});
+  }
+
+  std::mt19937 gen(
+      static_cast<std::mt19937::result_type>(state.thread_index()));
+  std::uniform_real_distribution<> d(0.03, 0.1);
+  std::vector<double> observations(1024);
+  for (auto& observation : observations) {
+    observation = d(gen);
+  }
+
+  std::size_t i = 0;
+  while (state.KeepRunning()) {
+    histogram->Observe(observations[i++ % observations.size()]);
+  }
+}
+BENCHMARK(BM_Histogram_Observe_Contended)
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
@@ -0,0 +1,161 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/summary.h"
+
+using prometheus::Summary;
+
+namespace {
+
+enum class Distribution {
+  LogNormal,
+  Bimodal,
+  HeavyTail,
+  Sorted,
+  ReverseSorted,
+  Sawtooth,
+};
+
+std::vector<double> GenerateSamples(Distribution distribution,
+                                    std::size_t count) {
+  std::mt19937 gen(42);
+  std::vector<double> samples;
+  samples.reserve(count);
+
+  switch (distribution) {
+    case Distribution::LogNormal: {
+      std::lognormal_distribution<> d(0.0, 1.0);
+      for (std::size_t i = 0; i < count; ++i) samples.push_back(d(gen));
+      break;
+    }
+    case Distribution::Bimodal: {
+      std::normal_distribution<> fast(10.0, 1.0);
+      std::normal_distribution<> slow(200.0, 20.0);
+      std::bernoulli_distribution is_slow(0.1);
+      for (std::size_t i = 0; i < count; ++i) {
+        samples.push_back(is_slow(gen) ? slow(gen) : fast(gen));
+      }
+      break;
+    }
+    case Distribution::HeavyTail: {
+      // Pareto distribution with shape 1.16 (80/20 rule)
+      std::uniform_real_distribution<> d(0.0, 1.0);
+      for (std::size_t i = 0; i < count; ++i) {
+        samples.push_back(1.0 / std::pow(1.0 - d(gen), 1.0 / 1.16));
+      }
+      break;
+    }
+    case Distribution::Sorted:
+      for (std::size_t i = 0; i < count; ++i) samples.push_back(i);
+      break;
+    case Distribution::ReverseSorted:
+      for (std::size_t i = count; i > 0; --i) samples.push_back(i);
+      break;
+    case Distribution::Sawtooth:
+      for (std::size_t i = 0; i < count; ++i) samples.push_back(i % 1000);
+      break;
+  }
+
+  return samples;
+}
+
+// Distance of the rank of the estimated value to the requested rank,
+// relative to the number of samples.
+double RankError(const std::vector<double>& sorted, double quantile,
+                 double estimate) {
+  const auto n = static_cast<double>(sorted.size());
+  const auto lowest_rank = static_cast<double>(
+      std::lower_bound(sorted.begin(), sorted.end(), estimate) -
+      sorted.begin());
+  const auto highest_rank = static_cast<double>(
+      std::upper_bound(sorted.begin(), sorted.end(), estimate) -
+      sorted.begin());
+  const auto desired_rank = quantile * n;
+
+  if (desired_rank < lowest_rank) {
+    return (lowest_rank - desired_rank) / n;
+  }
+  if (desired_rank > highest_rank) {
+    return (desired_rank - highest_rank) / n;
+  }
+  return 0.0;
+}
+
+}  // namespace
+
+static void BM_Summary_Accuracy(benchmark::State& state) {
+  const auto distribution = static_cast<Distribution>(state.range(0));
+  const auto buffer_size = static_cast<std::size_t>(state.range(1));
+  const auto number_of_samples = static_cast<std::size_t>(state.range(2));
+
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{
+          {0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}, {0.999, 0.0001}});
+  const auto samples = GenerateSamples(distribution, number_of_samples);
+  auto sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+
+  double observe_ns = 0;
+  double flush_ns = 0;
+  double bytes = 0;
+  double max_rank_error = 0;
+  double max_error_ratio = 0;
+
+  while (state.KeepRunning()) {
+    Summary summary{quantiles, std::chrono::hours{1}, 5, buffer_size};
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto sample : samples) {
+      summary.Observe(sample);
+    }
+    const auto observed = std::chrono::steady_clock::now();
+    const auto metric = summary.Collect();
+    const auto collected = std::chrono::steady_clock::now();
+
+    observe_ns += std::chrono::duration<double, std::nano>(observed - start)
+                      .count() /
+                  samples.size();
+    flush_ns +=
+        std::chrono::duration<double, std::nano>(collected - observed).count();
+    bytes += summary.MemoryUsage();
+
+    for (std::size_t i = 0; i < quantiles->size(); ++i) {
+      const auto& target = quantiles->at(i);
+      const auto error = RankError(sorted, target.quantile,
+                                   metric.summary.quantile.at(i).value);
+      max_rank_error = std::max(max_rank_error, error);
+      max_error_ratio = std::max(max_error_ratio, error / target.error);
+    }
+  }
+
+  state.counters["ns_per_observe"] =
+      benchmark::Counter(observe_ns, benchmark::Counter::kAvgIterations);
+  state.counters["flush_ns"] =
+      benchmark::Counter(flush_ns, benchmark::Counter::kAvgIterations);
+  state.counters["bytes"] =
+      benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+  // worst rank error over all quantiles and iterations, and the same error
+  // in multiples of the tolerated error (values above 1 violate the target)
+  state.counters["max_rank_error"] = max_rank_error;
+  state.counters["max_error_ratio"] = max_error_ratio;
+}
+BENCHMARK(BM_Summary_Accuracy)
+    ->ArgNames({"distribution", "buffer", "samples"})
+    ->ArgsProduct({{static_cast<int>(Distribution::LogNormal),
+                    static_cast<int>(Distribution::Bimodal),
+                    static_cast<int>(Distribution::HeavyTail),
+                    static_cast<int>(Distribution::Sorted),
+                    static_cast<int>(Distribution::ReverseSorted),
+                    static_cast<int>(Distribution::Sawtooth)},
+                   {64, 500},
+                   {100000}})
+    ->Unit(benchmark::kMillisecond);
@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <vector>
 
@@ -137,3 +139,52 @@ static void BM_Summary_Collect_Common(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_Summary_Collect_Common)->Range(0, ITERATIONS);
+
+static void BM_Summary_Observe_ClockSource(benchmark::State& state) {
+  using prometheus::Summary;
+
+  const auto clock_source = state.range(0) ? Summary::ClockSource::Coarse
+                                           : Summary::ClockSource::Steady;
+
+  auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{
+          {0.5, 0.05}, {0.9, 0.01}, {0.95, 0.005}, {0.99, 0.001}});
+  Summary summary{quantiles, std::chrono::seconds{60}, 5,
+                  prometheus::detail::CKMSQuantiles::kDefaultBufferSize,
+                  clock_source};
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_real_distribution<> d(0, 100);
+
+  while (state.KeepRunning()) {
+    summary.Observe(d(gen));
+  }
+}
+BENCHMARK(BM_Summary_Observe_ClockSource)->Arg(0)->Arg(1);
+
+// Ingest records of "value seen count times", either as count single
+// observations (second argument 0) or as one weighted observation (1).
+static void BM_Summary_Observe_PreAggregated(benchmark::State& state) {
+  using prometheus::Summary;
+
+  const auto count = static_cast<std::uint64_t>(state.range(0));
+  const auto weighted = state.range(1) != 0;
+
+  Summary summary{Summary::Quantiles{
+      {0.5, 0.05}, {0.9, 0.01}, {0.95, 0.005}, {0.99, 0.001}}};
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> d(0, 100);
+
+  while (state.KeepRunning()) {
+    const auto value = static_cast<double>(d(gen));
+    if (weighted) {
+      summary.Observe(value, count);
+    } else {
+      for (std::uint64_t i = 0; i < count; ++i) {
+        summary.Observe(value);
+      }
+    }
+  }
+}
+BENCHMARK(BM_Summary_Observe_PreAggregated)
+    ->ArgsProduct({{1, 16, 256}, {0, 1}});
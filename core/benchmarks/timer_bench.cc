@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+#include "prometheus/detail/tsc_clock.h"
+#include "prometheus/duration_histogram.h"
+#include "prometheus/histogram.h"
+#include "prometheus/scoped_timer.h"
+#include "prometheus/stopwatch.h"
+
+using prometheus::Histogram;
+
+static void BM_SteadyClock_Now(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(std::chrono::steady_clock::now());
+  }
+}
+BENCHMARK(BM_SteadyClock_Now);
+
+static void BM_TscClock_Ticks(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(prometheus::detail::TscClock::Ticks());
+  }
+}
+BENCHMARK(BM_TscClock_Ticks);
+
+static void BM_Stopwatch_Elapsed(benchmark::State& state) {
+  state.SetLabel(prometheus::detail::TscClock::IsAvailable() ? "tsc"
+                                                            : "steady_clock");
+  while (state.KeepRunning()) {
+    prometheus::Stopwatch stopwatch;
+    benchmark::DoNotOptimize(stopwatch.Elapsed());
+  }
+}
+BENCHMARK(BM_Stopwatch_Elapsed);
+
+// the pattern the timers replace: two clock reads and a duration_cast
+static void BM_Histogram_Observe_SteadyClock(benchmark::State& state) {
+  Histogram histogram{{0.001, 0.01, 0.1, 1}};
+  while (state.KeepRunning()) {
+    const auto start = std::chrono::steady_clock::now();
+    histogram.Observe(std::chrono::duration_cast<std::chrono::duration<double>>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+  }
+}
+BENCHMARK(BM_Histogram_Observe_SteadyClock);
+
+static void BM_Histogram_Observe_ScopedTimer(benchmark::State& state) {
+  Histogram histogram{{0.001, 0.01, 0.1, 1}};
+  while (state.KeepRunning()) {
+    prometheus::ScopedTimer timer{histogram};
+  }
+}
+BENCHMARK(BM_Histogram_Observe_ScopedTimer);
+
+static void BM_DurationHistogram_Observe_ScopedTimer(benchmark::State& state) {
+  using std::chrono::microseconds;
+  prometheus::DurationHistogram histogram{
+      {microseconds{1}, microseconds{10}, microseconds{100}}};
+  while (state.KeepRunning()) {
+    prometheus::ScopedTimer timer{histogram};
+  }
+}
+BENCHMARK(BM_DurationHistogram_Observe_ScopedTimer);
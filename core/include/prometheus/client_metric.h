@@ -68,10 +68,25 @@ struct PROMETHEUS_CPP_CORE_EXPORT ClientMetric {
     double upper_bound = 0.0;
   };
 
+  struct BucketSpan {
+    std::int32_t offset = 0;
+    std::uint32_t length = 0;
+  };
+
   struct Histogram {
     std::uint64_t sample_count = 0;
     double sample_sum = 0.0;
     std::vector<Bucket> bucket;
+
+    // Native histogram buckets, see NativeHistogram. A histogram is a native
+    // histogram if it has at least one positive or negative span.
+    std::int32_t schema = 0;
+    double zero_threshold = 0.0;
+    std::uint64_t zero_count = 0;
+    std::vector<BucketSpan> negative_span;
+    std::vector<std::int64_t> negative_delta;
+    std::vector<BucketSpan> positive_span;
+    std::vector<std::int64_t> positive_delta;
   };
   Histogram histogram;
 
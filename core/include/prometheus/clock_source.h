@@ -0,0 +1,14 @@
+#pragma once
+
+namespace prometheus {
+
+/// \brief Selects the clock a metric uses to measure time internally.
+enum class ClockSource {
+  /// \brief The standard clock with full resolution.
+  Steady,
+  /// \brief A coarse clock, cheaper to read but only accurate to a few
+  /// milliseconds. See detail::CoarseSteadyClock.
+  Coarse,
+};
+
+}  // namespace prometheus
@@ -5,6 +5,7 @@
 #include "prometheus/detail/core_export.h"
 
 namespace prometheus {
+class MetricFilter;
 struct MetricFamily;
 }
 
@@ -20,6 +21,15 @@ class PROMETHEUS_CPP_CORE_EXPORT Collectable {
 
   /// \brief Returns a list of metrics and their samples.
   virtual std::vector<MetricFamily> Collect() const = 0;
+
+  /// \brief Returns the metrics and their samples of the families accepted
+  /// by the filter.
+  ///
+  /// The default implementation collects all families and drops the
+  /// unmatched ones. Collectables which can tell the names of their families
+  /// upfront override it to not collect the unmatched ones at all.
+  virtual std::vector<MetricFamily> CollectMatching(
+      const MetricFilter& filter) const;
 };
 
 }  // namespace prometheus
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "prometheus/detail/core_export.h"
+
+// IWYU pragma: private, include "prometheus/histogram.h"
+
+namespace prometheus {
+namespace detail {
+
+/// \brief Maps observed values to the buckets of a Histogram.
+///
+/// The layout detects boundaries which are evenly spaced (linear) or grow by
+/// a constant factor (exponential). For those the bucket index is estimated
+/// arithmetically and corrected against the actual boundaries, so the result
+/// always equals the one of std::lower_bound. Other layouts fall back to a
+/// branchless binary search.
+///
+/// A layout is immutable. Copies are cheap and share the boundaries, which
+/// allows all histograms of a family to refer to a single instance.
+class PROMETHEUS_CPP_CORE_EXPORT BucketLayout {
+ public:
+  /// \throw std::invalid_argument if the boundaries are not strictly sorted.
+  explicit BucketLayout(std::vector<double> boundaries);
+
+  /// \brief Index of the first boundary not less than the value.
+  ///
+  /// Returns the number of boundaries if the value is greater than all of
+  /// them, and 0 for NaN.
+  std::size_t Index(double value) const;
+
+  const std::vector<double>& Boundaries() const;
+
+  /// \brief Number of buckets including the implicit +Inf bucket.
+  std::size_t BucketCount() const;
+
+  bool IsLinear() const;
+  bool IsExponential() const;
+
+ private:
+  struct Data;
+
+  std::size_t Search(double value) const;
+  std::size_t Correct(double estimate, double value) const;
+
+  std::shared_ptr<const Data> data_;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "prometheus/detail/core_export.h"
 #include "prometheus/labels.h"
 
 // IWYU pragma: private
@@ -10,11 +14,14 @@
 namespace prometheus {
 
 template <typename T>
-class Family;    // IWYU pragma: keep
-class Registry;  // IWYU pragma: keep
+class Family;     // IWYU pragma: keep
+class Histogram;  // IWYU pragma: keep
+class Registry;   // IWYU pragma: keep
 
 namespace detail {
 
+class BucketLayout;  // IWYU pragma: keep
+
 template <typename T>
 class Builder {
  public:
@@ -29,5 +36,41 @@ class Builder {
   std::string help_;
 };
 
+template <>
+class PROMETHEUS_CPP_CORE_EXPORT Builder<Histogram> {
+ public:
+  Builder& Labels(const ::prometheus::Labels& labels);
+  Builder& Name(const std::string&);
+  Builder& Help(const std::string&);
+  /// \brief Set the bucket boundaries shared by all histograms of the family.
+  ///
+  /// Histograms added with Family<Histogram>::Add(const Labels&) refer to
+  /// these boundaries instead of a copy of their own.
+  ///
+  /// \throw std::invalid_argument if the boundaries are not strictly sorted.
+  /// \note Register() throws std::invalid_argument if the family is already
+  /// registered with other Buckets() or Shards().
+  Builder& Buckets(std::vector<double> bucket_boundaries);
+  /// \brief Stripe the buckets of the histograms over shards.
+  ///
+  /// Applies to histograms added with Family<Histogram>::Add(const Labels&),
+  /// see Histogram::Histogram(detail::BucketLayout, std::size_t).
+  ///
+  /// \param shards The number of shards, 0 selects one shard per hardware
+  /// thread.
+  /// \note Register() throws std::invalid_argument unless Buckets() is set
+  /// as well.
+  Builder& Shards(std::size_t shards);
+  Family<Histogram>& Register(Registry&);
+
+ private:
+  ::prometheus::Labels labels_;
+  std::string name_;
+  std::string help_;
+  std::shared_ptr<const BucketLayout> layout_;
+  bool sharded_{false};
+  std::size_t shards_{0};
+};
+
 }  // namespace detail
 }  // namespace prometheus
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <vector>
 
@@ -23,25 +23,41 @@ class PROMETHEUS_CPP_CORE_EXPORT CKMSQuantiles {
     double v;
   };
 
- private:
-  struct Item {
+  struct PROMETHEUS_CPP_CORE_EXPORT Item {
     double value;
-    int g;
-    int delta;
+    std::int64_t g;
+    std::int64_t delta;
 
-    Item(double value, int lower_delta, int delta);
+    Item(double value, std::int64_t lower_delta, std::int64_t delta);
   };
 
- public:
-  explicit CKMSQuantiles(const std::vector<Quantile>& quantiles);
+  static const std::size_t kDefaultBufferSize = 500;
+
+  explicit CKMSQuantiles(const std::vector<Quantile>& quantiles,
+                         std::size_t buffer_size = kDefaultBufferSize);
 
   void insert(double value);
+
+  // Insert a value observed weight times, independent of the weight.
+  void insert(double value, std::size_t weight);
+  // Insert a batch of values in ascending order, bypassing the buffer.
+  void insertSorted(const std::vector<double>& values);
   double get(double q);
   void reset();
 
+  // Flush pending observations and return the compressed samples.
+  const std::vector<Item>& snapshot();
+  // Merge samples returned by snapshot() of another instance.
+  void merge(const std::vector<Item>& items);
+
+  // Approximate number of heap bytes owned by this instance.
+  std::size_t memoryUsage() const;
+
  private:
-  double allowableError(int rank);
+  double allowableError(std::int64_t rank);
   bool insertBatch();
+  void mergeSorted(const std::vector<double>& values);
+  void insertWeighted(double value, std::int64_t weight);
   void compress();
 
  private:
@@ -49,8 +65,11 @@ class PROMETHEUS_CPP_CORE_EXPORT CKMSQuantiles {
 
   std::size_t count_;
   std::vector<Item> sample_;
-  std::array<double, 500> buffer_;
-  std::size_t buffer_count_;
+  // allocated on first insert, so idle instances stay small
+  std::vector<double> buffer_;
+  std::size_t buffer_size_;
+  // weighted items inserted since the last compression
+  std::size_t uncompressed_;
 };
 
 }  // namespace detail
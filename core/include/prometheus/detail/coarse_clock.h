@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+
+#include "prometheus/clock_source.h"
+#include "prometheus/detail/core_export.h"
+
+namespace prometheus {
+namespace detail {
+
+/// \brief A steady clock that trades resolution for a cheaper read.
+///
+/// On Linux the clock reads CLOCK_MONOTONIC_COARSE, which is served from the
+/// vDSO without touching the hardware timer and is only updated once per
+/// scheduler tick (typically 1-4 milliseconds). It shares its epoch with
+/// std::chrono::steady_clock. On other platforms it falls back to
+/// std::chrono::steady_clock.
+struct PROMETHEUS_CPP_CORE_EXPORT CoarseSteadyClock {
+  using duration = std::chrono::steady_clock::duration;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  static const bool is_steady = true;
+
+  static time_point now() noexcept;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "prometheus/detail/core_export.h"
+
+// IWYU pragma: private, include "prometheus/histogram.h"
+
+namespace prometheus {
+namespace detail {
+
+/// \brief Bucket counts and sum of a Histogram striped over shards.
+///
+/// Each shard holds a full set of bucket counts plus the sum and starts on a
+/// cache line of its own, so threads writing to different shards never touch
+/// the same cache line. A thread is assigned to a shard on first use and
+/// sticks to it. Updates are relaxed atomic operations without any lock.
+///
+/// Reading the counts sums up all shards. The result is not a consistent
+/// snapshot, i.e., concurrent observations may be visible in the counts but
+/// not yet in the sum or vice versa.
+class PROMETHEUS_CPP_CORE_EXPORT ShardedBuckets {
+ public:
+  /// \param bucket_count The number of buckets per shard.
+  /// \param shard_count The number of shards, 0 selects one shard per
+  /// hardware thread.
+  ShardedBuckets(std::size_t bucket_count, std::size_t shard_count);
+
+  /// \brief Add count observations to a bucket of the calling thread's shard.
+  void Increment(std::size_t bucket, std::uint64_t count);
+
+  /// \brief Add to the sum of the calling thread's shard.
+  void IncrementSum(double value);
+
+  /// \brief Reset all counts and the sum of all shards to 0.
+  void Reset();
+
+  /// \brief Get the number of shards.
+  std::size_t ShardCount() const;
+
+  /// \brief Get the counts per bucket summed up over all shards.
+  std::vector<std::uint64_t> Counts() const;
+
+  /// \brief Get the sum summed up over all shards.
+  double Sum() const;
+
+ private:
+  std::atomic<std::uint64_t>* Shard();
+
+  const std::size_t bucket_count_;
+  const std::size_t shard_count_;
+  // entries per shard, a multiple of the cache line size
+  const std::size_t stride_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> storage_;
+  // first entry of the first shard, aligned to a cache line within storage_
+  std::atomic<std::uint64_t>* shards_;
+};
+
+}  // namespace detail
+}  // namespace prometheus
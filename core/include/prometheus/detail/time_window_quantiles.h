@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "prometheus/detail/ckms_quantiles.h"  // IWYU pragma: export
+#include "prometheus/detail/coarse_clock.h"
 #include "prometheus/detail/core_export.h"
 
 // IWYU pragma: private, include "prometheus/summary.h"
@@ -16,11 +17,26 @@ class PROMETHEUS_CPP_CORE_EXPORT TimeWindowQuantiles {
   using Clock = std::chrono::steady_clock;
 
  public:
-  TimeWindowQuantiles(const std::vector<CKMSQuantiles::Quantile>& quantiles,
-                      Clock::duration max_age_seconds, int age_buckets);
+  TimeWindowQuantiles(
+      const std::vector<CKMSQuantiles::Quantile>& quantiles,
+      Clock::duration max_age_seconds, int age_buckets,
+      std::size_t buffer_size = CKMSQuantiles::kDefaultBufferSize,
+      ClockSource clock_source = ClockSource::Steady);
 
   double get(double q) const;
   void insert(double value);
+  // Insert a value observed weight times into every age bucket.
+  void insert(double value, std::size_t weight);
+  // Insert a batch of values in ascending order into every age bucket.
+  void insertSorted(const std::vector<double>& values);
+
+  // Samples of the whole time window, see CKMSQuantiles::snapshot().
+  std::vector<CKMSQuantiles::Item> snapshot() const;
+  // Merge samples into every age bucket, see CKMSQuantiles::merge().
+  void merge(const std::vector<CKMSQuantiles::Item>& items);
+
+  // Approximate number of heap bytes owned by this instance.
+  std::size_t memoryUsage() const;
 
  private:
   CKMSQuantiles& rotate() const;
@@ -29,6 +45,7 @@ class PROMETHEUS_CPP_CORE_EXPORT TimeWindowQuantiles {
   mutable std::vector<CKMSQuantiles> ckms_quantiles_;
   mutable std::size_t current_bucket_;
 
+  Clock::time_point (*const now_)();
   mutable Clock::time_point last_rotation_;
   const Clock::duration rotation_interval_;
 };
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "prometheus/detail/core_export.h"
+
+#if defined(__x86_64__) && defined(__linux__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define PROMETHEUS_CPP_HAVE_TSC 1
+#endif
+
+// IWYU pragma: private, include "prometheus/stopwatch.h"
+
+namespace prometheus {
+namespace detail {
+
+/// \brief Measures time with the time stamp counter of the CPU.
+///
+/// Reading the TSC takes a single unprivileged instruction, which is cheaper
+/// than a call to std::chrono::steady_clock::now(). The TSC is only used on
+/// x86-64 Linux if the CPU reports an invariant TSC, i.e., one which ticks
+/// at a constant rate regardless of frequency scaling and sleep states, and
+/// the kernel itself selected the TSC as its clock source, i.e., considers it
+/// synchronized across cores. The tick rate is calibrated against
+/// std::chrono::steady_clock once, on first use.
+///
+/// Everywhere else IsAvailable() returns false and callers fall back to
+/// std::chrono::steady_clock, see Stopwatch.
+struct PROMETHEUS_CPP_CORE_EXPORT TscClock {
+  struct Calibration {
+    bool available;
+    double nanoseconds_per_tick;
+  };
+
+  /// \brief Check the TSC and calibrate it on first call.
+  ///
+  /// The first call blocks for a few milliseconds. Later calls return the
+  /// same result without any synchronization beyond the one of a function
+  /// local static.
+  static const Calibration& GetCalibration();
+
+  /// \brief Whether the TSC is invariant and calibrated.
+  static bool IsAvailable() { return GetCalibration().available; }
+
+  /// \brief Read the TSC, 0 if the platform has none.
+  ///
+  /// The read is not serializing, i.e., the CPU may reorder it with close-by
+  /// instructions. This is negligible for scopes of more than a few dozen
+  /// instructions.
+  static std::uint64_t Ticks() {
+#ifdef PROMETHEUS_CPP_HAVE_TSC
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+  }
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/detail/builder.h"  // IWYU pragma: export
+#include "prometheus/detail/core_export.h"
+#include "prometheus/metric_type.h"
+
+namespace prometheus {
+
+/// \brief A histogram of durations.
+///
+/// This class represents the metric type histogram:
+/// https://prometheus.io/docs/concepts/metric_types/#histogram
+///
+/// In contrast to Histogram the observations are std::chrono durations and
+/// all arithmetic is done in integer nanoseconds. Observe() matches the bucket
+/// with integer comparisons and updates counts and sum with atomic
+/// fetch_add, i.e., it never takes a lock. Only Collect() converts the
+/// boundaries and the sum to seconds, the base unit of Prometheus.
+///
+/// The sum is kept as whole seconds plus a nanosecond remainder, so it does
+/// not overflow before about 292 billion years of accumulated durations.
+///
+/// See ScopedTimer for measuring the duration of a scope.
+///
+/// The class is thread-safe. No concurrent call to any API of this type causes
+/// a data race.
+class PROMETHEUS_CPP_CORE_EXPORT DurationHistogram {
+ public:
+  using BucketBoundaries = std::vector<std::chrono::nanoseconds>;
+
+  static const MetricType metric_type{MetricType::Histogram};
+
+  /// \brief Create a histogram with manually chosen buckets.
+  ///
+  /// The BucketBoundaries are a list of monotonically increasing durations,
+  /// see Histogram::Histogram(const BucketBoundaries&).
+  ///
+  /// \throw std::invalid_argument if the boundaries are not strictly sorted.
+  explicit DurationHistogram(const BucketBoundaries& buckets);
+
+  /// \brief Observe the given duration.
+  ///
+  /// Durations coarser than nanoseconds, e.g., std::chrono::milliseconds,
+  /// convert implicitly.
+  void Observe(std::chrono::nanoseconds duration);
+
+  /// \brief Observe the given duration in nanoseconds.
+  void ObserveNanoseconds(std::int64_t nanoseconds);
+
+  /// \brief Reset all data points collected so far.
+  void Reset();
+
+  /// \brief Get the current value of the histogram.
+  ///
+  /// Collect is called by the Registry when collecting metrics.
+  ClientMetric Collect() const;
+
+ private:
+  std::vector<std::int64_t> bucket_boundaries_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> bucket_counts_;
+  std::atomic<std::int64_t> sum_seconds_{0};
+  // carried into sum_seconds_ in steps of 1000 seconds
+  std::atomic<std::int64_t> sum_nanoseconds_{0};
+};
+
+/// \brief Return a builder to configure and register a DurationHistogram
+/// metric.
+///
+/// @copydetails Family<>::Family()
+///
+/// Example usage:
+///
+/// \code
+/// auto registry = std::make_shared<Registry>();
+/// auto& histogram_family = prometheus::BuildDurationHistogram()
+///                              .Name("some_name_seconds")
+///                              .Help("Additional description.")
+///                              .Labels({{"key", "value"}})
+///                              .Register(*registry);
+///
+/// ...
+/// \endcode
+///
+/// \return An object of unspecified type T, i.e., an implementation detail
+/// except that it has the following members:
+///
+/// - Name(const std::string&) to set the metric name,
+/// - Help(const std::string&) to set an additional description.
+/// - Labels(const Labels&) to assign a set of
+///   key-value pairs (= labels) to the metric.
+///
+/// To finish the configuration of the DurationHistogram metric register it
+/// with Register(Registry&).
+PROMETHEUS_CPP_CORE_EXPORT detail::Builder<DurationHistogram>
+BuildDurationHistogram();
+
+}  // namespace prometheus
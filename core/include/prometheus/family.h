@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -92,6 +93,38 @@ class PROMETHEUS_CPP_CORE_EXPORT Family : public Collectable {
   Family(const std::string& name, const std::string& help,
          const Labels& constant_labels);
 
+  /// \brief Creates the metric for a new set of labels, see Add(const Labels&).
+  using Factory = std::function<std::unique_ptr<T>()>;
+
+  /// \brief Create a new metric with a factory for its dimensional data.
+  ///
+  /// \param name Set the metric name.
+  /// \param help Set an additional description.
+  /// \param constant_labels Assign a set of key-value pairs (= labels) to the
+  /// metric. All these labels are propagated to each time series within the
+  /// metric.
+  /// \param factory Creates the metric for Add(const Labels&).
+  /// \throw std::runtime_exception on invalid metric or label names.
+  Family(const std::string& name, const std::string& help,
+         const Labels& constant_labels, Factory factory);
+
+  /// \brief Add a new dimensional data with the configuration of the family.
+  ///
+  /// The metric is created by the factory of the family, e.g., a Histogram
+  /// with the bucket boundaries given to the builder, which are shared by all
+  /// histograms of the family. Without a factory the metric is default
+  /// constructed.
+  ///
+  /// \param labels Assign a set of key-value pairs (= labels) to the
+  /// dimensional data. The function does nothing, if the same set of labels
+  /// already exists.
+  /// \return Return the newly created dimensional data or - if a same set of
+  /// labels already exists - the already existing dimensional data.
+  /// \throw std::runtime_exception on invalid label names.
+  /// \throw std::invalid_argument if there is no factory and T requires
+  /// constructor arguments.
+  T& Add(const Labels& labels);
+
   /// \brief Add a new dimensional data.
   ///
   /// Each new set of labels adds a new dimensional data and is exposed in
@@ -142,12 +175,18 @@ class PROMETHEUS_CPP_CORE_EXPORT Family : public Collectable {
   /// \return Zero or more samples for each dimensional data.
   std::vector<MetricFamily> Collect() const override;
 
+  /// \brief Returns the current value of each dimensional data if the filter
+  /// accepts the name of this family, nothing otherwise.
+  std::vector<MetricFamily> CollectMatching(
+      const MetricFilter& filter) const override;
+
  private:
   std::unordered_map<Labels, std::unique_ptr<T>, detail::LabelHasher> metrics_;
 
   const std::string name_;
   const std::string help_;
   const Labels constant_labels_;
+  const Factory factory_;
   mutable std::mutex mutex_;
 
   ClientMetric CollectMetric(const Labels& labels, T* metric) const;
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/detail/bucket_layout.h"
+#include "prometheus/detail/builder.h"  // IWYU pragma: export
+#include "prometheus/detail/core_export.h"
+#include "prometheus/gauge.h"
+#include "prometheus/metric_type.h"
+
+namespace prometheus {
+
+/// \brief A histogram with log-linear buckets of bounded relative error.
+///
+/// This class represents the metric type histogram:
+/// https://prometheus.io/docs/concepts/metric_types/#histogram
+///
+/// Observations are recorded like in HdrHistogram: the range between the
+/// lowest discernible and the highest trackable value is split into powers of
+/// two, each of which is split into equally sized sub-buckets. The number of
+/// sub-buckets follows from the requested number of significant decimal
+/// digits, i.e., 3 significant digits keep the relative error of every
+/// recorded value below 0.1%. Observe() computes the bucket index with a few
+/// integer operations and increments it with an atomic fetch_add. It neither
+/// searches nor takes a lock.
+///
+/// The recording precision is decoupled from the exposition cost. Collect()
+/// coarsens the recorded distribution either to configured classic buckets or
+/// to the sparse buckets of a NativeHistogram. Each recorded bucket is
+/// attributed to the exposed bucket containing its lowest equivalent value,
+/// so exposed counts are exact up to the recording precision.
+///
+/// Values below the lowest discernible value, including negative values and
+/// NaN, are recorded as 0. Values above the highest trackable value are
+/// recorded as the highest trackable value. The sum always uses the observed
+/// value.
+///
+/// The class is thread-safe. No concurrent call to any API of this type causes
+/// a data race.
+class PROMETHEUS_CPP_CORE_EXPORT HdrHistogram {
+ public:
+  using BucketBoundaries = std::vector<double>;
+
+  static const MetricType metric_type{MetricType::Histogram};
+
+  static const int kMinSignificantDigits = 1;
+  static const int kMaxSignificantDigits = 5;
+
+  /// \brief Create a histogram exposed with classic buckets.
+  ///
+  /// \param lowest_discernible_value The smallest value distinguished from 0,
+  /// e.g., 1e-6 to record seconds with microsecond resolution.
+  /// \param highest_trackable_value The largest value recorded without
+  /// clamping, at least twice the lowest discernible value.
+  /// \param significant_digits The recording precision, between
+  /// kMinSignificantDigits and kMaxSignificantDigits.
+  /// \param buckets The exposed bucket boundaries, see
+  /// Histogram::Histogram(const BucketBoundaries&).
+  /// \throw std::invalid_argument on an invalid range, precision or bucket
+  /// boundaries.
+  HdrHistogram(double lowest_discernible_value, double highest_trackable_value,
+               int significant_digits, const BucketBoundaries& buckets);
+
+  /// \brief Create a histogram exposed with native buckets.
+  ///
+  /// The schema of the NativeHistogram is the finest one whose buckets are
+  /// not narrower than the recording buckets, at most
+  /// NativeHistogram::kMaxSchema.
+  ///
+  /// \throw std::invalid_argument on an invalid range or precision.
+  HdrHistogram(double lowest_discernible_value, double highest_trackable_value,
+               int significant_digits);
+
+  /// \brief Observe the given amount.
+  void Observe(double value);
+
+  /// \brief Reset all data points collected so far.
+  void Reset();
+
+  /// \brief Get the number of recording buckets.
+  std::size_t RecordingBucketCount() const;
+
+  /// \brief Get the current value of the histogram.
+  ///
+  /// Collect is called by the Registry when collecting metrics.
+  ClientMetric Collect() const;
+
+ private:
+  HdrHistogram(double lowest_discernible_value, double highest_trackable_value,
+               int significant_digits,
+               std::unique_ptr<const detail::BucketLayout> layout);
+
+  std::size_t CountsIndex(std::int64_t value) const;
+  std::int64_t LowestEquivalentValue(std::size_t index) const;
+
+  ClientMetric CollectClassic() const;
+  ClientMetric CollectNative() const;
+
+  const double unit_;
+  const std::int64_t highest_trackable_value_;
+  const int sub_bucket_half_count_magnitude_;
+  const std::int64_t sub_bucket_mask_;
+  const std::size_t counts_length_;
+  const int native_schema_;
+  // null if exposed with native buckets
+  const std::unique_ptr<const detail::BucketLayout> layout_;
+  // end of the range of recording buckets attributed to each classic bucket
+  std::vector<std::size_t> bucket_ends_;
+
+  std::unique_ptr<std::atomic<std::uint64_t>[]> counts_;
+  Gauge sum_;
+};
+
+/// \brief Return a builder to configure and register a HdrHistogram metric.
+///
+/// @copydetails Family<>::Family()
+///
+/// Example usage:
+///
+/// \code
+/// auto registry = std::make_shared<Registry>();
+/// auto& histogram_family = prometheus::BuildHdrHistogram()
+///                              .Name("some_name_seconds")
+///                              .Help("Additional description.")
+///                              .Labels({{"key", "value"}})
+///                              .Register(*registry);
+///
+/// ...
+/// \endcode
+///
+/// \return An object of unspecified type T, i.e., an implementation detail
+/// except that it has the following members:
+///
+/// - Name(const std::string&) to set the metric name,
+/// - Help(const std::string&) to set an additional description.
+/// - Labels(const Labels&) to assign a set of
+///   key-value pairs (= labels) to the metric.
+///
+/// To finish the configuration of the HdrHistogram metric register it with
+/// Register(Registry&).
+PROMETHEUS_CPP_CORE_EXPORT detail::Builder<HdrHistogram> BuildHdrHistogram();
+
+}  // namespace prometheus
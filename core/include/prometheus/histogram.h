@@ -1,12 +1,17 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "prometheus/client_metric.h"
 #include "prometheus/counter.h"
+#include "prometheus/detail/bucket_layout.h"
 #include "prometheus/detail/builder.h"  // IWYU pragma: export
 #include "prometheus/detail/core_export.h"
+#include "prometheus/detail/sharded_buckets.h"
 #include "prometheus/gauge.h"
 #include "prometheus/metric_type.h"
 
@@ -26,6 +31,10 @@ namespace prometheus {
 /// See https://prometheus.io/docs/practices/histograms/ for detailed
 /// explanations of histogram usage and differences to summaries.
 ///
+/// By default all observations serialize on a mutex. Histograms observed by
+/// many threads at once can instead stripe their buckets over shards, see
+/// Histogram(detail::BucketLayout, std::size_t).
+///
 /// The class is thread-safe. No concurrent call to any API of this type causes
 /// a data race.
 class PROMETHEUS_CPP_CORE_EXPORT Histogram {
@@ -41,7 +50,9 @@ class PROMETHEUS_CPP_CORE_EXPORT Histogram {
   /// interpreted as a half-open interval [b_n, b_n+1) which defines one bucket.
   ///
   /// There is no limitation on how the buckets are divided, i.e, equal size,
-  /// exponential etc..
+  /// exponential etc.. Evenly spaced and exponentially growing boundaries, as
+  /// created by LinearBuckets() and ExponentialBuckets(), are detected and
+  /// allow to compute the bucket of an observation in constant time.
   ///
   /// The bucket boundaries cannot be changed once the histogram is created.
   explicit Histogram(const BucketBoundaries& buckets);
@@ -49,6 +60,30 @@ class PROMETHEUS_CPP_CORE_EXPORT Histogram {
   /// \copydoc Histogram::Histogram(const BucketBoundaries&)
   explicit Histogram(BucketBoundaries&& buckets);
 
+  /// \brief Create a histogram sharing the buckets with other histograms.
+  ///
+  /// The layout is immutable and its boundaries are not copied, i.e., any
+  /// number of histograms can refer to the same boundaries. This is how
+  /// histograms added with Family<Histogram>::Add(const Labels&) share the
+  /// boundaries given to the builder.
+  explicit Histogram(detail::BucketLayout layout);
+
+  /// \brief Create a histogram with buckets striped over shards.
+  ///
+  /// Every shard holds its own counts and sum on separate cache lines and
+  /// each thread observes into one shard only. Observe() is lock-free and
+  /// threads on different shards do not contend for cache lines, at the cost
+  /// of memory per shard and a Collect() which sums up all shards. Counts and
+  /// sum collected during concurrent observations are not necessarily
+  /// consistent with each other.
+  ///
+  /// \param shards The number of shards, 0 selects one shard per hardware
+  /// thread.
+  Histogram(detail::BucketLayout layout, std::size_t shards);
+
+  /// \copydoc Histogram::Histogram(detail::BucketLayout, std::size_t)
+  Histogram(const BucketBoundaries& buckets, std::size_t shards);
+
   /// \brief Observe the given amount.
   ///
   /// The given amount selects the 'observed' bucket. The observed bucket is
@@ -57,11 +92,28 @@ class PROMETHEUS_CPP_CORE_EXPORT Histogram {
   /// sum of all observations is incremented.
   void Observe(double value);
 
+  /// \brief Observe the given amount count times.
+  ///
+  /// Equivalent to count calls of Observe(value), e.g., to ingest
+  /// pre-aggregated data, but the bucket and the sum are updated only once.
+  void Observe(double value, std::uint64_t count);
+
+  /// \brief Observe a batch of values.
+  ///
+  /// Equivalent to calling Observe() for each value, but the values are
+  /// sorted into buckets before the histogram is locked, and all counts and
+  /// the sum are updated at once.
+  ///
+  /// \param values Pointer to the first value.
+  /// \param count Number of values.
+  void ObserveBatch(const double* values, std::size_t count);
+
   /// \brief Observe multiple data points.
   ///
   /// Increments counters given a count for each bucket. (i.e. the caller of
   /// this function must have already sorted the values into buckets).
   /// Also increments the total sum of all observations by the given value.
+  /// Sharded histograms count in integers and truncate the increments.
   void ObserveMultiple(const std::vector<double>& bucket_increments,
                        double sum_of_values);
 
@@ -77,12 +129,33 @@ class PROMETHEUS_CPP_CORE_EXPORT Histogram {
   ClientMetric Collect() const;
 
  private:
-  BucketBoundaries bucket_boundaries_;
+  const detail::BucketLayout layout_;
   mutable std::mutex mutex_;
   std::vector<Counter> bucket_counts_;
   Gauge sum_;
+  // replaces bucket_counts_ and sum_ if not null
+  const std::unique_ptr<detail::ShardedBuckets> sharded_;
 };
 
+/// \brief Create bucket boundaries of equal width.
+///
+/// \param start The upper bound of the first bucket.
+/// \param width The distance between two consecutive boundaries.
+/// \param count The number of boundaries, excluding the implicit +Inf bucket.
+/// \throw std::invalid_argument if the width is not positive or count is 0.
+PROMETHEUS_CPP_CORE_EXPORT Histogram::BucketBoundaries LinearBuckets(
+    double start, double width, std::size_t count);
+
+/// \brief Create exponentially growing bucket boundaries.
+///
+/// \param start The upper bound of the first bucket, must be positive.
+/// \param factor The ratio of two consecutive boundaries, must be greater
+/// than 1.
+/// \param count The number of boundaries, excluding the implicit +Inf bucket.
+/// \throw std::invalid_argument on an invalid start, factor or count.
+PROMETHEUS_CPP_CORE_EXPORT Histogram::BucketBoundaries ExponentialBuckets(
+    double start, double factor, std::size_t count);
+
 /// \brief Return a builder to configure and register a Histogram metric.
 ///
 /// @copydetails Family<>::Family()
@@ -107,6 +180,9 @@ class PROMETHEUS_CPP_CORE_EXPORT Histogram {
 /// - Help(const std::string&) to set an additional description.
 /// - Labels(const Labels&) to assign a set of
 ///   key-value pairs (= labels) to the metric.
+/// - Buckets(std::vector<double>) to set the bucket boundaries shared by all
+///   histograms of the family.
+/// - Shards(std::size_t) to stripe the buckets of the histograms over shards.
 ///
 /// To finish the configuration of the Histogram metric register it with
 /// Register(Registry&).
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "prometheus/detail/core_export.h"
+
+namespace prometheus {
+
+/// \brief Selects metric families by their name.
+///
+/// A family is accepted if its name matches any of the names, prefixes or
+/// patterns added. An empty filter accepts every family.
+///
+/// Collectable::CollectMatching() takes a filter to skip unmatched families
+/// before they are collected at all, e.g., when a scrape asks for a few
+/// metrics only.
+class PROMETHEUS_CPP_CORE_EXPORT MetricFilter {
+ public:
+  /// \brief Accept the family with exactly the given name.
+  MetricFilter& AddName(std::string name);
+
+  /// \brief Accept all families whose name starts with the given prefix.
+  MetricFilter& AddPrefix(std::string prefix);
+
+  /// \brief Accept all families whose entire name matches the given
+  /// regular expression.
+  ///
+  /// Only a subset of the ECMAScript syntax is supported: metric name
+  /// characters, ".*", alternatives "a|b" and groups "(a|b)" which do not
+  /// nest. The pattern is matched without a regular expression engine, so a
+  /// pattern taken from a scrape request cannot make matching backtrack
+  /// exponentially.
+  ///
+  /// \throw std::invalid_argument if the pattern is malformed, uses any other
+  /// syntax, is longer than 1024 characters or expands into more than 64
+  /// alternatives.
+  MetricFilter& AddPattern(const std::string& pattern);
+
+  /// \brief Returns true if the filter accepts every family.
+  bool Empty() const;
+
+  /// \brief Returns true if the family with the given name is accepted.
+  bool Matches(const std::string& name) const;
+
+ private:
+  std::set<std::string> names_;
+  std::vector<std::string> prefixes_;
+  // names with '*' in place of ".*"
+  std::vector<std::string> patterns_;
+};
+
+}  // namespace prometheus
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/detail/builder.h"  // IWYU pragma: export
+#include "prometheus/detail/core_export.h"
+#include "prometheus/metric_type.h"
+
+namespace prometheus {
+
+/// \brief A histogram with sparse exponential buckets.
+///
+/// This class represents the native histogram of Prometheus:
+/// https://prometheus.io/docs/concepts/metric_types/#histogram
+///
+/// In contrast to Histogram the buckets are not configured upfront. The
+/// bucket boundaries follow an exponential schema and only buckets which
+/// received at least one observation are stored and exposed. Memory and
+/// scrape size therefore scale with the number of populated buckets and not
+/// with the range of observed values.
+///
+/// The schema determines the resolution. The boundaries of the positive
+/// buckets are the powers of base = 2^(2^-schema), i.e., schema 3 yields a
+/// growth factor of about 1.09 per bucket, schema 0 a factor of 2. Bucket
+/// index i covers the interval (base^(i-1), base^i], negative observations
+/// mirror this layout. Observations whose absolute value is at most the zero
+/// threshold are counted in a dedicated zero bucket.
+///
+/// If the number of populated buckets exceeds the configured limit, the
+/// resolution is halved by decrementing the schema and merging each pair of
+/// neighbouring buckets, until the limit is met or the lowest schema is
+/// reached.
+///
+/// Native histograms can only be exposed in the protobuf exposition format,
+/// see ProtobufSerializer. The text format only contains the count and sum.
+///
+/// The class is thread-safe. No concurrent call to any API of this type causes
+/// a data race.
+class PROMETHEUS_CPP_CORE_EXPORT NativeHistogram {
+ public:
+  static const MetricType metric_type{MetricType::Histogram};
+
+  static const int kMinSchema = -4;
+  static const int kMaxSchema = 8;
+  static const std::size_t kDefaultMaxBuckets = 160;
+
+  /// \brief The default zero threshold 2^-128.
+  static const double kDefaultZeroThreshold;
+
+  /// \brief Create a native histogram.
+  ///
+  /// \param schema The initial resolution, between kMinSchema and kMaxSchema.
+  /// \param max_buckets Maximum number of populated buckets before the
+  /// resolution is reduced. 0 disables the limit.
+  /// \param zero_threshold Observations with an absolute value up to this
+  /// threshold are counted in the zero bucket.
+  /// \throw std::invalid_argument on an invalid schema or a negative or NaN
+  /// zero threshold.
+  explicit NativeHistogram(int schema = 3,
+                           std::size_t max_buckets = kDefaultMaxBuckets,
+                           double zero_threshold = kDefaultZeroThreshold);
+
+  /// \brief Observe the given amount.
+  ///
+  /// Increments the count of the bucket the value falls into, allocating the
+  /// bucket if needed. NaN is only counted in the total count and sum.
+  void Observe(double value);
+
+  /// \brief Observe the given amount count times.
+  ///
+  /// Equivalent to count calls of Observe(value), e.g., to convert a
+  /// pre-aggregated distribution.
+  void Observe(double value, std::uint64_t count);
+
+  /// \brief Reset all data points collected so far.
+  ///
+  /// All buckets are released and the schema is restored to its initial
+  /// value.
+  void Reset();
+
+  /// \brief Get the current schema.
+  int Schema() const;
+
+  /// \brief Get the current value of the histogram.
+  ///
+  /// Collect is called by the Registry when collecting metrics.
+  ClientMetric Collect() const;
+
+ private:
+  void ReduceResolution();
+
+  const int initial_schema_;
+  const std::size_t max_buckets_;
+  const double zero_threshold_;
+
+  mutable std::mutex mutex_;
+  int schema_;
+  std::uint64_t count_{};
+  double sum_{};
+  std::uint64_t zero_count_{};
+  std::map<int, std::uint64_t> positive_buckets_;
+  std::map<int, std::uint64_t> negative_buckets_;
+};
+
+/// \brief Return a builder to configure and register a NativeHistogram metric.
+///
+/// @copydetails Family<>::Family()
+///
+/// Example usage:
+///
+/// \code
+/// auto registry = std::make_shared<Registry>();
+/// auto& histogram_family = prometheus::BuildNativeHistogram()
+///                              .Name("some_name")
+///                              .Help("Additional description.")
+///                              .Labels({{"key", "value"}})
+///                              .Register(*registry);
+///
+/// ...
+/// \endcode
+///
+/// \return An object of unspecified type T, i.e., an implementation detail
+/// except that it has the following members:
+///
+/// - Name(const std::string&) to set the metric name,
+/// - Help(const std::string&) to set an additional description.
+/// - Labels(const Labels&) to assign a set of
+///   key-value pairs (= labels) to the metric.
+///
+/// To finish the configuration of the NativeHistogram metric register it with
+/// Register(Registry&).
+PROMETHEUS_CPP_CORE_EXPORT detail::Builder<NativeHistogram>
+BuildNativeHistogram();
+
+}  // namespace prometheus
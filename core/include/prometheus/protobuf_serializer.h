@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+#include "prometheus/detail/core_export.h"
+#include "prometheus/metric_family.h"
+#include "prometheus/serializer.h"
+
+namespace prometheus {
+
+/// \brief Serializes metrics in the protobuf exposition format.
+///
+/// The output is a sequence of io.prometheus.client.MetricFamily messages,
+/// each prefixed with its length as varint. This is the only format which is
+/// able to carry the buckets of a NativeHistogram.
+class PROMETHEUS_CPP_CORE_EXPORT ProtobufSerializer : public Serializer {
+ public:
+  /// \brief The value of the Content-Type header for the serialized output.
+  static const char* const kContentType;
+
+  using Serializer::Serialize;
+  void Serialize(std::ostream& out,
+                 const std::vector<MetricFamily>& metrics) const override;
+};
+
+}  // namespace prometheus
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -14,9 +15,13 @@
 namespace prometheus {
 
 class Counter;
+class DurationHistogram;
 class Gauge;
+class HdrHistogram;
 class Histogram;
 class Info;
+class NativeHistogram;
+class StaticHistogramBase;
 class Summary;
 
 namespace detail {
@@ -33,8 +38,10 @@ class Builder;  // IWYU pragma: keep
 /// The key class is the Collectable. This has a method - called Collect() -
 /// that returns zero or more metrics and their samples. The metrics are
 /// represented by the class Family<>, which implements the Collectable
-/// interface. A new metric is registered with BuildCounter(), BuildGauge(),
-/// BuildHistogram(), BuildInfo() or BuildSummary().
+/// interface. A new metric is registered with BuildCounter(),
+/// BuildDurationHistogram(), BuildGauge(), BuildHdrHistogram(),
+/// BuildHistogram(), BuildInfo(), BuildNativeHistogram(),
+/// BuildStaticHistogram() or BuildSummary().
 ///
 /// The class is thread-safe. No concurrent call to any API of this type causes
 /// a data race.
@@ -81,13 +88,24 @@ class PROMETHEUS_CPP_CORE_EXPORT Registry : public Collectable {
   /// \return Zero or more metrics and their samples.
   std::vector<MetricFamily> Collect() const override;
 
+  /// \brief Returns a list of metrics and their samples of the families
+  /// accepted by the filter.
+  ///
+  /// Only the metrics of the accepted families are collected.
+  ///
+  /// \return Zero or more metrics and their samples.
+  std::vector<MetricFamily> CollectMatching(
+      const MetricFilter& filter) const override;
+
   /// \brief Removes a metrics family from the registry.
   ///
   /// Please note that this operation invalidates the previously
   /// returned reference to the Family and all of their added
   /// metric objects.
   ///
-  /// \tparam T One of the metric types Counter, Gauge, Histogram or Summary.
+  /// \tparam T One of the metric types Counter, DurationHistogram, Gauge,
+  /// HdrHistogram, Histogram, Info, NativeHistogram, StaticHistogramBase or
+  /// Summary.
   /// \param family The family to remove
   ///
   /// \return True if the family was found and removed.
@@ -104,16 +122,49 @@ class PROMETHEUS_CPP_CORE_EXPORT Registry : public Collectable {
   template <typename T>
   bool NameExistsInOtherType(const std::string& name) const;
 
+  // requires mutex_ to be held
+  template <typename T>
+  Family<T>& AddFamily(const std::string& name, const std::string& help,
+                       const Labels& labels,
+                       typename Family<T>::Factory factory);
+
   template <typename T>
   Family<T>& Add(const std::string& name, const std::string& help,
-                 const Labels& labels);
+                 const Labels& labels,
+                 typename Family<T>::Factory factory = nullptr);
+
+  Family<StaticHistogramBase>& AddStaticHistogram(
+      const std::string& name, const std::string& help, const Labels& labels,
+      Family<StaticHistogramBase>::Factory factory, const void* layout);
+
+  // what the factory of a family of histograms sets up, registering the
+  // family again has to ask for the same
+  struct HistogramLayout {
+    bool has_buckets;
+    std::vector<double> boundaries;
+    bool sharded;
+    std::size_t shards;
+  };
+
+  Family<Histogram>& AddHistogram(const std::string& name,
+                                  const std::string& help, const Labels& labels,
+                                  Family<Histogram>::Factory factory,
+                                  HistogramLayout layout);
 
   const InsertBehavior insert_behavior_;
   std::vector<std::unique_ptr<Family<Counter>>> counters_;
+  std::vector<std::unique_ptr<Family<DurationHistogram>>> duration_histograms_;
   std::vector<std::unique_ptr<Family<Gauge>>> gauges_;
+  std::vector<std::unique_ptr<Family<HdrHistogram>>> hdr_histograms_;
   std::vector<std::unique_ptr<Family<Histogram>>> histograms_;
   std::vector<std::unique_ptr<Family<Info>>> infos_;
+  std::vector<std::unique_ptr<Family<NativeHistogram>>> native_histograms_;
+  std::vector<std::unique_ptr<Family<StaticHistogramBase>>> static_histograms_;
   std::vector<std::unique_ptr<Family<Summary>>> summaries_;
+  // the bucket layout of each family of static histograms, whose metrics are
+  // only known by their base class
+  std::map<const void*, const void*> static_histogram_layouts_;
+  std::map<const void*, HistogramLayout> histogram_layouts_;
   mutable std::mutex mutex_;
 };
 
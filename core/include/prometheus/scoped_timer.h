@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+
+#include "prometheus/duration_histogram.h"
+#include "prometheus/stopwatch.h"
+
+namespace prometheus {
+
+/// \brief Observes the lifetime of a scope in a histogram or summary.
+///
+/// The metric can be of any type with an Observe(double) member function,
+/// e.g., Histogram, HdrHistogram, NativeHistogram or Summary, which observe
+/// the elapsed time in seconds, or a DurationHistogram, which observes it in
+/// integer nanoseconds. The time is measured with a Stopwatch.
+///
+/// Example usage:
+///
+/// \code
+/// void HandleRequest() {
+///   prometheus::ScopedTimer timer{request_duration};
+///   ...
+/// }
+/// \endcode
+class ScopedTimer {
+ public:
+  template <typename Metric>
+  explicit ScopedTimer(Metric& metric)
+      : metric_(&metric), observe_(&ObserveElapsed<Metric>) {}
+
+  ~ScopedTimer() { observe_(metric_, stopwatch_); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  using ObserveFunction = void (*)(void*, const Stopwatch&);
+
+  template <typename Metric>
+  static void ObserveElapsed(void* metric, const Stopwatch& stopwatch) {
+    Observe(*static_cast<Metric*>(metric), stopwatch);
+  }
+
+  template <typename Metric>
+  static void Observe(Metric& metric, const Stopwatch& stopwatch) {
+    metric.Observe(stopwatch.ElapsedSeconds());
+  }
+
+  static void Observe(DurationHistogram& histogram,
+                      const Stopwatch& stopwatch) {
+    histogram.Observe(stopwatch.Elapsed());
+  }
+
+  void* const metric_;
+  const ObserveFunction observe_;
+  const Stopwatch stopwatch_;
+};
+
+}  // namespace prometheus
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <ratio>
+#include <string>
+#include <type_traits>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/detail/builder.h"  // IWYU pragma: export
+#include "prometheus/detail/core_export.h"
+#include "prometheus/detail/future_std.h"
+#include "prometheus/family.h"
+#include "prometheus/labels.h"
+#include "prometheus/metric_type.h"
+#include "prometheus/registry.h"
+
+namespace prometheus {
+
+/// \brief Common interface of all StaticHistogram types.
+///
+/// A Family<StaticHistogramBase> holds static histograms of one bucket
+/// layout, as registered with BuildStaticHistogram().
+class PROMETHEUS_CPP_CORE_EXPORT StaticHistogramBase {
+ public:
+  static const MetricType metric_type{MetricType::Histogram};
+
+  virtual ~StaticHistogramBase();
+
+  /// \brief Observe the given amount, see Histogram::Observe().
+  virtual void Observe(double value) = 0;
+
+  /// \brief Reset all data points collected so far.
+  virtual void Reset() = 0;
+
+  /// \brief Get the current value of the histogram.
+  ///
+  /// Collect is called by the Registry when collecting metrics.
+  virtual ClientMetric Collect() const = 0;
+};
+
+namespace detail {
+
+template <typename... Bounds>
+struct IsStrictlyIncreasing : std::true_type {};
+
+template <typename First, typename Second, typename... Rest>
+struct IsStrictlyIncreasing<First, Second, Rest...>
+    : std::integral_constant<
+          bool, std::ratio_less<First, Second>::value &&
+                    IsStrictlyIncreasing<Second, Rest...>::value> {};
+
+// the address of the tag identifies the bucket boundaries of a family, the
+// reduced ratios make equal boundaries the same type
+template <typename... Bounds>
+struct StaticBucketsTag {
+  static const char tag;
+};
+
+template <typename... Bounds>
+const char StaticBucketsTag<Bounds...>::tag = 0;
+
+template <typename Ratio>
+constexpr double RatioValue() {
+  return static_cast<double>(Ratio::num) / static_cast<double>(Ratio::den);
+}
+
+}  // namespace detail
+
+/// \brief A histogram with bucket boundaries fixed at compile time.
+///
+/// The boundaries are given as std::ratio types, e.g.,
+/// StaticHistogram<std::milli, std::centi, std::deci, std::ratio<1>>, as
+/// C++11 does not allow floating point template arguments. The histogram is
+/// exposed exactly like a Histogram with the same boundaries.
+///
+/// The bucket lookup is unrolled at compile time into a sequence of
+/// comparisons without branches and the counts are stored in a fixed size
+/// array, i.e., Observe() never allocates. Calls through a StaticHistogram
+/// reference are not virtual as the class is final.
+///
+/// The class is thread-safe. No concurrent call to any API of this type causes
+/// a data race.
+template <typename... Bounds>
+class StaticHistogram final : public StaticHistogramBase {
+  static_assert(detail::IsStrictlyIncreasing<Bounds...>::value,
+                "Bucket Boundaries must be strictly sorted");
+
+ public:
+  static constexpr std::size_t kBucketCount = sizeof...(Bounds) + 1;
+
+  /// \brief Observe the given amount.
+  ///
+  /// The value is counted in the first bucket whose upper bound is greater or
+  /// equal than the value, NaN is counted in the first bucket.
+  void Observe(double value) override {
+    const auto bucket_index = Index(value);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sum_ += value;
+    bucket_counts_[bucket_index] += 1;
+  }
+
+  void Reset() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bucket_counts_.fill(0);
+    sum_ = 0;
+  }
+
+  ClientMetric Collect() const override {
+    static const double upper_bounds[kBucketCount] = {
+        detail::RatioValue<Bounds>()...,
+        std::numeric_limits<double>::infinity()};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto metric = ClientMetric{};
+    auto cumulative_count = std::uint64_t{0};
+    metric.histogram.bucket.reserve(kBucketCount);
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+      cumulative_count += bucket_counts_[i];
+      auto bucket = ClientMetric::Bucket{};
+      bucket.cumulative_count = cumulative_count;
+      bucket.upper_bound = upper_bounds[i];
+      metric.histogram.bucket.push_back(bucket);
+    }
+    metric.histogram.sample_count = cumulative_count;
+    metric.histogram.sample_sum = sum_;
+    return metric;
+  }
+
+ private:
+  // the number of boundaries less than the value, i.e., std::lower_bound
+  static std::size_t Index(double value) {
+    // unused without boundaries
+    (void)value;
+    std::size_t index = 0;
+    using expand = int[];
+    (void)expand{0, (index += (detail::RatioValue<Bounds>() < value), 0)...};
+    return index;
+  }
+
+  mutable std::mutex mutex_;
+  std::array<std::uint64_t, kBucketCount> bucket_counts_{};
+  double sum_ = 0.0;
+};
+
+template <typename... Bounds>
+constexpr std::size_t StaticHistogram<Bounds...>::kBucketCount;
+
+namespace detail {
+
+template <typename... Bounds>
+class Builder<StaticHistogram<Bounds...>> {
+ public:
+  Builder& Labels(const ::prometheus::Labels& labels) {
+    labels_ = labels;
+    return *this;
+  }
+
+  Builder& Name(const std::string& name) {
+    name_ = name;
+    return *this;
+  }
+
+  Builder& Help(const std::string& help) {
+    help_ = help;
+    return *this;
+  }
+
+  Family<StaticHistogramBase>& Register(Registry& registry) {
+    return registry.AddStaticHistogram(
+        name_, help_, labels_,
+        [] {
+          return std::unique_ptr<StaticHistogramBase>{
+              make_unique<StaticHistogram<Bounds...>>()};
+        },
+        &StaticBucketsTag<typename Bounds::type...>::tag);
+  }
+
+ private:
+  ::prometheus::Labels labels_;
+  std::string name_;
+  std::string help_;
+};
+
+}  // namespace detail
+
+/// \brief Return a builder to configure and register a StaticHistogram metric.
+///
+/// @copydetails Family<>::Family()
+///
+/// Example usage:
+///
+/// \code
+/// using Latency = prometheus::StaticHistogram<std::milli, std::centi,
+///                                             std::deci, std::ratio<1>>;
+///
+/// auto registry = std::make_shared<Registry>();
+/// auto& histogram_family = prometheus::BuildStaticHistogram<Latency>()
+///                              .Name("some_name")
+///                              .Help("Additional description.")
+///                              .Labels({{"key", "value"}})
+///                              .Register(*registry);
+/// auto& histogram =
+///     static_cast<Latency&>(histogram_family.Add({{"method", "GET"}}));
+/// ...
+/// \endcode
+///
+/// Family<StaticHistogramBase>::Add(const Labels&) creates histograms of
+/// type T. Registering a family with the same name and labels again returns
+/// the existing family if it has the same bucket boundaries and throws
+/// std::invalid_argument otherwise, so the cast above is always safe.
+///
+/// \return An object of unspecified type, i.e., an implementation detail
+/// except that it has the following members:
+///
+/// - Name(const std::string&) to set the metric name,
+/// - Help(const std::string&) to set an additional description.
+/// - Labels(const Labels&) to assign a set of
+///   key-value pairs (= labels) to the metric.
+///
+/// To finish the configuration of the StaticHistogram metric register it with
+/// Register(Registry&).
+template <typename T>
+detail::Builder<T> BuildStaticHistogram() {
+  static_assert(std::is_base_of<StaticHistogramBase, T>::value,
+                "T must be a StaticHistogram");
+  return {};
+}
+
+}  // namespace prometheus
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "prometheus/detail/tsc_clock.h"
+
+namespace prometheus {
+
+/// \brief Measures the time elapsed since it was started.
+///
+/// The stopwatch reads the calibrated time stamp counter where it is
+/// invariant, see detail::TscClock, and std::chrono::steady_clock otherwise.
+/// The clock is selected once per process, so a hot path pays neither for a
+/// system call nor for a check of the platform.
+///
+/// The first stopwatch of a process may block for a few milliseconds while
+/// the time stamp counter is calibrated.
+///
+/// Example usage:
+///
+/// \code
+/// prometheus::Stopwatch stopwatch;
+/// DoWork();
+/// histogram.Observe(stopwatch.ElapsedSeconds());
+/// \endcode
+///
+/// See ScopedTimer for observing the lifetime of a scope.
+class Stopwatch {
+ public:
+  Stopwatch() : calibration_(&detail::TscClock::GetCalibration()) { Restart(); }
+
+  /// \brief Start measuring anew from now.
+  void Restart() {
+    if (calibration_->available) {
+      start_ticks_ = detail::TscClock::Ticks();
+    } else {
+      start_time_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  /// \brief Get the time elapsed since construction or the last Restart().
+  std::chrono::nanoseconds Elapsed() const {
+    if (calibration_->available) {
+      // counters of different cores may be off by a few ticks
+      const auto ticks =
+          static_cast<std::int64_t>(detail::TscClock::Ticks() - start_ticks_);
+      return std::chrono::nanoseconds{
+          ticks > 0 ? static_cast<std::int64_t>(
+                          static_cast<double>(ticks) *
+                          calibration_->nanoseconds_per_tick)
+                    : 0};
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time_);
+  }
+
+  /// \brief Get the time elapsed in seconds, the base unit of Prometheus.
+  double ElapsedSeconds() const {
+    return std::chrono::duration<double>(Elapsed()).count();
+  }
+
+ private:
+  const detail::TscClock::Calibration* calibration_;
+  std::uint64_t start_ticks_{};
+  std::chrono::steady_clock::time_point start_time_{};
+};
+
+}  // namespace prometheus
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include "prometheus/client_metric.h"
+#include "prometheus/clock_source.h"
 #include "prometheus/detail/builder.h"  // IWYU pragma: export
 #include "prometheus/detail/ckms_quantiles.h"
 #include "prometheus/detail/core_export.h"
@@ -41,6 +45,7 @@ namespace prometheus {
 class PROMETHEUS_CPP_CORE_EXPORT Summary {
  public:
   using Quantiles = std::vector<detail::CKMSQuantiles::Quantile>;
+  using ClockSource = prometheus::ClockSource;
 
   static const MetricType metric_type{MetricType::Summary};
 
@@ -80,20 +85,99 @@ class PROMETHEUS_CPP_CORE_EXPORT Summary {
                    std::chrono::milliseconds max_age = std::chrono::seconds{60},
                    int age_buckets = 5);
 
+  /// \brief Create a summary metric sharing its quantile definitions.
+  ///
+  /// Intended for families with many children: all summaries created from
+  /// the same pointer share one immutable list of quantiles instead of
+  /// holding a copy each.
+  ///
+  /// \param quantiles See Summary::Summary(const Quantiles&,
+  /// std::chrono::milliseconds,int). Must not be null.
+  /// \param max_age See Summary::Summary(const Quantiles&,
+  /// std::chrono::milliseconds,int).
+  /// \param age_buckets See Summary::Summary(const Quantiles&,
+  /// std::chrono::milliseconds,int).
+  /// \param buffer_size Number of observations buffered per age bucket before
+  /// they are merged into the quantile estimation. The buffers are only
+  /// allocated on the first observation. Smaller values reduce the memory of
+  /// an active summary at the cost of merging more often. The default value
+  /// is 500.
+  /// \param clock_source Clock used to decide when to switch age buckets.
+  /// ClockSource::Coarse avoids a full clock read on every observation, in
+  /// exchange the buckets are switched up to a few milliseconds late. The
+  /// default value is ClockSource::Steady.
+  /// \throw std::invalid_argument if quantiles is null or buffer_size is 0.
+  explicit Summary(
+      std::shared_ptr<const Quantiles> quantiles,
+      std::chrono::milliseconds max_age = std::chrono::seconds{60},
+      int age_buckets = 5,
+      std::size_t buffer_size = detail::CKMSQuantiles::kDefaultBufferSize,
+      ClockSource clock_source = ClockSource::Steady);
+
   /// \brief Observe the given amount.
   void Observe(double value);
 
+  /// \brief Observe the given amount count times.
+  ///
+  /// Equivalent to count calls of Observe(value), e.g., to ingest
+  /// pre-aggregated data, but the cost does not depend on count: the value
+  /// enters the quantile estimation once with a weight of count. Unlike
+  /// Observe(double), it is not buffered and waits for a running Collect().
+  void Observe(double value, std::uint64_t count);
+
   /// \brief Get the current value of the summary.
   ///
   /// Collect is called by the Registry when collecting metrics.
   ClientMetric Collect() const;
 
+  /// \brief Export the state of the summary as a compact binary blob.
+  ///
+  /// The blob contains the total count and sum of observations and the
+  /// quantile estimation over the current time window. It can be merged into
+  /// another summary with Merge(), e.g., to combine summaries observed in
+  /// separate processes into quantiles over all observations.
+  ///
+  /// The format is independent of the byte order of the host.
+  std::string Snapshot() const;
+
+  /// \brief Merge a blob created by Snapshot() into this summary.
+  ///
+  /// The count and sum are added, and the merged observations become part of
+  /// every age bucket, i.e., they age out like local observations. The
+  /// quantile estimation keeps the error guarantees of this summary's
+  /// quantiles, but merging sketches with larger tolerated errors makes the
+  /// result less accurate.
+  ///
+  /// To expose the combined quantiles of several shards, create a new summary
+  /// at collect time and merge the latest blob of every shard into it.
+  /// Merging the same blob repeatedly counts its observations repeatedly.
+  ///
+  /// \throw std::invalid_argument if the blob is malformed.
+  void Merge(const std::string& snapshot);
+
+  /// \brief Get the approximate number of bytes used by this summary.
+  ///
+  /// Includes the object itself and all memory owned by it, but not the
+  /// quantile definitions when they are shared with other summaries.
+  std::size_t MemoryUsage() const;
+
  private:
-  Quantiles quantiles_;
+  void FlushPending() const;
+
+  std::shared_ptr<const Quantiles> quantiles_;
+  const std::size_t buffer_size_;
+
+  // Observers only hold mutex_ while buffering into pending_. The expensive
+  // quantile maintenance runs under quantile_mutex_ on a swapped out buffer,
+  // so collecting does not block observers.
   mutable std::mutex mutex_;
   std::uint64_t count_{};
   double sum_{};
-  detail::TimeWindowQuantiles quantile_values_;
+  mutable std::vector<double> pending_;
+
+  mutable std::mutex quantile_mutex_;
+  mutable std::vector<double> flushing_;
+  mutable detail::TimeWindowQuantiles quantile_values_;
 };
 
 /// \brief Return a builder to configure and register a Summary metric.
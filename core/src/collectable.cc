@@ -0,0 +1,24 @@
+#include "prometheus/collectable.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "prometheus/metric_family.h"
+#include "prometheus/metric_filter.h"
+
+namespace prometheus {
+
+std::vector<MetricFamily> Collectable::CollectMatching(
+    const MetricFilter& filter) const {
+  auto families = Collect();
+  if (!filter.Empty()) {
+    families.erase(std::remove_if(std::begin(families), std::end(families),
+                                  [&filter](const MetricFamily& family) {
+                                    return !filter.Matches(family.name);
+                                  }),
+                   std::end(families));
+  }
+  return families;
+}
+
+}  // namespace prometheus
@@ -0,0 +1,158 @@
+#include "prometheus/detail/bucket_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace prometheus {
+namespace detail {
+
+namespace {
+
+// maximum relative deviation of a boundary from the detected layout
+const double kTolerance = 1e-9;
+
+bool IsClose(double actual, double expected, double magnitude) {
+  return std::abs(actual - expected) <= kTolerance * magnitude;
+}
+
+}  // namespace
+
+struct BucketLayout::Data {
+  enum class Kind { Generic, Linear, Exponential };
+
+  explicit Data(std::vector<double> b) : boundaries(std::move(b)) {}
+
+  std::vector<double> boundaries;
+  Kind kind = Kind::Generic;
+  double offset = 0.0;
+  double scale = 0.0;
+};
+
+BucketLayout::BucketLayout(std::vector<double> boundaries) {
+  if (std::adjacent_find(boundaries.begin(), boundaries.end(),
+                         std::greater_equal<double>()) != boundaries.end()) {
+    throw std::invalid_argument("Bucket Boundaries must be strictly sorted");
+  }
+
+  auto data = std::make_shared<Data>(std::move(boundaries));
+  data_ = data;
+
+  const auto& bounds = data->boundaries;
+  const auto n = bounds.size();
+  if (n < 3 || !std::isfinite(bounds.front()) ||
+      !std::isfinite(bounds.back())) {
+    return;
+  }
+
+  const auto first = bounds.front();
+  const auto last = bounds.back();
+
+  const auto width = (last - first) / (n - 1);
+  auto linear = true;
+  for (std::size_t i = 1; linear && i < n - 1; ++i) {
+    const auto expected = first + i * width;
+    linear = IsClose(bounds[i], expected, std::max(std::abs(expected), width));
+  }
+  if (linear) {
+    data->kind = Data::Kind::Linear;
+    data->offset = first;
+    data->scale = 1.0 / width;
+    return;
+  }
+
+  if (first <= 0) {
+    return;
+  }
+  const auto log_factor = (std::log2(last) - std::log2(first)) / (n - 1);
+  auto exponential = true;
+  for (std::size_t i = 1; exponential && i < n - 1; ++i) {
+    const auto expected = first * std::exp2(i * log_factor);
+    exponential = IsClose(bounds[i], expected, expected);
+  }
+  if (exponential) {
+    data->kind = Data::Kind::Exponential;
+    data->offset = std::log2(first);
+    data->scale = 1.0 / log_factor;
+  }
+}
+
+std::size_t BucketLayout::Index(const double value) const {
+  const auto& data = *data_;
+  switch (data.kind) {
+    case Data::Kind::Linear:
+      return Correct(std::ceil((value - data.offset) * data.scale), value);
+    case Data::Kind::Exponential:
+      if (!(value > data.boundaries.front())) {
+        return 0;
+      }
+      return Correct(std::ceil((std::log2(value) - data.offset) * data.scale),
+                     value);
+    case Data::Kind::Generic:
+      break;
+  }
+  return Search(value);
+}
+
+const std::vector<double>& BucketLayout::Boundaries() const {
+  return data_->boundaries;
+}
+
+std::size_t BucketLayout::BucketCount() const {
+  return data_->boundaries.size() + 1;
+}
+
+bool BucketLayout::IsLinear() const {
+  return data_->kind == Data::Kind::Linear;
+}
+
+bool BucketLayout::IsExponential() const {
+  return data_->kind == Data::Kind::Exponential;
+}
+
+std::size_t BucketLayout::Search(const double value) const {
+  const auto& boundaries = data_->boundaries;
+  const auto* const data = boundaries.data();
+  auto size = boundaries.size();
+  if (size == 0) {
+    return 0;
+  }
+
+  // lower bound without a data dependent branch, compiled to a cmov
+  const auto* base = data;
+  while (size > 1) {
+    const auto half = size / 2;
+    base = base[half] < value ? base + half : base;
+    size -= half;
+  }
+  return static_cast<std::size_t>(base - data) + (*base < value);
+}
+
+std::size_t BucketLayout::Correct(const double estimate,
+                                  const double value) const {
+  const auto& boundaries = data_->boundaries;
+  const auto n = boundaries.size();
+
+  // also maps NaN to the first bucket
+  auto index = std::size_t{0};
+  if (estimate >= static_cast<double>(n)) {
+    index = n;
+  } else if (estimate > 0) {
+    index = static_cast<std::size_t>(estimate);
+  }
+
+  // rounding errors move the estimate at most by one bucket
+  while (index < n && boundaries[index] < value) {
+    ++index;
+  }
+  while (index > 0 && !(boundaries[index - 1] < value)) {
+    --index;
+  }
+  return index;
+}
+
+}  // namespace detail
+}  // namespace prometheus
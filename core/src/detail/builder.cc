@@ -1,10 +1,19 @@
 #include "prometheus/detail/builder.h"
 
+#include <stdexcept>
+#include <utility>
+
 #include "prometheus/counter.h"
+#include "prometheus/detail/bucket_layout.h"
 #include "prometheus/detail/core_export.h"
+#include "prometheus/detail/future_std.h"
+#include "prometheus/duration_histogram.h"
+#include "prometheus/family.h"
 #include "prometheus/gauge.h"
+#include "prometheus/hdr_histogram.h"
 #include "prometheus/histogram.h"
 #include "prometheus/info.h"
+#include "prometheus/native_histogram.h"
 #include "prometheus/registry.h"
 #include "prometheus/summary.h"
 
@@ -36,17 +45,76 @@ Family<T>& Builder<T>::Register(Registry& registry) {
 }
 
 template class PROMETHEUS_CPP_CORE_EXPORT Builder<Counter>;
+template class PROMETHEUS_CPP_CORE_EXPORT Builder<DurationHistogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Builder<Gauge>;
-template class PROMETHEUS_CPP_CORE_EXPORT Builder<Histogram>;
+template class PROMETHEUS_CPP_CORE_EXPORT Builder<HdrHistogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Builder<Info>;
+template class PROMETHEUS_CPP_CORE_EXPORT Builder<NativeHistogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Builder<Summary>;
 
+Builder<Histogram>& Builder<Histogram>::Labels(
+    const ::prometheus::Labels& labels) {
+  labels_ = labels;
+  return *this;
+}
+
+Builder<Histogram>& Builder<Histogram>::Name(const std::string& name) {
+  name_ = name;
+  return *this;
+}
+
+Builder<Histogram>& Builder<Histogram>::Help(const std::string& help) {
+  help_ = help;
+  return *this;
+}
+
+Builder<Histogram>& Builder<Histogram>::Buckets(
+    std::vector<double> bucket_boundaries) {
+  layout_ = std::make_shared<const BucketLayout>(std::move(bucket_boundaries));
+  return *this;
+}
+
+Builder<Histogram>& Builder<Histogram>::Shards(const std::size_t shards) {
+  sharded_ = true;
+  shards_ = shards;
+  return *this;
+}
+
+Family<Histogram>& Builder<Histogram>::Register(Registry& registry) {
+  if (sharded_ && !layout_) {
+    throw std::invalid_argument("Sharded histograms require Buckets()");
+  }
+  auto factory = Family<Histogram>::Factory{};
+  if (layout_ && sharded_) {
+    const auto layout = *layout_;
+    const auto shards = shards_;
+    factory = [layout, shards] {
+      return make_unique<Histogram>(layout, shards);
+    };
+  } else if (layout_) {
+    const auto layout = *layout_;
+    factory = [layout] { return make_unique<Histogram>(layout); };
+  }
+  auto layout = Registry::HistogramLayout{};
+  layout.has_buckets = layout_ != nullptr;
+  if (layout_) {
+    layout.boundaries = layout_->Boundaries();
+  }
+  layout.sharded = sharded_;
+  layout.shards = shards_;
+  return registry.AddHistogram(name_, help_, labels_, std::move(factory),
+                               std::move(layout));
+}
+
 }  // namespace detail
 
 detail::Builder<Counter> BuildCounter() { return {}; }
+detail::Builder<DurationHistogram> BuildDurationHistogram() { return {}; }
 detail::Builder<Gauge> BuildGauge() { return {}; }
+detail::Builder<HdrHistogram> BuildHdrHistogram() { return {}; }
 detail::Builder<Histogram> BuildHistogram() { return {}; }
 detail::Builder<Info> BuildInfo() { return {}; }
+detail::Builder<NativeHistogram> BuildNativeHistogram() { return {}; }
 detail::Builder<Summary> BuildSummary() { return {}; }
 
 }  // namespace prometheus
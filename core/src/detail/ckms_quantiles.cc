@@ -2,8 +2,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <stdexcept>
 
 namespace prometheus {
 namespace detail {
@@ -14,22 +16,51 @@ CKMSQuantiles::Quantile::Quantile(double quantile, double error)
       u(2.0 * error / (1.0 - quantile)),
       v(2.0 * error / quantile) {}
 
-CKMSQuantiles::Item::Item(double value, int lower_delta, int delta)
+CKMSQuantiles::Item::Item(double value, std::int64_t lower_delta,
+                          std::int64_t delta)
     : value(value), g(lower_delta), delta(delta) {}
 
-CKMSQuantiles::CKMSQuantiles(const std::vector<Quantile>& quantiles)
-    : quantiles_(quantiles), count_(0), buffer_{}, buffer_count_(0) {}
+const std::size_t CKMSQuantiles::kDefaultBufferSize;
+
+CKMSQuantiles::CKMSQuantiles(const std::vector<Quantile>& quantiles,
+                             std::size_t buffer_size)
+    : quantiles_(quantiles),
+      count_(0),
+      buffer_size_(buffer_size),
+      uncompressed_(0) {
+  if (buffer_size_ == 0) {
+    throw std::invalid_argument("Buffer size must be greater than zero");
+  }
+}
 
 void CKMSQuantiles::insert(double value) {
-  buffer_[buffer_count_] = value;
-  ++buffer_count_;
+  if (buffer_.capacity() < buffer_size_) {
+    buffer_.reserve(buffer_size_);
+  }
+  buffer_.push_back(value);
 
-  if (buffer_count_ == buffer_.size()) {
+  if (buffer_.size() == buffer_size_) {
     insertBatch();
     compress();
   }
 }
 
+void CKMSQuantiles::insert(double value, std::size_t weight) {
+  const auto max_weight =
+      static_cast<std::size_t>(std::numeric_limits<std::int64_t>::max());
+  while (weight > 0) {
+    const auto item_weight = std::min(weight, max_weight);
+    insertWeighted(value, static_cast<std::int64_t>(item_weight));
+    weight -= item_weight;
+  }
+
+  // compress as often as for buffered values, the items are inserted right
+  // away
+  if (++uncompressed_ >= buffer_size_) {
+    compress();
+  }
+}
+
 double CKMSQuantiles::get(double q) {
   insertBatch();
   compress();
@@ -38,8 +69,8 @@ double CKMSQuantiles::get(double q) {
     return std::numeric_limits<double>::quiet_NaN();
   }
 
-  int rankMin = 0;
-  const auto desired = static_cast<int>(q * count_);
+  std::int64_t rankMin = 0;
+  const auto desired = static_cast<std::int64_t>(q * count_);
   const auto bound = desired + (allowableError(desired) / 2);
 
   auto it = sample_.begin();
@@ -52,7 +83,7 @@ double CKMSQuantiles::get(double q) {
 
     rankMin += prev->g;
 
-    if (rankMin + cur->g + cur->delta > bound) {
+    if (static_cast<double>(rankMin + cur->g + cur->delta) > bound) {
       return prev->value;
     }
   }
@@ -63,10 +94,66 @@ double CKMSQuantiles::get(double q) {
 void CKMSQuantiles::reset() {
   count_ = 0;
   sample_.clear();
-  buffer_count_ = 0;
+  buffer_.clear();
+  uncompressed_ = 0;
+}
+
+void CKMSQuantiles::insertSorted(const std::vector<double>& values) {
+  mergeSorted(values);
+  compress();
+}
+
+const std::vector<CKMSQuantiles::Item>& CKMSQuantiles::snapshot() {
+  insertBatch();
+  compress();
+  return sample_;
+}
+
+void CKMSQuantiles::merge(const std::vector<Item>& items) {
+  if (items.empty()) {
+    return;
+  }
+
+  insertBatch();
+
+  // Every item keeps its own g. Its delta grows by the rank uncertainty of
+  // its successor in the other list, see Agarwal et al., "Mergeable
+  // Summaries", 2012.
+  const auto successor_error = [](const std::vector<Item>& other,
+                                  std::size_t index) {
+    return index < other.size() ? other[index].g + other[index].delta - 1
+                                : std::int64_t{0};
+  };
+
+  std::vector<Item> merged;
+  merged.reserve(sample_.size() + items.size());
+
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < sample_.size() || j < items.size()) {
+    if (j == items.size() ||
+        (i < sample_.size() && sample_[i].value <= items[j].value)) {
+      merged.push_back(sample_[i]);
+      merged.back().delta += successor_error(items, j);
+      ++i;
+    } else {
+      merged.push_back(items[j]);
+      merged.back().delta += successor_error(sample_, i);
+      count_ += static_cast<std::size_t>(items[j].g);
+      ++j;
+    }
+  }
+
+  sample_.swap(merged);
+  compress();
+}
+
+std::size_t CKMSQuantiles::memoryUsage() const {
+  return buffer_.capacity() * sizeof(double) +
+         sample_.capacity() * sizeof(Item);
 }
 
-double CKMSQuantiles::allowableError(int rank) {
+double CKMSQuantiles::allowableError(std::int64_t rank) {
   auto size = sample_.size();
   double minError = size + 1;
 
@@ -86,15 +173,25 @@ double CKMSQuantiles::allowableError(int rank) {
 }
 
 bool CKMSQuantiles::insertBatch() {
-  if (buffer_count_ == 0) {
+  if (buffer_.empty()) {
     return false;
   }
 
-  std::sort(buffer_.begin(), buffer_.begin() + buffer_count_);
+  std::sort(buffer_.begin(), buffer_.end());
+  mergeSorted(buffer_);
+
+  buffer_.clear();
+  return true;
+}
+
+void CKMSQuantiles::mergeSorted(const std::vector<double>& values) {
+  if (values.empty()) {
+    return;
+  }
 
   std::size_t start = 0;
   if (sample_.empty()) {
-    sample_.emplace_back(buffer_[0], 1, 0);
+    sample_.emplace_back(values[0], 1, 0);
     ++start;
     ++count_;
   }
@@ -102,8 +199,8 @@ bool CKMSQuantiles::insertBatch() {
   std::size_t idx = 0;
   std::size_t item = idx++;
 
-  for (std::size_t i = start; i < buffer_count_; ++i) {
-    double v = buffer_[i];
+  for (std::size_t i = start; i < values.size(); ++i) {
+    double v = values[i];
     while (idx < sample_.size() && sample_[item].value < v) {
       item = idx++;
     }
@@ -112,23 +209,44 @@ bool CKMSQuantiles::insertBatch() {
       --idx;
     }
 
-    int delta;
+    std::int64_t delta;
     if (idx - 1 == 0 || idx + 1 == sample_.size()) {
       delta = 0;
     } else {
-      delta = static_cast<int>(std::floor(allowableError(idx + 1))) + 1;
+      delta =
+          static_cast<std::int64_t>(std::floor(allowableError(idx + 1))) + 1;
     }
 
     sample_.emplace(sample_.begin() + idx, v, 1, delta);
     count_++;
     item = idx++;
   }
+}
 
-  buffer_count_ = 0;
-  return true;
+void CKMSQuantiles::insertWeighted(double value, std::int64_t weight) {
+  const auto it = std::upper_bound(
+      sample_.begin(), sample_.end(), value,
+      [](double v, const Item& item) { return v < item.value; });
+  const auto idx = static_cast<std::size_t>(it - sample_.begin());
+
+  std::int64_t delta = 0;
+  if (idx != 0 && idx != sample_.size()) {
+    delta = static_cast<std::int64_t>(std::floor(allowableError(idx + 1))) + 1;
+  }
+
+  // An item stands for the ranks since its predecessor, but get() answers
+  // with the predecessor for all of them. The first item pins the lowest rank
+  // of the repeated value, the second one covers the remaining ranks.
+  const auto first = sample_.emplace(it, value, 1, delta);
+  if (weight > 1) {
+    sample_.emplace(first + 1, value, weight - 1, delta);
+  }
+  count_ += static_cast<std::size_t>(weight);
 }
 
 void CKMSQuantiles::compress() {
+  uncompressed_ = 0;
+
   if (sample_.size() < 2) {
     return;
   }
@@ -141,7 +259,9 @@ void CKMSQuantiles::compress() {
     prev = next;
     next = idx++;
 
-    if (sample_[prev].g + sample_[next].g + sample_[next].delta <=
+    // summed as doubles, two items of large weight exceed the integer range
+    if (static_cast<double>(sample_[prev].g) + sample_[next].g +
+            sample_[next].delta <=
         allowableError(idx - 1)) {
       sample_[next].g += sample_[prev].g;
       sample_.erase(sample_.begin() + prev);
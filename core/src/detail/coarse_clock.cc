@@ -0,0 +1,35 @@
+#include "prometheus/detail/coarse_clock.h"
+
+#include <time.h>
+
+namespace prometheus {
+namespace detail {
+
+namespace {
+
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+#define PROMETHEUS_CPP_HAVE_COARSE_CLOCK 1
+
+template <typename Duration>
+Duration ReadClock(clockid_t clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return std::chrono::duration_cast<Duration>(
+      std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec});
+}
+#endif
+
+}  // namespace
+
+const bool CoarseSteadyClock::is_steady;
+
+CoarseSteadyClock::time_point CoarseSteadyClock::now() noexcept {
+#ifdef PROMETHEUS_CPP_HAVE_COARSE_CLOCK
+  return time_point{ReadClock<duration>(CLOCK_MONOTONIC_COARSE)};
+#else
+  return std::chrono::steady_clock::now();
+#endif
+}
+
+}  // namespace detail
+}  // namespace prometheus
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace prometheus {
+
+namespace detail {
+
+/// \brief Append an unsigned integer in base 128 varint encoding.
+///
+/// \param out The string to append to.
+/// \param value The value to encode.
+inline void AppendVarint(std::string* out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+/// \brief Append a double as 8 bytes in little endian byte order.
+///
+/// \param out The string to append to.
+/// \param value The value to encode.
+inline void AppendDouble(std::string* out, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  for (int i = 0; i < 8; ++i) {
+    out->push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+  }
+}
+
+/// \brief Sequential reader for data written by AppendVarint() and
+/// AppendDouble().
+///
+/// All read functions throw std::invalid_argument if the input is truncated
+/// or malformed.
+class Decoder {
+ public:
+  Decoder(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+  bool Done() const { return pos_ == size_; }
+
+  std::uint64_t ReadVarint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const auto byte = static_cast<unsigned char>(Next());
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw std::invalid_argument("Malformed varint");
+  }
+
+  double ReadDouble() {
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+      bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(Next()))
+              << (8 * i);
+    }
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+ private:
+  char Next() {
+    if (pos_ >= size_) {
+      throw std::invalid_argument("Unexpected end of input");
+    }
+    return data_[pos_++];
+  }
+
+  const char* data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+};
+
+}  // namespace detail
+
+}  // namespace prometheus
@@ -0,0 +1,116 @@
+#include "prometheus/detail/sharded_buckets.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace prometheus {
+namespace detail {
+
+namespace {
+
+// conservative guess, std::hardware_destructive_interference_size is C++17
+const std::size_t kCacheLineSize = 64;
+const std::size_t kEntriesPerCacheLine =
+    kCacheLineSize / sizeof(std::atomic<std::uint64_t>);
+
+// the sum is stored as the bit pattern of the double after the bucket counts
+std::uint64_t ToBits(const double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double FromBits(const std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+std::size_t DefaultShardCount() {
+  const auto hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+// assigns consecutive numbers to threads in the order of their first
+// observation, which spreads concurrently started threads over all shards
+std::size_t ThreadNumber() {
+  static std::atomic<std::size_t> next_thread_number{0};
+  thread_local const auto thread_number =
+      next_thread_number.fetch_add(1, std::memory_order_relaxed);
+  return thread_number;
+}
+
+}  // namespace
+
+ShardedBuckets::ShardedBuckets(const std::size_t bucket_count,
+                               const std::size_t shard_count)
+    : bucket_count_{bucket_count},
+      shard_count_{shard_count > 0 ? shard_count : DefaultShardCount()},
+      stride_{(bucket_count + 1 + kEntriesPerCacheLine - 1) /
+              kEntriesPerCacheLine * kEntriesPerCacheLine},
+      storage_{new std::atomic<std::uint64_t>[stride_ * shard_count_ +
+                                              kEntriesPerCacheLine - 1]} {
+  const auto address = reinterpret_cast<std::uintptr_t>(storage_.get());
+  const auto misalignment = address % kCacheLineSize;
+  shards_ = storage_.get() +
+            (misalignment == 0 ? 0
+                               : (kCacheLineSize - misalignment) /
+                                     sizeof(std::atomic<std::uint64_t>));
+  Reset();
+}
+
+void ShardedBuckets::Increment(const std::size_t bucket,
+                               const std::uint64_t count) {
+  Shard()[bucket].fetch_add(count, std::memory_order_relaxed);
+}
+
+void ShardedBuckets::IncrementSum(const double value) {
+  auto& sum = Shard()[bucket_count_];
+  auto current = sum.load(std::memory_order_relaxed);
+  // rarely contended as long as there are no more threads than shards
+  while (!sum.compare_exchange_weak(current,
+                                    ToBits(FromBits(current) + value),
+                                    std::memory_order_relaxed)) {
+    // intentionally empty block
+  }
+}
+
+void ShardedBuckets::Reset() {
+  for (std::size_t shard = 0; shard < shard_count_; ++shard) {
+    auto* const entries = shards_ + shard * stride_;
+    for (std::size_t i = 0; i < bucket_count_; ++i) {
+      entries[i].store(0, std::memory_order_relaxed);
+    }
+    entries[bucket_count_].store(ToBits(0.0), std::memory_order_relaxed);
+  }
+}
+
+std::size_t ShardedBuckets::ShardCount() const { return shard_count_; }
+
+std::vector<std::uint64_t> ShardedBuckets::Counts() const {
+  auto counts = std::vector<std::uint64_t>(bucket_count_);
+  for (std::size_t shard = 0; shard < shard_count_; ++shard) {
+    const auto* const entries = shards_ + shard * stride_;
+    for (std::size_t i = 0; i < bucket_count_; ++i) {
+      counts[i] += entries[i].load(std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+double ShardedBuckets::Sum() const {
+  auto sum = 0.0;
+  for (std::size_t shard = 0; shard < shard_count_; ++shard) {
+    const auto& entry = shards_[shard * stride_ + bucket_count_];
+    sum += FromBits(entry.load(std::memory_order_relaxed));
+  }
+  return sum;
+}
+
+std::atomic<std::uint64_t>* ShardedBuckets::Shard() {
+  return shards_ + (ThreadNumber() % shard_count_) * stride_;
+}
+
+}  // namespace detail
+}  // namespace prometheus
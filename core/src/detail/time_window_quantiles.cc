@@ -8,11 +8,14 @@ namespace detail {
 
 TimeWindowQuantiles::TimeWindowQuantiles(
     const std::vector<CKMSQuantiles::Quantile>& quantiles,
-    const Clock::duration max_age, const int age_buckets)
+    const Clock::duration max_age, const int age_buckets,
+    const std::size_t buffer_size, const ClockSource clock_source)
     : quantiles_(quantiles),
-      ckms_quantiles_(age_buckets, CKMSQuantiles(quantiles_)),
+      ckms_quantiles_(age_buckets, CKMSQuantiles(quantiles_, buffer_size)),
       current_bucket_(0),
-      last_rotation_(Clock::now()),
+      now_(clock_source == ClockSource::Coarse ? &CoarseSteadyClock::now
+                                               : &Clock::now),
+      last_rotation_(now_()),
       rotation_interval_(max_age / age_buckets) {}
 
 double TimeWindowQuantiles::get(double q) const {
@@ -27,8 +30,43 @@ void TimeWindowQuantiles::insert(double value) {
   }
 }
 
+void TimeWindowQuantiles::insert(double value, std::size_t weight) {
+  rotate();
+  for (auto& bucket : ckms_quantiles_) {
+    bucket.insert(value, weight);
+  }
+}
+
+void TimeWindowQuantiles::insertSorted(const std::vector<double>& values) {
+  rotate();
+  for (auto& bucket : ckms_quantiles_) {
+    bucket.insertSorted(values);
+  }
+}
+
+std::vector<CKMSQuantiles::Item> TimeWindowQuantiles::snapshot() const {
+  CKMSQuantiles& current_bucket = rotate();
+  return current_bucket.snapshot();
+}
+
+void TimeWindowQuantiles::merge(
+    const std::vector<CKMSQuantiles::Item>& items) {
+  rotate();
+  for (auto& bucket : ckms_quantiles_) {
+    bucket.merge(items);
+  }
+}
+
+std::size_t TimeWindowQuantiles::memoryUsage() const {
+  auto bytes = ckms_quantiles_.capacity() * sizeof(CKMSQuantiles);
+  for (const auto& bucket : ckms_quantiles_) {
+    bytes += bucket.memoryUsage();
+  }
+  return bytes;
+}
+
 CKMSQuantiles& TimeWindowQuantiles::rotate() const {
-  auto delta = Clock::now() - last_rotation_;
+  auto delta = now_() - last_rotation_;
   while (delta > rotation_interval_) {
     ckms_quantiles_[current_bucket_].reset();
 
@@ -0,0 +1,76 @@
+#include "prometheus/detail/tsc_clock.h"
+
+#include <chrono>
+
+#ifdef PROMETHEUS_CPP_HAVE_TSC
+#include <cpuid.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#endif
+
+namespace prometheus {
+namespace detail {
+
+namespace {
+
+#ifdef PROMETHEUS_CPP_HAVE_TSC
+const auto kCalibrationTime = std::chrono::milliseconds{10};
+
+// CPUID.80000007H:EDX[8], see Intel SDM Vol. 3B 17.17.1
+bool HasInvariantTsc() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (edx & (1U << 8)) != 0;
+}
+
+// the kernel drops the TSC as clock source if it detects unsynchronized or
+// unstable counters, e.g., on some virtual machines
+bool KernelUsesTsc() {
+  std::ifstream file{
+      "/sys/devices/system/clocksource/clocksource0/current_clocksource"};
+  std::string clock_source;
+  return (file >> clock_source) && clock_source == "tsc";
+}
+#endif
+
+TscClock::Calibration Calibrate() {
+  auto calibration = TscClock::Calibration{false, 0.0};
+#ifdef PROMETHEUS_CPP_HAVE_TSC
+  if (!HasInvariantTsc() || !KernelUsesTsc()) {
+    return calibration;
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto start_ticks = TscClock::Ticks();
+  std::this_thread::sleep_for(kCalibrationTime);
+  const auto end_ticks = TscClock::Ticks();
+  const auto end_time = std::chrono::steady_clock::now();
+
+  const auto ticks = end_ticks - start_ticks;
+  const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               end_time - start_time)
+                               .count();
+  if (ticks == 0 || nanoseconds <= 0) {
+    return calibration;
+  }
+
+  calibration.available = true;
+  calibration.nanoseconds_per_tick =
+      static_cast<double>(nanoseconds) / static_cast<double>(ticks);
+#endif
+  return calibration;
+}
+
+}  // namespace
+
+const TscClock::Calibration& TscClock::GetCalibration() {
+  static const auto calibration = Calibrate();
+  return calibration;
+}
+
+}  // namespace detail
+}  // namespace prometheus
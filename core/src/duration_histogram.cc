@@ -0,0 +1,112 @@
+#include "prometheus/duration_histogram.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace prometheus {
+
+namespace {
+
+const double kNanosecondsPerSecond = 1e9;
+const std::int64_t kNanosecondsPerWholeSecond = 1000000000;
+// the nanosecond sum is carried into the seconds in steps of this, which
+// keeps the common case at a single fetch_add
+const std::int64_t kCarrySeconds = 1000;
+const std::int64_t kCarryNanoseconds =
+    kCarrySeconds * kNanosecondsPerWholeSecond;
+
+}  // namespace
+
+DurationHistogram::DurationHistogram(const BucketBoundaries& buckets)
+    : bucket_counts_{new std::atomic<std::uint64_t>[buckets.size() + 1]} {
+  bucket_boundaries_.reserve(buckets.size());
+  for (const auto& bucket : buckets) {
+    bucket_boundaries_.push_back(bucket.count());
+  }
+  if (std::adjacent_find(bucket_boundaries_.begin(), bucket_boundaries_.end(),
+                         std::greater_equal<std::int64_t>()) !=
+      bucket_boundaries_.end()) {
+    throw std::invalid_argument("Bucket Boundaries must be strictly sorted");
+  }
+  Reset();
+}
+
+void DurationHistogram::Observe(const std::chrono::nanoseconds duration) {
+  ObserveNanoseconds(duration.count());
+}
+
+void DurationHistogram::ObserveNanoseconds(const std::int64_t nanoseconds) {
+  // lower bound without a data dependent branch, see detail::BucketLayout
+  const auto* const data = bucket_boundaries_.data();
+  auto size = bucket_boundaries_.size();
+  auto bucket_index = std::size_t{0};
+  if (size > 0) {
+    const auto* base = data;
+    while (size > 1) {
+      const auto half = size / 2;
+      base = base[half] < nanoseconds ? base + half : base;
+      size -= half;
+    }
+    bucket_index =
+        static_cast<std::size_t>(base - data) + (*base < nanoseconds);
+  }
+
+  bucket_counts_[bucket_index].fetch_add(1, std::memory_order_relaxed);
+
+  // Concurrent observers may both carry the same step, which leaves the
+  // nanoseconds below zero for a moment. The total stays exact either way.
+  auto seconds = std::int64_t{0};
+  auto remainder = nanoseconds;
+  if (nanoseconds >= kCarryNanoseconds || nanoseconds <= -kCarryNanoseconds) {
+    seconds = nanoseconds / kNanosecondsPerWholeSecond;
+    remainder = nanoseconds % kNanosecondsPerWholeSecond;
+  }
+  const auto sum = remainder + sum_nanoseconds_.fetch_add(
+                                   remainder, std::memory_order_relaxed);
+  if (sum >= kCarryNanoseconds) {
+    sum_nanoseconds_.fetch_sub(kCarryNanoseconds, std::memory_order_relaxed);
+    seconds += kCarrySeconds;
+  } else if (sum <= -kCarryNanoseconds) {
+    sum_nanoseconds_.fetch_add(kCarryNanoseconds, std::memory_order_relaxed);
+    seconds -= kCarrySeconds;
+  }
+  if (seconds != 0) {
+    sum_seconds_.fetch_add(seconds, std::memory_order_relaxed);
+  }
+}
+
+void DurationHistogram::Reset() {
+  for (std::size_t i = 0; i <= bucket_boundaries_.size(); ++i) {
+    bucket_counts_[i].store(0, std::memory_order_relaxed);
+  }
+  sum_seconds_.store(0, std::memory_order_relaxed);
+  sum_nanoseconds_.store(0, std::memory_order_relaxed);
+}
+
+ClientMetric DurationHistogram::Collect() const {
+  auto metric = ClientMetric{};
+
+  auto cumulative_count = std::uint64_t{0};
+  metric.histogram.bucket.reserve(bucket_boundaries_.size() + 1);
+  for (std::size_t i = 0; i <= bucket_boundaries_.size(); ++i) {
+    cumulative_count += bucket_counts_[i].load(std::memory_order_relaxed);
+    auto bucket = ClientMetric::Bucket{};
+    bucket.cumulative_count = cumulative_count;
+    bucket.upper_bound =
+        (i == bucket_boundaries_.size()
+             ? std::numeric_limits<double>::infinity()
+             : bucket_boundaries_[i] / kNanosecondsPerSecond);
+    metric.histogram.bucket.push_back(bucket);
+  }
+  metric.histogram.sample_count = cumulative_count;
+  metric.histogram.sample_sum =
+      static_cast<double>(sum_seconds_.load(std::memory_order_relaxed)) +
+      sum_nanoseconds_.load(std::memory_order_relaxed) /
+          kNanosecondsPerSecond;
+
+  return metric;
+}
+
+}  // namespace prometheus
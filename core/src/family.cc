@@ -4,21 +4,53 @@
 #include <cassert>
 #include <map>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 
 #include "prometheus/check_names.h"
 #include "prometheus/counter.h"
+#include "prometheus/duration_histogram.h"
 #include "prometheus/gauge.h"
+#include "prometheus/hdr_histogram.h"
 #include "prometheus/histogram.h"
 #include "prometheus/info.h"
+#include "prometheus/metric_filter.h"
+#include "prometheus/native_histogram.h"
+#include "prometheus/static_histogram.h"
 #include "prometheus/summary.h"
 
 namespace prometheus {
 
+namespace {
+
+template <typename T>
+typename std::enable_if<std::is_default_constructible<T>::value,
+                        std::unique_ptr<T>>::type
+MakeDefaultMetric() {
+  return detail::make_unique<T>();
+}
+
+template <typename T>
+typename std::enable_if<!std::is_default_constructible<T>::value,
+                        std::unique_ptr<T>>::type
+MakeDefaultMetric() {
+  throw std::invalid_argument("Metric requires constructor arguments");
+}
+
+}  // namespace
+
 template <typename T>
 Family<T>::Family(const std::string& name, const std::string& help,
                   const Labels& constant_labels)
-    : name_(name), help_(help), constant_labels_(constant_labels) {
+    : Family(name, help, constant_labels, nullptr) {}
+
+template <typename T>
+Family<T>::Family(const std::string& name, const std::string& help,
+                  const Labels& constant_labels, Factory factory)
+    : name_(name),
+      help_(help),
+      constant_labels_(constant_labels),
+      factory_(std::move(factory)) {
   if (!CheckMetricName(name_)) {
     throw std::invalid_argument("Invalid metric name");
   }
@@ -57,6 +89,20 @@ T& Family<T>::Add(const Labels& labels, std::unique_ptr<T> object) {
   return *stored_object;
 }
 
+template <typename T>
+T& Family<T>::Add(const Labels& labels) {
+  // an existing metric is returned without creating one in vain, which may
+  // allocate all the buckets of a histogram
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto it = metrics_.find(labels);
+    if (it != metrics_.end()) {
+      return *it->second;
+    }
+  }
+  return Add(labels, factory_ ? factory_() : MakeDefaultMetric<T>());
+}
+
 template <typename T>
 void Family<T>::Remove(T* metric) {
   std::lock_guard<std::mutex> lock{mutex_};
@@ -104,6 +150,15 @@ std::vector<MetricFamily> Family<T>::Collect() const {
   return {family};
 }
 
+template <typename T>
+std::vector<MetricFamily> Family<T>::CollectMatching(
+    const MetricFilter& filter) const {
+  if (!filter.Matches(name_)) {
+    return {};
+  }
+  return Collect();
+}
+
 template <typename T>
 ClientMetric Family<T>::CollectMetric(const Labels& metric_labels,
                                       T* metric) const {
@@ -122,9 +177,13 @@ ClientMetric Family<T>::CollectMetric(const Labels& metric_labels,
 }
 
 template class PROMETHEUS_CPP_CORE_EXPORT Family<Counter>;
+template class PROMETHEUS_CPP_CORE_EXPORT Family<DurationHistogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Family<Gauge>;
+template class PROMETHEUS_CPP_CORE_EXPORT Family<HdrHistogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Family<Histogram>;
 template class PROMETHEUS_CPP_CORE_EXPORT Family<Info>;
+template class PROMETHEUS_CPP_CORE_EXPORT Family<NativeHistogram>;
+template class PROMETHEUS_CPP_CORE_EXPORT Family<StaticHistogramBase>;
 template class PROMETHEUS_CPP_CORE_EXPORT Family<Summary>;
 
 }  // namespace prometheus
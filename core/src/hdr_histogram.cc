@@ -0,0 +1,248 @@
+#include "prometheus/hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "prometheus/native_histogram.h"
+
+namespace prometheus {
+
+namespace {
+
+// largest ratio of highest trackable to lowest discernible value which keeps
+// the scaled values and bucket arithmetic within std::int64_t
+const double kMaxValueRange = std::ldexp(1.0, 62);
+
+int FloorLog2(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(value);
+#else
+  int result = 0;
+  while (value >>= 1) {
+    ++result;
+  }
+  return result;
+#endif
+}
+
+double CheckedUnit(const double lowest_discernible_value,
+                   const double highest_trackable_value) {
+  if (!(lowest_discernible_value > 0) ||
+      !std::isfinite(lowest_discernible_value)) {
+    throw std::invalid_argument(
+        "Lowest discernible value must be positive and finite");
+  }
+  const auto range = highest_trackable_value / lowest_discernible_value;
+  if (!(range >= 2) || !(range <= kMaxValueRange)) {
+    throw std::invalid_argument(
+        "Highest trackable value must be at least twice the lowest "
+        "discernible value and within 2^62 of it");
+  }
+  return lowest_discernible_value;
+}
+
+// log2 of half the number of sub-buckets per power of two, chosen such that
+// the sub-buckets resolve the requested number of decimal digits
+int SubBucketHalfCountMagnitude(const int significant_digits) {
+  if (significant_digits < HdrHistogram::kMinSignificantDigits ||
+      significant_digits > HdrHistogram::kMaxSignificantDigits) {
+    throw std::invalid_argument("Significant digits must be between 1 and 5");
+  }
+  const auto largest_single_unit_resolution =
+      2 * std::pow(10.0, significant_digits);
+  const auto sub_bucket_count_magnitude =
+      static_cast<int>(std::ceil(std::log2(largest_single_unit_resolution)));
+  return sub_bucket_count_magnitude - 1;
+}
+
+std::size_t CountsLength(const std::int64_t highest_trackable_value,
+                         const int sub_bucket_half_count_magnitude) {
+  auto smallest_untrackable_value = std::int64_t{2}
+                                    << sub_bucket_half_count_magnitude;
+  auto bucket_count = std::size_t{1};
+  while (smallest_untrackable_value <= highest_trackable_value) {
+    if (smallest_untrackable_value >
+        std::numeric_limits<std::int64_t>::max() / 2) {
+      ++bucket_count;
+      break;
+    }
+    smallest_untrackable_value <<= 1;
+    ++bucket_count;
+  }
+  return (bucket_count + 1) << sub_bucket_half_count_magnitude;
+}
+
+}  // namespace
+
+const int HdrHistogram::kMinSignificantDigits;
+const int HdrHistogram::kMaxSignificantDigits;
+
+HdrHistogram::HdrHistogram(const double lowest_discernible_value,
+                           const double highest_trackable_value,
+                           const int significant_digits,
+                           const BucketBoundaries& buckets)
+    : HdrHistogram(lowest_discernible_value, highest_trackable_value,
+                   significant_digits,
+                   std::unique_ptr<const detail::BucketLayout>{
+                       new detail::BucketLayout{buckets}}) {}
+
+HdrHistogram::HdrHistogram(const double lowest_discernible_value,
+                           const double highest_trackable_value,
+                           const int significant_digits)
+    : HdrHistogram(lowest_discernible_value, highest_trackable_value,
+                   significant_digits, nullptr) {}
+
+HdrHistogram::HdrHistogram(const double lowest_discernible_value,
+                           const double highest_trackable_value,
+                           const int significant_digits,
+                           std::unique_ptr<const detail::BucketLayout> layout)
+    : unit_{CheckedUnit(lowest_discernible_value, highest_trackable_value)},
+      highest_trackable_value_{static_cast<std::int64_t>(
+          std::ceil(highest_trackable_value / unit_))},
+      sub_bucket_half_count_magnitude_{
+          SubBucketHalfCountMagnitude(significant_digits)},
+      sub_bucket_mask_{(std::int64_t{2} << sub_bucket_half_count_magnitude_) -
+                       1},
+      counts_length_{CountsLength(highest_trackable_value_,
+                                  sub_bucket_half_count_magnitude_)},
+      native_schema_{std::min(sub_bucket_half_count_magnitude_ - 1,
+                              NativeHistogram::kMaxSchema)},
+      layout_{std::move(layout)},
+      counts_{new std::atomic<std::uint64_t>[counts_length_]} {
+  if (layout_) {
+    // the lowest equivalent value grows with the index, hence each classic
+    // bucket receives a contiguous range of recording buckets
+    const auto& boundaries = layout_->Boundaries();
+    bucket_ends_.reserve(boundaries.size() + 1);
+    auto begin = std::size_t{0};
+    for (const auto boundary : boundaries) {
+      auto end = counts_length_;
+      while (begin < end) {
+        const auto middle = begin + (end - begin) / 2;
+        if (LowestEquivalentValue(middle) * unit_ <= boundary) {
+          begin = middle + 1;
+        } else {
+          end = middle;
+        }
+      }
+      bucket_ends_.push_back(begin);
+    }
+    bucket_ends_.push_back(counts_length_);
+  }
+  Reset();
+}
+
+void HdrHistogram::Observe(const double value) {
+  const auto scaled = value / unit_;
+  auto integer = std::int64_t{0};
+  if (scaled >= static_cast<double>(highest_trackable_value_)) {
+    integer = highest_trackable_value_;
+  } else if (scaled >= 1) {
+    integer = static_cast<std::int64_t>(scaled);
+  }
+
+  counts_[CountsIndex(integer)].fetch_add(1, std::memory_order_relaxed);
+  sum_.Increment(value);
+}
+
+void HdrHistogram::Reset() {
+  for (std::size_t i = 0; i < counts_length_; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+  sum_.Set(0);
+}
+
+std::size_t HdrHistogram::RecordingBucketCount() const {
+  return counts_length_;
+}
+
+ClientMetric HdrHistogram::Collect() const {
+  return layout_ ? CollectClassic() : CollectNative();
+}
+
+std::size_t HdrHistogram::CountsIndex(const std::int64_t value) const {
+  // the power of two above the value, at least the number of sub-buckets
+  const auto pow2_ceiling =
+      FloorLog2(static_cast<std::uint64_t>(value | sub_bucket_mask_)) + 1;
+  const auto bucket_index = pow2_ceiling - sub_bucket_half_count_magnitude_ - 1;
+  const auto sub_bucket_index = value >> bucket_index;
+  const auto sub_bucket_half_count = std::int64_t{1}
+                                     << sub_bucket_half_count_magnitude_;
+  return static_cast<std::size_t>(
+      (static_cast<std::int64_t>(bucket_index + 1)
+       << sub_bucket_half_count_magnitude_) +
+      (sub_bucket_index - sub_bucket_half_count));
+}
+
+std::int64_t HdrHistogram::LowestEquivalentValue(
+    const std::size_t index) const {
+  const auto sub_bucket_half_count = std::int64_t{1}
+                                     << sub_bucket_half_count_magnitude_;
+  auto bucket_index =
+      static_cast<int>(index >> sub_bucket_half_count_magnitude_) - 1;
+  auto sub_bucket_index =
+      static_cast<std::int64_t>(index & (sub_bucket_half_count - 1)) +
+      sub_bucket_half_count;
+  if (bucket_index < 0) {
+    sub_bucket_index -= sub_bucket_half_count;
+    bucket_index = 0;
+  }
+  return sub_bucket_index << bucket_index;
+}
+
+ClientMetric HdrHistogram::CollectClassic() const {
+  const auto& boundaries = layout_->Boundaries();
+  auto metric = ClientMetric{};
+
+  auto cumulative_count = std::uint64_t{0};
+  auto index = std::size_t{0};
+  metric.histogram.bucket.reserve(bucket_ends_.size());
+  for (std::size_t i = 0; i < bucket_ends_.size(); ++i) {
+    for (; index < bucket_ends_[i]; ++index) {
+      cumulative_count += counts_[index].load(std::memory_order_relaxed);
+    }
+    auto bucket = ClientMetric::Bucket{};
+    bucket.cumulative_count = cumulative_count;
+    bucket.upper_bound = (i == boundaries.size()
+                              ? std::numeric_limits<double>::infinity()
+                              : boundaries[i]);
+    metric.histogram.bucket.push_back(bucket);
+  }
+  metric.histogram.sample_count = cumulative_count;
+  metric.histogram.sample_sum = sum_.Value();
+
+  return metric;
+}
+
+ClientMetric HdrHistogram::CollectNative() const {
+  // room for a native bucket per sub-bucket of every power of two in range,
+  // so that a precise histogram is not downscaled right away
+  const auto powers_of_two = static_cast<std::size_t>(
+      FloorLog2(static_cast<std::uint64_t>(highest_trackable_value_)) + 2);
+  NativeHistogram native{
+      native_schema_, std::max(NativeHistogram::kDefaultMaxBuckets,
+                               powers_of_two << native_schema_)};
+  for (std::size_t i = 0; i < counts_length_; ++i) {
+    const auto count = counts_[i].load(std::memory_order_relaxed);
+    if (count == 0) {
+      continue;
+    }
+    // the native buckets include their upper bound, but a recording bucket
+    // its lower one, which may be a power of two, so the midpoint is used;
+    // values below the lowest discernible value remain zero
+    const auto lowest = LowestEquivalentValue(i);
+    const auto midpoint =
+        i == 0 ? 0.0
+               : (lowest + (LowestEquivalentValue(i + 1) - lowest) / 2.0);
+    native.Observe(midpoint * unit_, count);
+  }
+
+  auto metric = native.Collect();
+  metric.histogram.sample_sum = sum_.Value();
+  return metric;
+}
+
+}  // namespace prometheus
@@ -1,61 +1,108 @@
 #include "prometheus/histogram.h"
 
-#include <algorithm>
+#include <cmath>
 #include <cstddef>
-#include <functional>
-#include <iterator>
+#include <cstdint>
 #include <limits>
-#include <memory>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace prometheus {
 
-namespace {
+Histogram::Histogram(const BucketBoundaries& buckets)
+    : Histogram(detail::BucketLayout{buckets}) {}
 
-template <class ForwardIterator>
-bool is_strict_sorted(ForwardIterator first, ForwardIterator last) {
-  return std::adjacent_find(first, last,
-                            std::greater_equal<typename std::iterator_traits<
-                                ForwardIterator>::value_type>()) == last;
-}
+Histogram::Histogram(BucketBoundaries&& buckets)
+    : Histogram(detail::BucketLayout{std::move(buckets)}) {}
 
-}  // namespace
+Histogram::Histogram(detail::BucketLayout layout)
+    : layout_{std::move(layout)}, bucket_counts_{layout_.BucketCount()} {}
 
-Histogram::Histogram(const BucketBoundaries& buckets)
-    : bucket_boundaries_{buckets}, bucket_counts_{buckets.size() + 1} {
-  if (!is_strict_sorted(begin(bucket_boundaries_), end(bucket_boundaries_))) {
-    throw std::invalid_argument("Bucket Boundaries must be strictly sorted");
+Histogram::Histogram(detail::BucketLayout layout, const std::size_t shards)
+    : layout_{std::move(layout)},
+      sharded_{new detail::ShardedBuckets{layout_.BucketCount(), shards}} {}
+
+Histogram::Histogram(const BucketBoundaries& buckets, const std::size_t shards)
+    : Histogram(detail::BucketLayout{buckets}, shards) {}
+
+void Histogram::Observe(const double value) {
+  const auto bucket_index = layout_.Index(value);
+
+  if (sharded_) {
+    sharded_->Increment(bucket_index, 1);
+    sharded_->IncrementSum(value);
+    return;
   }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  sum_.Increment(value);
+  bucket_counts_[bucket_index].Increment();
 }
 
-Histogram::Histogram(BucketBoundaries&& buckets)
-    : bucket_boundaries_{std::move(buckets)},
-      bucket_counts_{bucket_boundaries_.size() + 1} {
-  if (!is_strict_sorted(begin(bucket_boundaries_), end(bucket_boundaries_))) {
-    throw std::invalid_argument("Bucket Boundaries must be strictly sorted");
+void Histogram::Observe(const double value, const std::uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  const auto bucket_index = layout_.Index(value);
+  const auto sum = value * static_cast<double>(count);
+
+  if (sharded_) {
+    sharded_->Increment(bucket_index, count);
+    sharded_->IncrementSum(sum);
+    return;
   }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  sum_.Increment(sum);
+  bucket_counts_[bucket_index].Increment(static_cast<double>(count));
 }
 
-void Histogram::Observe(const double value) {
-  const auto bucket_index = static_cast<std::size_t>(
-      std::distance(bucket_boundaries_.begin(),
-                    std::lower_bound(bucket_boundaries_.begin(),
-                                     bucket_boundaries_.end(), value)));
+void Histogram::ObserveBatch(const double* values, const std::size_t count) {
+  std::vector<std::uint64_t> increments(layout_.BucketCount());
+  auto sum = 0.0;
+  for (std::size_t i = 0; i < count; ++i) {
+    increments[layout_.Index(values[i])] += 1;
+    sum += values[i];
+  }
+
+  if (sharded_) {
+    for (std::size_t i = 0; i < increments.size(); ++i) {
+      if (increments[i] != 0) {
+        sharded_->Increment(i, increments[i]);
+      }
+    }
+    sharded_->IncrementSum(sum);
+    return;
+  }
 
   std::lock_guard<std::mutex> lock(mutex_);
-  sum_.Increment(value);
-  bucket_counts_[bucket_index].Increment();
+  sum_.Increment(sum);
+  for (std::size_t i = 0; i < increments.size(); ++i) {
+    if (increments[i] != 0) {
+      bucket_counts_[i].Increment(static_cast<double>(increments[i]));
+    }
+  }
 }
 
 void Histogram::ObserveMultiple(const std::vector<double>& bucket_increments,
                                 const double sum_of_values) {
-  if (bucket_increments.size() != bucket_counts_.size()) {
+  if (bucket_increments.size() != layout_.BucketCount()) {
     throw std::length_error(
         "The size of bucket_increments was not equal to"
         "the number of buckets in the histogram.");
   }
 
+  if (sharded_) {
+    for (std::size_t i{0}; i < bucket_increments.size(); ++i) {
+      sharded_->Increment(i,
+                          static_cast<std::uint64_t>(bucket_increments[i]));
+    }
+    sharded_->IncrementSum(sum_of_values);
+    return;
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
   sum_.Increment(sum_of_values);
 
@@ -65,6 +112,11 @@ void Histogram::ObserveMultiple(const std::vector<double>& bucket_increments,
 }
 
 void Histogram::Reset() {
+  if (sharded_) {
+    sharded_->Reset();
+    return;
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
   for (std::size_t i = 0; i < bucket_counts_.size(); ++i) {
     bucket_counts_[i].Reset();
@@ -73,25 +125,77 @@ void Histogram::Reset() {
 }
 
 ClientMetric Histogram::Collect() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  auto counts = std::vector<std::uint64_t>{};
+  auto sum = 0.0;
+  if (sharded_) {
+    counts = sharded_->Counts();
+    sum = sharded_->Sum();
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counts.reserve(bucket_counts_.size());
+    for (const auto& bucket_count : bucket_counts_) {
+      counts.push_back(static_cast<std::uint64_t>(bucket_count.Value()));
+    }
+    sum = sum_.Value();
+  }
 
   auto metric = ClientMetric{};
 
+  const auto& bucket_boundaries = layout_.Boundaries();
   auto cumulative_count = 0ULL;
-  metric.histogram.bucket.reserve(bucket_counts_.size());
-  for (std::size_t i{0}; i < bucket_counts_.size(); ++i) {
-    cumulative_count += bucket_counts_[i].Value();
+  metric.histogram.bucket.reserve(counts.size());
+  for (std::size_t i{0}; i < counts.size(); ++i) {
+    cumulative_count += counts[i];
     auto bucket = ClientMetric::Bucket{};
     bucket.cumulative_count = cumulative_count;
-    bucket.upper_bound = (i == bucket_boundaries_.size()
+    bucket.upper_bound = (i == bucket_boundaries.size()
                               ? std::numeric_limits<double>::infinity()
-                              : bucket_boundaries_[i]);
+                              : bucket_boundaries[i]);
     metric.histogram.bucket.push_back(std::move(bucket));
   }
   metric.histogram.sample_count = cumulative_count;
-  metric.histogram.sample_sum = sum_.Value();
+  metric.histogram.sample_sum = sum;
 
   return metric;
 }
 
+Histogram::BucketBoundaries LinearBuckets(const double start,
+                                          const double width,
+                                          const std::size_t count) {
+  if (!(width > 0)) {
+    throw std::invalid_argument("Bucket width must be positive");
+  }
+  if (count == 0) {
+    throw std::invalid_argument("Bucket count must be positive");
+  }
+
+  auto boundaries = Histogram::BucketBoundaries{};
+  boundaries.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    boundaries.push_back(start + i * width);
+  }
+  return boundaries;
+}
+
+Histogram::BucketBoundaries ExponentialBuckets(const double start,
+                                               const double factor,
+                                               const std::size_t count) {
+  if (!(start > 0)) {
+    throw std::invalid_argument("Bucket start must be positive");
+  }
+  if (!(factor > 1)) {
+    throw std::invalid_argument("Bucket factor must be greater than 1");
+  }
+  if (count == 0) {
+    throw std::invalid_argument("Bucket count must be positive");
+  }
+
+  auto boundaries = Histogram::BucketBoundaries{};
+  boundaries.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    boundaries.push_back(start * std::pow(factor, static_cast<double>(i)));
+  }
+  return boundaries;
+}
+
 }  // namespace prometheus
@@ -0,0 +1,175 @@
+#include "prometheus/metric_filter.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace prometheus {
+
+namespace {
+const std::size_t kMaxPatternSize = 1024;
+const std::size_t kMaxAlternatives = 64;
+// stands for ".*" in an expanded pattern, it is no metric name character
+const char kWildcard = '*';
+
+bool IsNameCharacter(const char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == ':';
+}
+
+void AppendToken(std::string& alternative, const char token) {
+  if (token == kWildcard && !alternative.empty() &&
+      alternative.back() == kWildcard) {
+    return;
+  }
+  alternative += token;
+}
+
+// Expands a pattern into the alternatives it matches, e.g., "(a|b)_.*" into
+// "a_*" and "b_*". Only name characters, ".*", "|" and groups which do not
+// nest are supported. Everything else could make std::regex backtrack
+// exponentially, so it is rejected.
+std::vector<std::string> Expand(const std::string& pattern) {
+  std::vector<std::string> result;
+  std::vector<std::string> branch{std::string{}};
+  std::vector<std::string> group;
+  auto in_group = false;
+
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    auto token = pattern[i];
+    if (token == '.' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+      token = kWildcard;
+      ++i;
+    } else if (!IsNameCharacter(token)) {
+      if (token == '(' && !in_group) {
+        in_group = true;
+        group.assign(1, std::string{});
+      } else if (token == '|' && in_group) {
+        group.emplace_back();
+      } else if (token == '|') {
+        result.insert(result.end(), branch.begin(), branch.end());
+        branch.assign(1, std::string{});
+      } else if (token == ')' && in_group) {
+        in_group = false;
+        if (result.size() + branch.size() * group.size() > kMaxAlternatives) {
+          throw std::invalid_argument(
+              "Metric name pattern has too many alternatives");
+        }
+        std::vector<std::string> product;
+        product.reserve(branch.size() * group.size());
+        for (const auto& prefix : branch) {
+          for (const auto& suffix : group) {
+            product.push_back(prefix);
+            for (const auto c : suffix) {
+              AppendToken(product.back(), c);
+            }
+          }
+        }
+        branch.swap(product);
+      } else {
+        throw std::invalid_argument("Unsupported metric name pattern");
+      }
+
+      if (result.size() + branch.size() + group.size() > kMaxAlternatives) {
+        throw std::invalid_argument(
+            "Metric name pattern has too many alternatives");
+      }
+      continue;
+    }
+
+    if (in_group) {
+      AppendToken(group.back(), token);
+    } else {
+      for (auto& alternative : branch) {
+        AppendToken(alternative, token);
+      }
+    }
+  }
+
+  if (in_group) {
+    throw std::invalid_argument("Invalid metric name pattern");
+  }
+  result.insert(result.end(), branch.begin(), branch.end());
+  return result;
+}
+
+// Runs in O(pattern * name) without recursion, unlike a backtracking regular
+// expression.
+bool MatchesWildcards(const std::string& pattern, const std::string& name) {
+  std::size_t p = 0;
+  std::size_t n = 0;
+  auto wildcard = std::string::npos;
+  std::size_t resume = 0;
+
+  while (n < name.size()) {
+    if (p < pattern.size() && pattern[p] == kWildcard) {
+      wildcard = p++;
+      resume = n;
+    } else if (p < pattern.size() && pattern[p] == name[n]) {
+      ++p;
+      ++n;
+    } else if (wildcard != std::string::npos) {
+      p = wildcard + 1;
+      n = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == kWildcard) {
+    ++p;
+  }
+  return p == pattern.size();
+}
+}  // namespace
+
+MetricFilter& MetricFilter::AddName(std::string name) {
+  names_.insert(std::move(name));
+  return *this;
+}
+
+MetricFilter& MetricFilter::AddPrefix(std::string prefix) {
+  prefixes_.push_back(std::move(prefix));
+  return *this;
+}
+
+MetricFilter& MetricFilter::AddPattern(const std::string& pattern) {
+  if (pattern.size() > kMaxPatternSize) {
+    throw std::invalid_argument("Metric name pattern is too long");
+  }
+
+  for (auto& alternative : Expand(pattern)) {
+    const auto wildcard = alternative.find(kWildcard);
+    if (wildcard == std::string::npos) {
+      AddName(std::move(alternative));
+    } else if (wildcard + 1 == alternative.size()) {
+      alternative.pop_back();
+      AddPrefix(std::move(alternative));
+    } else {
+      patterns_.push_back(std::move(alternative));
+    }
+  }
+  return *this;
+}
+
+bool MetricFilter::Empty() const {
+  return names_.empty() && prefixes_.empty() && patterns_.empty();
+}
+
+bool MetricFilter::Matches(const std::string& name) const {
+  if (Empty() || names_.count(name) > 0) {
+    return true;
+  }
+  for (const auto& prefix : prefixes_) {
+    if (name.compare(0, prefix.size(), prefix) == 0) {
+      return true;
+    }
+  }
+  for (const auto& pattern : patterns_) {
+    if (MatchesWildcards(pattern, name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace prometheus
@@ -0,0 +1,193 @@
+#include "prometheus/native_histogram.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace prometheus {
+
+namespace {
+
+using Buckets = std::map<int, std::uint64_t>;
+
+// ceil(key / 2^shift) without relying on the rounding of negative shifts
+int CeilDivPow2(int key, int shift) {
+  return key >= 0 ? (key + (1 << shift) - 1) >> shift : -((-key) >> shift);
+}
+
+// Upper bounds of the buckets within one power of two for a positive schema,
+// scaled to the range [0.5, 1) of the fraction returned by std::frexp.
+const std::vector<double>& FractionBounds(int schema) {
+  static const auto bounds = [] {
+    std::array<std::vector<double>, NativeHistogram::kMaxSchema + 1> result;
+    for (int s = 1; s <= NativeHistogram::kMaxSchema; ++s) {
+      const auto size = 1 << s;
+      result[s].reserve(size);
+      for (int i = 0; i < size; ++i) {
+        result[s].push_back(0.5 * std::exp2(static_cast<double>(i) / size));
+      }
+    }
+    return result;
+  }();
+  return bounds[schema];
+}
+
+// Index of the bucket (base^(key-1), base^key] containing the positive value.
+int BucketKey(double value, int schema) {
+  if (std::isinf(value)) {
+    value = std::numeric_limits<double>::max();
+  }
+
+  int exponent;
+  const auto fraction = std::frexp(value, &exponent);
+
+  if (schema > 0) {
+    const auto& bounds = FractionBounds(schema);
+    const auto index = std::distance(
+        bounds.begin(), std::lower_bound(bounds.begin(), bounds.end(), fraction));
+    return static_cast<int>(index) + (exponent - 1) * (1 << schema);
+  }
+
+  auto key = fraction == 0.5 ? exponent - 1 : exponent;
+  return CeilDivPow2(key, -schema);
+}
+
+Buckets Downscale(const Buckets& buckets) {
+  Buckets result;
+  for (const auto& bucket : buckets) {
+    result.emplace_hint(result.end(), CeilDivPow2(bucket.first, 1), 0)
+        ->second += bucket.second;
+  }
+  return result;
+}
+
+void AppendSpans(const Buckets& buckets,
+                 std::vector<ClientMetric::BucketSpan>& spans,
+                 std::vector<std::int64_t>& deltas) {
+  spans.reserve(buckets.size());
+  deltas.reserve(buckets.size());
+
+  int previous_key = 0;
+  std::int64_t previous_count = 0;
+  for (const auto& bucket : buckets) {
+    if (spans.empty() || bucket.first != previous_key + 1) {
+      auto span = ClientMetric::BucketSpan{};
+      span.offset = spans.empty() ? bucket.first
+                                  : bucket.first - previous_key - 1;
+      spans.push_back(span);
+    }
+    ++spans.back().length;
+
+    const auto count = static_cast<std::int64_t>(bucket.second);
+    deltas.push_back(count - previous_count);
+    previous_count = count;
+    previous_key = bucket.first;
+  }
+}
+
+}  // namespace
+
+const int NativeHistogram::kMinSchema;
+const int NativeHistogram::kMaxSchema;
+const std::size_t NativeHistogram::kDefaultMaxBuckets;
+const double NativeHistogram::kDefaultZeroThreshold = std::ldexp(1.0, -128);
+
+NativeHistogram::NativeHistogram(const int schema,
+                                 const std::size_t max_buckets,
+                                 const double zero_threshold)
+    : initial_schema_{schema},
+      max_buckets_{max_buckets},
+      zero_threshold_{zero_threshold},
+      schema_{schema} {
+  if (schema < kMinSchema || schema > kMaxSchema) {
+    throw std::invalid_argument("Schema must be between -4 and 8");
+  }
+  if (!(zero_threshold >= 0)) {
+    throw std::invalid_argument("Zero threshold must not be negative");
+  }
+}
+
+void NativeHistogram::Observe(const double value) { Observe(value, 1); }
+
+void NativeHistogram::Observe(const double value, const std::uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  count_ += count;
+  sum_ += value * count;
+
+  if (std::isnan(value)) {
+    return;
+  }
+
+  if (std::abs(value) <= zero_threshold_) {
+    zero_count_ += count;
+    return;
+  }
+
+  auto& buckets = value > 0 ? positive_buckets_ : negative_buckets_;
+  buckets[BucketKey(std::abs(value), schema_)] += count;
+
+  if (max_buckets_ != 0 &&
+      positive_buckets_.size() + negative_buckets_.size() > max_buckets_) {
+    ReduceResolution();
+  }
+}
+
+void NativeHistogram::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  schema_ = initial_schema_;
+  count_ = 0;
+  sum_ = 0;
+  zero_count_ = 0;
+  positive_buckets_.clear();
+  negative_buckets_.clear();
+}
+
+int NativeHistogram::Schema() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return schema_;
+}
+
+ClientMetric NativeHistogram::Collect() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto metric = ClientMetric{};
+  auto& histogram = metric.histogram;
+
+  histogram.sample_count = count_;
+  histogram.sample_sum = sum_;
+  histogram.schema = schema_;
+  histogram.zero_threshold = zero_threshold_;
+  histogram.zero_count = zero_count_;
+  AppendSpans(negative_buckets_, histogram.negative_span,
+              histogram.negative_delta);
+  AppendSpans(positive_buckets_, histogram.positive_span,
+              histogram.positive_delta);
+
+  // an empty span marks a histogram without populated buckets as native
+  if (histogram.positive_span.empty() && histogram.negative_span.empty()) {
+    histogram.positive_span.push_back(ClientMetric::BucketSpan{});
+  }
+
+  return metric;
+}
+
+void NativeHistogram::ReduceResolution() {
+  while (schema_ > kMinSchema &&
+         positive_buckets_.size() + negative_buckets_.size() > max_buckets_) {
+    schema_ -= 1;
+    positive_buckets_ = Downscale(positive_buckets_);
+    negative_buckets_ = Downscale(negative_buckets_);
+  }
+}
+
+}  // namespace prometheus
@@ -0,0 +1,206 @@
+#include "prometheus/protobuf_serializer.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "detail/encoding.h"
+#include "prometheus/client_metric.h"
+#include "prometheus/metric_family.h"
+#include "prometheus/metric_type.h"
+
+namespace prometheus {
+
+namespace {
+
+// Field numbers and enum values of io.prometheus.client in metrics.proto
+enum WireType : std::uint32_t { Varint = 0, Fixed64 = 1, LengthDelimited = 2 };
+
+enum ProtoMetricType : std::uint32_t {
+  ProtoCounter = 0,
+  ProtoGauge = 1,
+  ProtoSummary = 2,
+  ProtoUntyped = 3,
+  ProtoHistogram = 4,
+};
+
+void AppendTag(std::string* out, std::uint32_t field, WireType wire_type) {
+  detail::AppendVarint(out, (field << 3) | wire_type);
+}
+
+void AppendVarintField(std::string* out, std::uint32_t field,
+                       std::uint64_t value) {
+  AppendTag(out, field, Varint);
+  detail::AppendVarint(out, value);
+}
+
+void AppendSignedField(std::string* out, std::uint32_t field,
+                       std::int64_t value) {
+  // zigzag encoding of the sint32 and sint64 types
+  const auto zigzag = (static_cast<std::uint64_t>(value) << 1) ^
+                      static_cast<std::uint64_t>(value >> 63);
+  AppendVarintField(out, field, zigzag);
+}
+
+void AppendDoubleField(std::string* out, std::uint32_t field, double value) {
+  AppendTag(out, field, Fixed64);
+  detail::AppendDouble(out, value);
+}
+
+void AppendBytesField(std::string* out, std::uint32_t field,
+                      const std::string& value) {
+  AppendTag(out, field, LengthDelimited);
+  detail::AppendVarint(out, value.size());
+  out->append(value);
+}
+
+void AppendSpans(std::string* out, std::uint32_t span_field,
+                 const std::vector<ClientMetric::BucketSpan>& spans,
+                 std::uint32_t delta_field,
+                 const std::vector<std::int64_t>& deltas) {
+  std::string message;
+  for (auto& span : spans) {
+    message.clear();
+    AppendSignedField(&message, 1, span.offset);
+    AppendVarintField(&message, 2, span.length);
+    AppendBytesField(out, span_field, message);
+  }
+  for (auto delta : deltas) {
+    AppendSignedField(out, delta_field, delta);
+  }
+}
+
+std::string SerializeSummary(const ClientMetric::Summary& summary) {
+  std::string out;
+  AppendVarintField(&out, 1, summary.sample_count);
+  AppendDoubleField(&out, 2, summary.sample_sum);
+
+  std::string message;
+  for (auto& q : summary.quantile) {
+    message.clear();
+    AppendDoubleField(&message, 1, q.quantile);
+    AppendDoubleField(&message, 2, q.value);
+    AppendBytesField(&out, 3, message);
+  }
+  return out;
+}
+
+std::string SerializeHistogram(const ClientMetric::Histogram& histogram) {
+  std::string out;
+  AppendVarintField(&out, 1, histogram.sample_count);
+  AppendDoubleField(&out, 2, histogram.sample_sum);
+
+  std::string message;
+  for (auto& b : histogram.bucket) {
+    message.clear();
+    AppendVarintField(&message, 1, b.cumulative_count);
+    AppendDoubleField(&message, 2, b.upper_bound);
+    AppendBytesField(&out, 3, message);
+  }
+
+  if (!histogram.positive_span.empty() || !histogram.negative_span.empty()) {
+    AppendSignedField(&out, 5, histogram.schema);
+    AppendDoubleField(&out, 6, histogram.zero_threshold);
+    AppendVarintField(&out, 7, histogram.zero_count);
+    AppendSpans(&out, 9, histogram.negative_span, 10, histogram.negative_delta);
+    AppendSpans(&out, 12, histogram.positive_span, 13,
+                histogram.positive_delta);
+  }
+  return out;
+}
+
+std::string SerializeMetric(MetricType type, const ClientMetric& metric) {
+  std::string out;
+
+  std::string message;
+  for (auto& label : metric.label) {
+    message.clear();
+    AppendBytesField(&message, 1, label.name);
+    AppendBytesField(&message, 2, label.value);
+    AppendBytesField(&out, 1, message);
+  }
+
+  message.clear();
+  switch (type) {
+    case MetricType::Counter:
+      AppendDoubleField(&message, 1, metric.counter.value);
+      AppendBytesField(&out, 3, message);
+      break;
+    case MetricType::Gauge:
+      AppendDoubleField(&message, 1, metric.gauge.value);
+      AppendBytesField(&out, 2, message);
+      break;
+    case MetricType::Info:
+      AppendDoubleField(&message, 1, metric.info.value);
+      AppendBytesField(&out, 2, message);
+      break;
+    case MetricType::Summary:
+      AppendBytesField(&out, 4, SerializeSummary(metric.summary));
+      break;
+    case MetricType::Untyped:
+      AppendDoubleField(&message, 1, metric.untyped.value);
+      AppendBytesField(&out, 5, message);
+      break;
+    case MetricType::Histogram:
+      AppendBytesField(&out, 7, SerializeHistogram(metric.histogram));
+      break;
+  }
+
+  if (metric.timestamp_ms != 0) {
+    AppendVarintField(&out, 6, static_cast<std::uint64_t>(metric.timestamp_ms));
+  }
+  return out;
+}
+
+ProtoMetricType ToProtoType(MetricType type) {
+  switch (type) {
+    case MetricType::Counter:
+      return ProtoCounter;
+    // info is not handled by prometheus, we use gauge as workaround
+    case MetricType::Gauge:
+    case MetricType::Info:
+      return ProtoGauge;
+    case MetricType::Summary:
+      return ProtoSummary;
+    case MetricType::Histogram:
+      return ProtoHistogram;
+    case MetricType::Untyped:
+      break;
+  }
+  return ProtoUntyped;
+}
+
+std::string SerializeFamily(const MetricFamily& family) {
+  std::string out;
+  AppendBytesField(&out, 1, family.type == MetricType::Info
+                                ? family.name + "_info"
+                                : family.name);
+  if (!family.help.empty()) {
+    AppendBytesField(&out, 2, family.help);
+  }
+  AppendVarintField(&out, 3, ToProtoType(family.type));
+  for (auto& metric : family.metric) {
+    AppendBytesField(&out, 4, SerializeMetric(family.type, metric));
+  }
+  return out;
+}
+
+}  // namespace
+
+const char* const ProtobufSerializer::kContentType =
+    "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; "
+    "encoding=delimited";
+
+void ProtobufSerializer::Serialize(
+    std::ostream& out, const std::vector<MetricFamily>& metrics) const {
+  std::string buffer;
+  for (auto& family : metrics) {
+    const auto message = SerializeFamily(family);
+    buffer.clear();
+    detail::AppendVarint(&buffer, message.size());
+    buffer.append(message);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  }
+}
+
+}  // namespace prometheus
@@ -4,12 +4,18 @@
 #include <iterator>
 #include <stdexcept>
 #include <tuple>
+#include <utility>
 
 #include "prometheus/counter.h"
 #include "prometheus/detail/future_std.h"
+#include "prometheus/duration_histogram.h"
 #include "prometheus/gauge.h"
+#include "prometheus/hdr_histogram.h"
 #include "prometheus/histogram.h"
 #include "prometheus/info.h"
+#include "prometheus/metric_filter.h"
+#include "prometheus/native_histogram.h"
+#include "prometheus/static_histogram.h"
 #include "prometheus/summary.h"
 
 namespace prometheus {
@@ -24,6 +30,19 @@ void CollectAll(std::vector<MetricFamily>& results, const T& families) {
   }
 }
 
+template <typename T>
+void CollectMatchingFamilies(std::vector<MetricFamily>& results,
+                             const T& families, const MetricFilter& filter) {
+  for (auto&& family : families) {
+    if (!filter.Matches(family->GetName())) {
+      continue;
+    }
+    auto metrics = family->Collect();
+    results.insert(results.end(), std::make_move_iterator(metrics.begin()),
+                   std::make_move_iterator(metrics.end()));
+  }
+}
+
 bool FamilyNameExists(const std::string& /* name */) { return false; }
 
 template <typename T, typename... Args>
@@ -48,24 +67,57 @@ std::vector<MetricFamily> Registry::Collect() const {
   auto results = std::vector<MetricFamily>{};
 
   CollectAll(results, counters_);
+  CollectAll(results, duration_histograms_);
   CollectAll(results, gauges_);
+  CollectAll(results, hdr_histograms_);
   CollectAll(results, histograms_);
   CollectAll(results, infos_);
+  CollectAll(results, native_histograms_);
+  CollectAll(results, static_histograms_);
   CollectAll(results, summaries_);
 
   return results;
 }
 
+std::vector<MetricFamily> Registry::CollectMatching(
+    const MetricFilter& filter) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto results = std::vector<MetricFamily>{};
+
+  CollectMatchingFamilies(results, counters_, filter);
+  CollectMatchingFamilies(results, duration_histograms_, filter);
+  CollectMatchingFamilies(results, gauges_, filter);
+  CollectMatchingFamilies(results, hdr_histograms_, filter);
+  CollectMatchingFamilies(results, histograms_, filter);
+  CollectMatchingFamilies(results, infos_, filter);
+  CollectMatchingFamilies(results, native_histograms_, filter);
+  CollectMatchingFamilies(results, static_histograms_, filter);
+  CollectMatchingFamilies(results, summaries_, filter);
+
+  return results;
+}
+
 template <>
 std::vector<std::unique_ptr<Family<Counter>>>& Registry::GetFamilies() {
   return counters_;
 }
 
+template <>
+std::vector<std::unique_ptr<Family<DurationHistogram>>>&
+Registry::GetFamilies() {
+  return duration_histograms_;
+}
+
 template <>
 std::vector<std::unique_ptr<Family<Gauge>>>& Registry::GetFamilies() {
   return gauges_;
 }
 
+template <>
+std::vector<std::unique_ptr<Family<HdrHistogram>>>& Registry::GetFamilies() {
+  return hdr_histograms_;
+}
+
 template <>
 std::vector<std::unique_ptr<Family<Histogram>>>& Registry::GetFamilies() {
   return histograms_;
@@ -76,6 +128,18 @@ std::vector<std::unique_ptr<Family<Info>>>& Registry::GetFamilies() {
   return infos_;
 }
 
+template <>
+std::vector<std::unique_ptr<Family<NativeHistogram>>>&
+Registry::GetFamilies() {
+  return native_histograms_;
+}
+
+template <>
+std::vector<std::unique_ptr<Family<StaticHistogramBase>>>&
+Registry::GetFamilies() {
+  return static_histograms_;
+}
+
 template <>
 std::vector<std::unique_ptr<Family<Summary>>>& Registry::GetFamilies() {
   return summaries_;
@@ -83,34 +147,75 @@ std::vector<std::unique_ptr<Family<Summary>>>& Registry::GetFamilies() {
 
 template <>
 bool Registry::NameExistsInOtherType<Counter>(const std::string& name) const {
-  return FamilyNameExists(name, gauges_, histograms_, infos_, summaries_);
+  return FamilyNameExists(name, duration_histograms_, gauges_, hdr_histograms_,
+                          histograms_, infos_, native_histograms_,
+                          static_histograms_, summaries_);
+}
+
+template <>
+bool Registry::NameExistsInOtherType<DurationHistogram>(
+    const std::string& name) const {
+  return FamilyNameExists(name, counters_, gauges_, hdr_histograms_,
+                          histograms_, infos_, native_histograms_,
+                          static_histograms_, summaries_);
 }
 
 template <>
 bool Registry::NameExistsInOtherType<Gauge>(const std::string& name) const {
-  return FamilyNameExists(name, counters_, histograms_, infos_, summaries_);
+  return FamilyNameExists(name, counters_, duration_histograms_,
+                          hdr_histograms_, histograms_, infos_,
+                          native_histograms_, static_histograms_, summaries_);
+}
+
+template <>
+bool Registry::NameExistsInOtherType<HdrHistogram>(
+    const std::string& name) const {
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          histograms_, infos_, native_histograms_,
+                          static_histograms_, summaries_);
 }
 
 template <>
 bool Registry::NameExistsInOtherType<Histogram>(const std::string& name) const {
-  return FamilyNameExists(name, counters_, gauges_, infos_, summaries_);
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          hdr_histograms_, infos_, native_histograms_,
+                          static_histograms_, summaries_);
 }
 
 template <>
 bool Registry::NameExistsInOtherType<Info>(const std::string& name) const {
-  return FamilyNameExists(name, counters_, gauges_, histograms_, summaries_);
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          hdr_histograms_, histograms_, native_histograms_,
+                          static_histograms_, summaries_);
+}
+
+template <>
+bool Registry::NameExistsInOtherType<NativeHistogram>(
+    const std::string& name) const {
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          hdr_histograms_, histograms_, infos_,
+                          static_histograms_, summaries_);
+}
+
+template <>
+bool Registry::NameExistsInOtherType<StaticHistogramBase>(
+    const std::string& name) const {
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          hdr_histograms_, histograms_, infos_,
+                          native_histograms_, summaries_);
 }
 
 template <>
 bool Registry::NameExistsInOtherType<Summary>(const std::string& name) const {
-  return FamilyNameExists(name, counters_, gauges_, histograms_, infos_);
+  return FamilyNameExists(name, counters_, duration_histograms_, gauges_,
+                          hdr_histograms_, histograms_, infos_,
+                          native_histograms_, static_histograms_);
 }
 
 template <typename T>
-Family<T>& Registry::Add(const std::string& name, const std::string& help,
-                         const Labels& labels) {
-  std::lock_guard<std::mutex> lock{mutex_};
-
+Family<T>& Registry::AddFamily(const std::string& name, const std::string& help,
+                               const Labels& labels,
+                               typename Family<T>::Factory factory) {
   if (NameExistsInOtherType<T>(name)) {
     throw std::invalid_argument(
         "Family name already exists with different type");
@@ -141,31 +246,94 @@ Family<T>& Registry::Add(const std::string& name, const std::string& help,
     throw std::invalid_argument("Family name already exists");
   }
 
-  auto family = detail::make_unique<Family<T>>(name, help, labels);
+  auto family =
+      detail::make_unique<Family<T>>(name, help, labels, std::move(factory));
   auto& ref = *family;
   families.push_back(std::move(family));
   return ref;
 }
 
-template Family<Counter>& Registry::Add(const std::string& name,
-                                        const std::string& help,
-                                        const Labels& labels);
+template <typename T>
+Family<T>& Registry::Add(const std::string& name, const std::string& help,
+                         const Labels& labels,
+                         typename Family<T>::Factory factory) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return AddFamily<T>(name, help, labels, std::move(factory));
+}
+
+template Family<DurationHistogram>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<DurationHistogram>::Factory factory);
+
+template Family<Counter>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<Counter>::Factory factory);
+
+template Family<Gauge>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<Gauge>::Factory factory);
+
+template Family<HdrHistogram>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<HdrHistogram>::Factory factory);
+
+template Family<Info>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<Info>::Factory factory);
+
+template Family<Summary>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<Summary>::Factory factory);
+
+template Family<Histogram>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<Histogram>::Factory factory);
 
-template Family<Gauge>& Registry::Add(const std::string& name,
-                                      const std::string& help,
-                                      const Labels& labels);
+template Family<NativeHistogram>& Registry::Add(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<NativeHistogram>::Factory factory);
 
-template Family<Info>& Registry::Add(const std::string& name,
-                                     const std::string& help,
-                                     const Labels& labels);
+template PROMETHEUS_CPP_CORE_EXPORT Family<StaticHistogramBase>&
+Registry::Add(const std::string& name, const std::string& help,
+              const Labels& labels,
+              Family<StaticHistogramBase>::Factory factory);
 
-template Family<Summary>& Registry::Add(const std::string& name,
-                                        const std::string& help,
-                                        const Labels& labels);
+Family<StaticHistogramBase>& Registry::AddStaticHistogram(
+    const std::string& name, const std::string& help, const Labels& labels,
+    Family<StaticHistogramBase>::Factory factory, const void* layout) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto& family = AddFamily<StaticHistogramBase>(name, help, labels,
+                                                std::move(factory));
+  const auto inserted = static_histogram_layouts_.emplace(&family, layout);
+  if (!inserted.second && inserted.first->second != layout) {
+    throw std::invalid_argument(
+        "Family already exists with different bucket boundaries");
+  }
+  return family;
+}
 
-template Family<Histogram>& Registry::Add(const std::string& name,
+Family<Histogram>& Registry::AddHistogram(const std::string& name,
                                           const std::string& help,
-                                          const Labels& labels);
+                                          const Labels& labels,
+                                          Family<Histogram>::Factory factory,
+                                          HistogramLayout layout) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto& family = AddFamily<Histogram>(name, help, labels, std::move(factory));
+  const auto it = histogram_layouts_.find(&family);
+  if (it == histogram_layouts_.end()) {
+    histogram_layouts_.emplace(&family, std::move(layout));
+    return family;
+  }
+  const auto& registered = it->second;
+  if (std::tie(registered.has_buckets, registered.boundaries,
+               registered.sharded, registered.shards) !=
+      std::tie(layout.has_buckets, layout.boundaries, layout.sharded,
+               layout.shards)) {
+    throw std::invalid_argument(
+        "Family already exists with different buckets or shards");
+  }
+  return family;
+}
 
 template <typename T>
 bool Registry::Remove(const Family<T>& family) {
@@ -182,15 +350,23 @@ bool Registry::Remove(const Family<T>& family) {
   }
 
   families.erase(it);
+  static_histogram_layouts_.erase(&family);
+  histogram_layouts_.erase(&family);
   return true;
 }
 
+template bool PROMETHEUS_CPP_CORE_EXPORT
+Registry::Remove(const Family<DurationHistogram>& family);
+
 template bool PROMETHEUS_CPP_CORE_EXPORT
 Registry::Remove(const Family<Counter>& family);
 
 template bool PROMETHEUS_CPP_CORE_EXPORT
 Registry::Remove(const Family<Gauge>& family);
 
+template bool PROMETHEUS_CPP_CORE_EXPORT
+Registry::Remove(const Family<HdrHistogram>& family);
+
 template bool PROMETHEUS_CPP_CORE_EXPORT
 Registry::Remove(const Family<Summary>& family);
 
@@ -200,4 +376,10 @@ Registry::Remove(const Family<Histogram>& family);
 template bool PROMETHEUS_CPP_CORE_EXPORT
 Registry::Remove(const Family<Info>& family);
 
+template bool PROMETHEUS_CPP_CORE_EXPORT
+Registry::Remove(const Family<NativeHistogram>& family);
+
+template bool PROMETHEUS_CPP_CORE_EXPORT
+Registry::Remove(const Family<StaticHistogramBase>& family);
+
 }  // namespace prometheus
@@ -0,0 +1,7 @@
+#include "prometheus/static_histogram.h"
+
+namespace prometheus {
+
+StaticHistogramBase::~StaticHistogramBase() = default;
+
+}  // namespace prometheus
@@ -1,43 +1,214 @@
 #include "prometheus/summary.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <utility>
 
+#include "detail/encoding.h"
+
 namespace prometheus {
 
+namespace {
+
+const std::uint64_t kSnapshotVersion = 1;
+
+const Summary::Quantiles& CheckQuantiles(
+    const std::shared_ptr<const Summary::Quantiles>& quantiles) {
+  if (!quantiles) {
+    throw std::invalid_argument("Quantiles must not be null");
+  }
+  return *quantiles;
+}
+
+}  // namespace
+
 Summary::Summary(const Quantiles& quantiles,
                  const std::chrono::milliseconds max_age, const int age_buckets)
-    : quantiles_{quantiles},
-      quantile_values_{quantiles_, max_age, age_buckets} {}
+    : Summary(std::make_shared<const Quantiles>(quantiles), max_age,
+              age_buckets) {}
 
 Summary::Summary(Quantiles&& quantiles, const std::chrono::milliseconds max_age,
                  const int age_buckets)
+    : Summary(std::make_shared<const Quantiles>(std::move(quantiles)), max_age,
+              age_buckets) {}
+
+Summary::Summary(std::shared_ptr<const Quantiles> quantiles,
+                 const std::chrono::milliseconds max_age, const int age_buckets,
+                 const std::size_t buffer_size, const ClockSource clock_source)
     : quantiles_{std::move(quantiles)},
-      quantile_values_{quantiles_, max_age, age_buckets} {}
+      buffer_size_{buffer_size},
+      quantile_values_{CheckQuantiles(quantiles_), max_age, age_buckets,
+                       buffer_size, clock_source} {}
 
 void Summary::Observe(const double value) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
 
   count_ += 1;
   sum_ += value;
-  quantile_values_.insert(value);
+  if (pending_.capacity() < buffer_size_) {
+    pending_.reserve(buffer_size_);
+  }
+  pending_.push_back(value);
+
+  if (pending_.size() < buffer_size_) {
+    return;
+  }
+
+  // A running Collect() drains the buffer anyway, keep buffering instead of
+  // waiting for it.
+  std::unique_lock<std::mutex> quantile_lock(quantile_mutex_,
+                                             std::try_to_lock);
+  if (!quantile_lock.owns_lock()) {
+    return;
+  }
+
+  pending_.swap(flushing_);
+  lock.unlock();
+
+  FlushPending();
+}
+
+void Summary::Observe(const double value, const std::uint64_t count) {
+  if (count <= 1) {
+    if (count == 1) {
+      Observe(value);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> quantile_lock(quantile_mutex_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_ += count;
+    sum_ += value * static_cast<double>(count);
+  }
+
+  quantile_values_.insert(value, count);
 }
 
 ClientMetric Summary::Collect() const {
   auto metric = ClientMetric{};
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> quantile_lock(quantile_mutex_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.swap(flushing_);
+    metric.summary.sample_count = count_;
+    metric.summary.sample_sum = sum_;
+  }
 
-  metric.summary.quantile.reserve(quantiles_.size());
-  for (const auto& quantile : quantiles_) {
+  FlushPending();
+
+  metric.summary.quantile.reserve(quantiles_->size());
+  for (const auto& quantile : *quantiles_) {
     auto metricQuantile = ClientMetric::Quantile{};
     metricQuantile.quantile = quantile.quantile;
     metricQuantile.value = quantile_values_.get(quantile.quantile);
     metric.summary.quantile.push_back(std::move(metricQuantile));
   }
-  metric.summary.sample_count = count_;
-  metric.summary.sample_sum = sum_;
 
   return metric;
 }
 
+std::string Summary::Snapshot() const {
+  std::string snapshot;
+  std::uint64_t count;
+  double sum;
+
+  std::lock_guard<std::mutex> quantile_lock(quantile_mutex_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.swap(flushing_);
+    count = count_;
+    sum = sum_;
+  }
+
+  FlushPending();
+
+  const auto items = quantile_values_.snapshot();
+  snapshot.reserve(24 + 12 * items.size());
+
+  detail::AppendVarint(&snapshot, kSnapshotVersion);
+  detail::AppendVarint(&snapshot, count);
+  detail::AppendDouble(&snapshot, sum);
+  detail::AppendVarint(&snapshot, items.size());
+  for (const auto& item : items) {
+    detail::AppendDouble(&snapshot, item.value);
+    detail::AppendVarint(&snapshot, static_cast<std::uint64_t>(item.g));
+    detail::AppendVarint(&snapshot, static_cast<std::uint64_t>(item.delta));
+  }
+
+  return snapshot;
+}
+
+void Summary::Merge(const std::string& snapshot) {
+  detail::Decoder decoder{snapshot.data(), snapshot.size()};
+
+  if (decoder.ReadVarint() != kSnapshotVersion) {
+    throw std::invalid_argument("Unsupported summary snapshot version");
+  }
+  const auto count = decoder.ReadVarint();
+  const auto sum = decoder.ReadDouble();
+  const auto size = decoder.ReadVarint();
+  if (size > snapshot.size()) {
+    throw std::invalid_argument("Invalid summary snapshot");
+  }
+
+  const auto max_rank = static_cast<std::uint64_t>(
+      std::numeric_limits<std::int64_t>::max());
+  std::vector<detail::CKMSQuantiles::Item> items;
+  items.reserve(size);
+  for (std::uint64_t i = 0; i < size; ++i) {
+    const auto value = decoder.ReadDouble();
+    const auto g = decoder.ReadVarint();
+    const auto delta = decoder.ReadVarint();
+    if (std::isnan(value) || g == 0 || g > max_rank || delta > max_rank ||
+        (!items.empty() && value < items.back().value)) {
+      throw std::invalid_argument("Invalid summary snapshot");
+    }
+    items.emplace_back(value, static_cast<std::int64_t>(g),
+                       static_cast<std::int64_t>(delta));
+  }
+  if (!decoder.Done()) {
+    throw std::invalid_argument("Invalid summary snapshot");
+  }
+
+  std::lock_guard<std::mutex> quantile_lock(quantile_mutex_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_ += count;
+    sum_ += sum;
+  }
+
+  quantile_values_.merge(items);
+}
+
+std::size_t Summary::MemoryUsage() const {
+  std::lock_guard<std::mutex> quantile_lock(quantile_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto bytes = sizeof(*this) + quantile_values_.memoryUsage() +
+               (pending_.capacity() + flushing_.capacity()) * sizeof(double);
+  if (quantiles_.use_count() == 1) {
+    bytes += quantiles_->capacity() * sizeof(Quantiles::value_type);
+  }
+  return bytes;
+}
+
+void Summary::FlushPending() const {
+  if (flushing_.empty()) {
+    return;
+  }
+
+  std::sort(flushing_.begin(), flushing_.end());
+  quantile_values_.insertSorted(flushing_);
+  flushing_.clear();
+}
+
 }  // namespace prometheus
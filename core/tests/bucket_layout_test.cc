@@ -0,0 +1,102 @@
+#include "prometheus/detail/bucket_layout.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "prometheus/histogram.h"
+
+namespace prometheus {
+namespace detail {
+namespace {
+
+std::size_t LowerBound(const std::vector<double>& boundaries, double value) {
+  return static_cast<std::size_t>(std::distance(
+      boundaries.begin(),
+      std::lower_bound(boundaries.begin(), boundaries.end(), value)));
+}
+
+void ExpectSameAsLowerBound(const BucketLayout& layout) {
+  const auto& boundaries = layout.Boundaries();
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<> d(boundaries.front() - 10,
+                                     boundaries.back() * 1.5 + 10);
+
+  for (int i = 0; i < 10000; ++i) {
+    const auto value = d(gen);
+    ASSERT_EQ(layout.Index(value), LowerBound(boundaries, value)) << value;
+  }
+  for (auto boundary : boundaries) {
+    for (auto value : {std::nextafter(boundary, -1e300), boundary,
+                       std::nextafter(boundary, 1e300)}) {
+      ASSERT_EQ(layout.Index(value), LowerBound(boundaries, value)) << value;
+    }
+  }
+  EXPECT_EQ(layout.Index(std::numeric_limits<double>::infinity()),
+            boundaries.size());
+  EXPECT_EQ(layout.Index(-std::numeric_limits<double>::infinity()), 0U);
+  EXPECT_EQ(layout.Index(std::numeric_limits<double>::quiet_NaN()), 0U);
+}
+
+TEST(BucketLayoutTest, detect_linear_layout) {
+  BucketLayout layout{LinearBuckets(-5, 0.1, 200)};
+  EXPECT_TRUE(layout.IsLinear());
+  ExpectSameAsLowerBound(layout);
+}
+
+TEST(BucketLayoutTest, detect_exponential_layout) {
+  BucketLayout layout{ExponentialBuckets(0.001, 1.5, 40)};
+  EXPECT_TRUE(layout.IsExponential());
+  ExpectSameAsLowerBound(layout);
+}
+
+TEST(BucketLayoutTest, search_irregular_layout) {
+  BucketLayout layout{{0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5}};
+  EXPECT_FALSE(layout.IsLinear());
+  EXPECT_FALSE(layout.IsExponential());
+  ExpectSameAsLowerBound(layout);
+}
+
+TEST(BucketLayoutTest, search_small_layouts) {
+  for (std::size_t n = 1; n < 20; ++n) {
+    std::vector<double> boundaries;
+    for (std::size_t i = 0; i < n; ++i) {
+      boundaries.push_back(static_cast<double>(i * i));
+    }
+    ExpectSameAsLowerBound(BucketLayout{boundaries});
+  }
+}
+
+TEST(BucketLayoutTest, empty_layout) {
+  BucketLayout layout{{}};
+  EXPECT_EQ(layout.BucketCount(), 1U);
+  EXPECT_EQ(layout.Index(1), 0U);
+}
+
+TEST(BucketLayoutTest, copies_share_boundaries) {
+  BucketLayout layout{{1, 2, 3}};
+  const auto copy = layout;
+  EXPECT_EQ(&layout.Boundaries(), &copy.Boundaries());
+}
+
+TEST(BucketLayoutTest, reject_unsorted_boundaries) {
+  EXPECT_THROW(BucketLayout({1, 2, 2}), std::invalid_argument);
+}
+
+TEST(BucketLayoutTest, reject_invalid_generator_arguments) {
+  EXPECT_THROW(LinearBuckets(0, 0, 10), std::invalid_argument);
+  EXPECT_THROW(LinearBuckets(0, 1, 0), std::invalid_argument);
+  EXPECT_THROW(ExponentialBuckets(0, 2, 10), std::invalid_argument);
+  EXPECT_THROW(ExponentialBuckets(1, 1, 10), std::invalid_argument);
+  EXPECT_THROW(ExponentialBuckets(1, 2, 0), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace detail
+}  // namespace prometheus
@@ -5,6 +5,7 @@
 #include <iterator>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -93,6 +94,84 @@ TEST_F(BuilderTest, build_histogram) {
   verifyCollectedLabels();
 }
 
+TEST_F(BuilderTest, build_histogram_with_shared_buckets) {
+  auto& family = BuildHistogram()
+                     .Name(name)
+                     .Help(help)
+                     .Labels(const_labels)
+                     .Buckets({1, 2})
+                     .Register(registry);
+  family.Add(more_labels);
+
+  verifyCollectedLabels();
+
+  const auto collected = registry.Collect();
+  const auto& buckets = collected.at(0).metric.at(0).histogram.bucket;
+  ASSERT_EQ(3U, buckets.size());
+  EXPECT_EQ(1, buckets.at(0).upper_bound);
+  EXPECT_EQ(2, buckets.at(1).upper_bound);
+}
+
+TEST_F(BuilderTest, build_sharded_histogram) {
+  auto& family = BuildHistogram()
+                     .Name(name)
+                     .Help(help)
+                     .Labels(const_labels)
+                     .Buckets({1, 2})
+                     .Shards(2)
+                     .Register(registry);
+  family.Add(more_labels).Observe(1.5);
+
+  verifyCollectedLabels();
+
+  const auto collected = registry.Collect();
+  const auto& histogram = collected.at(0).metric.at(0).histogram;
+  ASSERT_EQ(3U, histogram.bucket.size());
+  EXPECT_EQ(0U, histogram.bucket.at(0).cumulative_count);
+  EXPECT_EQ(1U, histogram.bucket.at(1).cumulative_count);
+  EXPECT_EQ(1.5, histogram.sample_sum);
+}
+
+TEST_F(BuilderTest, reject_sharded_histogram_without_buckets) {
+  EXPECT_THROW(BuildHistogram().Name(name).Shards(2).Register(registry),
+               std::invalid_argument);
+}
+
+TEST_F(BuilderTest, register_histogram_with_same_buckets) {
+  auto& family =
+      BuildHistogram().Name(name).Buckets({1, 2}).Shards(2).Register(registry);
+  auto& same =
+      BuildHistogram().Name(name).Buckets({1, 2}).Shards(2).Register(registry);
+  EXPECT_EQ(&family, &same);
+}
+
+TEST_F(BuilderTest, reject_histogram_with_other_buckets) {
+  auto& family = BuildHistogram().Name(name).Buckets({1, 2}).Register(registry);
+  EXPECT_THROW(BuildHistogram().Name(name).Buckets({1, 3}).Register(registry),
+               std::invalid_argument);
+  EXPECT_THROW(BuildHistogram().Name(name).Register(registry),
+               std::invalid_argument);
+  EXPECT_THROW(
+      BuildHistogram().Name(name).Buckets({1, 2}).Shards(2).Register(registry),
+      std::invalid_argument);
+
+  // the layout is forgotten along with the family
+  EXPECT_TRUE(registry.Remove(family));
+  EXPECT_NO_THROW(
+      BuildHistogram().Name(name).Buckets({1, 3}).Register(registry));
+}
+
+TEST_F(BuilderTest, reject_histogram_with_other_shards) {
+  BuildHistogram().Name(name).Buckets({1, 2}).Shards(2).Register(registry);
+  EXPECT_THROW(
+      BuildHistogram().Name(name).Buckets({1, 2}).Shards(4).Register(registry),
+      std::invalid_argument);
+}
+
+TEST_F(BuilderTest, reject_unsorted_shared_buckets) {
+  EXPECT_THROW(BuildHistogram().Buckets({2, 1}), std::invalid_argument);
+}
+
 TEST_F(BuilderTest, build_info) {
   auto& family =
       BuildInfo().Name(name).Help(help).Labels(const_labels).Register(registry);
@@ -0,0 +1,39 @@
+#include "prometheus/detail/coarse_clock.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+namespace prometheus {
+namespace {
+
+TEST(CoarseClockTest, steady_clock_is_monotonic) {
+  auto previous = detail::CoarseSteadyClock::now();
+  for (int i = 0; i < 1000; ++i) {
+    const auto current = detail::CoarseSteadyClock::now();
+    EXPECT_LE(previous, current);
+    previous = current;
+  }
+}
+
+TEST(CoarseClockTest, steady_clock_follows_steady_clock) {
+  const auto coarse = detail::CoarseSteadyClock::now();
+  const auto precise = std::chrono::steady_clock::now();
+
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(
+                precise - coarse)
+                .count(),
+            100);
+}
+
+TEST(CoarseClockTest, steady_clock_advances) {
+  const auto start = detail::CoarseSteadyClock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const auto stop = detail::CoarseSteadyClock::now();
+
+  EXPECT_GE(stop - start, std::chrono::milliseconds(25));
+}
+
+}  // namespace
+}  // namespace prometheus
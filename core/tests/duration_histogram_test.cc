@@ -0,0 +1,143 @@
+#include "prometheus/duration_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "prometheus/histogram.h"
+#include "prometheus/registry.h"
+#include "prometheus/scoped_timer.h"
+
+namespace prometheus {
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+TEST(DurationHistogramTest, initialize_with_zero) {
+  DurationHistogram histogram{{}};
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  ASSERT_EQ(h.bucket.size(), 1U);
+}
+
+TEST(DurationHistogramTest, bucket_bounds_in_seconds) {
+  DurationHistogram histogram{{milliseconds{5}, milliseconds{250}, seconds{2}}};
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 4U);
+  EXPECT_EQ(h.bucket.at(0).upper_bound, 0.005);
+  EXPECT_EQ(h.bucket.at(1).upper_bound, 0.25);
+  EXPECT_EQ(h.bucket.at(2).upper_bound, 2);
+  EXPECT_EQ(h.bucket.at(3).upper_bound,
+            std::numeric_limits<double>::infinity());
+}
+
+TEST(DurationHistogramTest, cumulative_bucket_count) {
+  DurationHistogram histogram{{milliseconds{1}, milliseconds{2}}};
+  histogram.Observe(nanoseconds{0});
+  histogram.Observe(microseconds{500});
+  histogram.Observe(milliseconds{1});
+  histogram.Observe(nanoseconds{1000001});
+  histogram.Observe(milliseconds{2});
+  histogram.Observe(seconds{3});
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 3U);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 3U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 5U);
+  EXPECT_EQ(h.bucket.at(2).cumulative_count, 6U);
+  EXPECT_EQ(h.sample_count, 6U);
+}
+
+TEST(DurationHistogramTest, sum_in_seconds) {
+  DurationHistogram histogram{{milliseconds{1}}};
+  histogram.Observe(milliseconds{1500});
+  histogram.ObserveNanoseconds(500000000);
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_sum, 2);
+}
+
+TEST(DurationHistogramTest, sum_beyond_int64_nanoseconds) {
+  DurationHistogram histogram{{milliseconds{1}}};
+  const auto max = nanoseconds{std::numeric_limits<std::int64_t>::max()};
+  histogram.Observe(max);
+  histogram.Observe(max);
+  auto h = histogram.Collect().histogram;
+  EXPECT_DOUBLE_EQ(h.sample_sum, 2 * (max.count() / 1e9));
+}
+
+TEST(DurationHistogramTest, sum_carries_into_seconds) {
+  DurationHistogram histogram{{milliseconds{1}}};
+  for (int i = 0; i < 3; ++i) histogram.Observe(seconds{700});
+  histogram.Observe(milliseconds{-1200300});
+  histogram.Observe(milliseconds{1});
+  auto h = histogram.Collect().histogram;
+  EXPECT_DOUBLE_EQ(h.sample_sum, 899.701);
+}
+
+TEST(DurationHistogramTest, reset) {
+  DurationHistogram histogram{{milliseconds{1}}};
+  histogram.Observe(milliseconds{2});
+  histogram.Reset();
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+}
+
+TEST(DurationHistogramTest, reject_unsorted_bucket_bounds) {
+  EXPECT_THROW(DurationHistogram({seconds{2}, seconds{1}}),
+               std::invalid_argument);
+  EXPECT_THROW(DurationHistogram({seconds{1}, milliseconds{1000}}),
+               std::invalid_argument);
+}
+
+TEST(DurationHistogramTest, concurrent_observe) {
+  DurationHistogram histogram{{microseconds{1}, microseconds{10}}};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram] {
+      for (int i = 0; i < 10000; ++i) {
+        histogram.Observe(milliseconds{i % 20} * 50 + microseconds{i % 20});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 40000U);
+  // each thread observes 500 times 0..19 (50 ms + 1 us)
+  EXPECT_NEAR(h.sample_sum, 4 * 500 * 190 * 0.050001, 1e-6);
+}
+
+TEST(DurationHistogramTest, scoped_timer) {
+  DurationHistogram histogram{{seconds{60}}};
+  {
+    ScopedTimer timer{histogram};
+    std::this_thread::sleep_for(milliseconds{1});
+  }
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 1U);
+  EXPECT_GE(h.sample_sum, 0.001);
+}
+
+TEST(DurationHistogramTest, register_family) {
+  Registry registry;
+  auto& family = BuildDurationHistogram().Name("latency").Register(registry);
+  family.Add({}, DurationHistogram::BucketBoundaries{milliseconds{1}})
+      .Observe(microseconds{10});
+  auto collected = registry.Collect();
+  ASSERT_EQ(collected.size(), 1U);
+  EXPECT_EQ(collected.at(0).type, MetricType::Histogram);
+  EXPECT_ANY_THROW(BuildHistogram().Name("latency").Register(registry));
+}
+
+}  // namespace
+}  // namespace prometheus
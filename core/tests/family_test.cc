@@ -4,12 +4,14 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <stdexcept>
 
 #include "prometheus/client_metric.h"
 #include "prometheus/counter.h"
 #include "prometheus/detail/future_std.h"
 #include "prometheus/histogram.h"
 #include "prometheus/labels.h"
+#include "prometheus/metric_filter.h"
 #include "prometheus/summary.h"
 
 namespace prometheus {
@@ -47,6 +49,19 @@ TEST(FamilyTest, counter_value) {
   EXPECT_EQ(1, collected[0].metric.at(0).counter.value);
 }
 
+TEST(FamilyTest, collect_matching) {
+  Family<Counter> family{"total_requests", "Counts all requests", {}};
+  family.Add({});
+
+  MetricFilter other;
+  other.AddName("other_requests");
+  EXPECT_TRUE(family.CollectMatching(other).empty());
+
+  MetricFilter same;
+  same.AddName("total_requests");
+  EXPECT_EQ(family.CollectMatching(same).size(), 1U);
+}
+
 TEST(FamilyTest, remove) {
   Family<Counter> family{"total_requests", "Counts all requests", {}};
   auto& counter1 = family.Add({{"name", "counter1"}});
@@ -73,6 +88,43 @@ TEST(FamilyTest, Histogram) {
   EXPECT_EQ(1U, collected[0].metric.at(0).histogram.sample_count);
 }
 
+TEST(FamilyTest, add_with_factory) {
+  const auto layout = detail::BucketLayout{{0, 1, 2}};
+  Family<Histogram> family{"request_latency", "Latency Histogram", {},
+                           [layout] {
+                             return detail::make_unique<Histogram>(layout);
+                           }};
+  auto& histogram1 = family.Add({{"name", "histogram1"}});
+  auto& histogram2 = family.Add({{"name", "histogram2"}});
+  histogram1.Observe(0.5);
+  histogram2.Observe(1.5);
+  auto h1 = histogram1.Collect().histogram;
+  auto h2 = histogram2.Collect().histogram;
+  ASSERT_EQ(h1.bucket.size(), 4U);
+  ASSERT_EQ(h2.bucket.size(), 4U);
+  EXPECT_EQ(h1.bucket.at(1).cumulative_count, 1U);
+  EXPECT_EQ(h2.bucket.at(2).cumulative_count, 1U);
+  EXPECT_EQ(h2.bucket.at(1).cumulative_count, 0U);
+}
+
+TEST(FamilyTest, add_existing_without_calling_factory) {
+  auto created = 0;
+  Family<Counter> family{"total_requests", "Counts all requests", {},
+                         [&created] {
+                           ++created;
+                           return detail::make_unique<Counter>();
+                         }};
+  auto& counter = family.Add({{"name", "counter1"}});
+  EXPECT_EQ(&counter, &family.Add({{"name", "counter1"}}));
+  EXPECT_EQ(created, 1);
+}
+
+TEST(FamilyTest, throw_on_add_without_required_arguments) {
+  Family<Histogram> family{"request_latency", "Latency Histogram", {}};
+  EXPECT_THROW(family.Add({{"name", "histogram1"}}), std::invalid_argument);
+  EXPECT_FALSE(family.Has({{"name", "histogram1"}}));
+}
+
 TEST(FamilyTest, add_twice) {
   Family<Counter> family{"total_requests", "Counts all requests", {}};
   auto& counter = family.Add({{"name", "counter1"}});
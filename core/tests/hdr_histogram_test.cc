@@ -0,0 +1,161 @@
+#include "prometheus/hdr_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "prometheus/native_histogram.h"
+#include "prometheus/registry.h"
+
+namespace prometheus {
+namespace {
+
+TEST(HdrHistogramTest, initialize_with_zero) {
+  HdrHistogram histogram{1e-6, 10, 3, {0.001, 0.01}};
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  ASSERT_EQ(h.bucket.size(), 3U);
+  EXPECT_EQ(h.bucket.at(0).upper_bound, 0.001);
+  EXPECT_EQ(h.bucket.at(1).upper_bound, 0.01);
+  EXPECT_EQ(h.bucket.at(2).upper_bound,
+            std::numeric_limits<double>::infinity());
+}
+
+TEST(HdrHistogramTest, reject_invalid_configuration) {
+  EXPECT_THROW(HdrHistogram(0, 10, 3), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(-1, 10, 3), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, 1.5, 3), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, std::nan(""), 3), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, std::ldexp(1.0, 63), 3), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, 10, 0), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, 10, 6), std::invalid_argument);
+  EXPECT_THROW(HdrHistogram(1, 10, 3, {2, 1}), std::invalid_argument);
+}
+
+TEST(HdrHistogramTest, recording_bucket_count) {
+  // 3 significant digits need 2048 sub-buckets per power of two
+  EXPECT_EQ(HdrHistogram(1, 2047, 3).RecordingBucketCount(), 2048U);
+  EXPECT_EQ(HdrHistogram(1, 2048, 3).RecordingBucketCount(), 3072U);
+  EXPECT_EQ(HdrHistogram(1, 4096, 3).RecordingBucketCount(), 4096U);
+  EXPECT_EQ(HdrHistogram(1, 2047, 1).RecordingBucketCount(), 128U);
+}
+
+TEST(HdrHistogramTest, cumulative_bucket_count) {
+  HdrHistogram histogram{1e-6, 10, 3, {0.001, 0.01, 0.1}};
+  histogram.Observe(0.0005);
+  histogram.Observe(0.002);
+  histogram.Observe(0.05);
+  histogram.Observe(0.0999);
+  histogram.Observe(5);
+  histogram.Observe(20);
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 4U);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 1U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 2U);
+  EXPECT_EQ(h.bucket.at(2).cumulative_count, 4U);
+  EXPECT_EQ(h.bucket.at(3).cumulative_count, 6U);
+  EXPECT_EQ(h.sample_count, 6U);
+  EXPECT_DOUBLE_EQ(h.sample_sum, 25.1524);
+}
+
+TEST(HdrHistogramTest, bounded_relative_error) {
+  for (auto value : {0.0123456, 1.5, 123.456, 9876.5}) {
+    HdrHistogram histogram{1e-6, 1e5, 3, {value * 0.999, value * 1.001}};
+    histogram.Observe(value);
+    auto h = histogram.Collect().histogram;
+    EXPECT_EQ(h.bucket.at(0).cumulative_count, 0U) << value;
+    EXPECT_EQ(h.bucket.at(1).cumulative_count, 1U) << value;
+  }
+}
+
+TEST(HdrHistogramTest, record_out_of_range_values) {
+  HdrHistogram histogram{1, 100, 2, {0, 100}};
+  histogram.Observe(-5);
+  histogram.Observe(std::nan(""));
+  histogram.Observe(0.5);
+  histogram.Observe(1000);
+  histogram.Observe(std::numeric_limits<double>::infinity());
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 3U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 5U);
+  EXPECT_EQ(h.sample_count, 5U);
+}
+
+TEST(HdrHistogramTest, reset) {
+  HdrHistogram histogram{1e-6, 10, 3, {1}};
+  histogram.Observe(0.5);
+  histogram.Observe(2);
+  histogram.Reset();
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 0U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 0U);
+}
+
+TEST(HdrHistogramTest, collect_native_buckets) {
+  HdrHistogram histogram{1e-6, 100, 2};
+  histogram.Observe(0);
+  histogram.Observe(0.75);
+  histogram.Observe(3);
+  histogram.Observe(3);
+  auto h = histogram.Collect().histogram;
+
+  // 2 significant digits record 128 sub-buckets per power of two
+  EXPECT_EQ(h.schema, 6);
+  EXPECT_EQ(h.sample_count, 4U);
+  EXPECT_DOUBLE_EQ(h.sample_sum, 6.75);
+  EXPECT_EQ(h.zero_count, 1U);
+  ASSERT_EQ(h.positive_span.size(), 2U);
+  EXPECT_EQ(h.positive_span.at(0).length, 1U);
+  EXPECT_EQ(h.positive_span.at(1).length, 1U);
+  ASSERT_EQ(h.positive_delta.size(), 2U);
+  EXPECT_EQ(h.positive_delta.at(0), 1);
+  EXPECT_EQ(h.positive_delta.at(1), 1);
+}
+
+TEST(HdrHistogramTest, collect_native_bucket_above_power_of_two) {
+  HdrHistogram histogram{1, 1e6, 3};
+  histogram.Observe(1024.5);
+  auto h = histogram.Collect().histogram;
+
+  // (1024, 1024 * 2^(1/256)] instead of the bucket ending at 1024
+  ASSERT_EQ(h.schema, 8);
+  ASSERT_EQ(h.positive_span.size(), 1U);
+  EXPECT_EQ(h.positive_span.at(0).offset, 10 * 256 + 1);
+}
+
+TEST(HdrHistogramTest, collect_native_buckets_without_downscaling) {
+  HdrHistogram histogram{1e-6, 100, 3};
+  for (int i = 0; i < 256; ++i) {
+    histogram.Observe(1 + (i + 0.5) / 256);
+  }
+  auto h = histogram.Collect().histogram;
+
+  EXPECT_EQ(h.schema, NativeHistogram::kMaxSchema);
+  EXPECT_EQ(h.sample_count, 256U);
+}
+
+TEST(HdrHistogramTest, native_schema_follows_precision) {
+  EXPECT_EQ(HdrHistogram(1e-6, 100, 1).Collect().histogram.schema, 3);
+  EXPECT_EQ(HdrHistogram(1e-6, 100, 3).Collect().histogram.schema,
+            NativeHistogram::kMaxSchema);
+}
+
+TEST(HdrHistogramTest, register_with_builder) {
+  Registry registry;
+  auto& family = BuildHdrHistogram().Name("latency_seconds").Register(registry);
+  family.Add({{"path", "/"}}, 1e-6, 60, 3, HdrHistogram::BucketBoundaries{1})
+      .Observe(0.5);
+  auto collected = registry.Collect();
+  ASSERT_EQ(collected.size(), 1U);
+  EXPECT_EQ(collected.at(0).type, MetricType::Histogram);
+  ASSERT_EQ(collected.at(0).metric.size(), 1U);
+  EXPECT_EQ(collected.at(0).metric.at(0).histogram.sample_count, 1U);
+}
+
+}  // namespace
+}  // namespace prometheus
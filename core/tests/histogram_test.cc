@@ -5,6 +5,8 @@
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace prometheus {
 namespace {
@@ -118,6 +120,48 @@ TEST(HistogramTest, observe_multiple_test_length_error) {
   ASSERT_THROW(histogram.ObserveMultiple({5, 9}, 20), std::length_error);
 }
 
+TEST(HistogramTest, observe_batch) {
+  Histogram batch{{1, 2}};
+  Histogram single{{1, 2}};
+  const std::vector<double> values{0, 0.5, 1, 1.5, 1.5, 2, 3, -1};
+  batch.ObserveBatch(values.data(), values.size());
+  for (auto value : values) {
+    single.Observe(value);
+  }
+  auto b = batch.Collect().histogram;
+  auto s = single.Collect().histogram;
+  EXPECT_EQ(b.sample_count, 8U);
+  EXPECT_EQ(b.sample_sum, s.sample_sum);
+  ASSERT_EQ(b.bucket.size(), 3U);
+  for (std::size_t i = 0; i < b.bucket.size(); ++i) {
+    EXPECT_EQ(b.bucket.at(i).cumulative_count, s.bucket.at(i).cumulative_count);
+  }
+}
+
+TEST(HistogramTest, observe_weighted) {
+  Histogram locked{{1, 2}};
+  Histogram sharded{{1, 2}, 2};
+  for (auto* histogram : {&locked, &sharded}) {
+    histogram->Observe(0.5, 3);
+    histogram->Observe(1.5, 0);
+    histogram->Observe(2.5, 2);
+    auto h = histogram->Collect().histogram;
+    EXPECT_EQ(h.sample_count, 5U);
+    EXPECT_EQ(h.sample_sum, 6.5);
+    EXPECT_EQ(h.bucket.at(0).cumulative_count, 3U);
+    EXPECT_EQ(h.bucket.at(1).cumulative_count, 3U);
+    EXPECT_EQ(h.bucket.at(2).cumulative_count, 5U);
+  }
+}
+
+TEST(HistogramTest, observe_empty_batch) {
+  Histogram histogram{{1, 2}};
+  histogram.ObserveBatch(nullptr, 0);
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+}
+
 TEST(HistogramTest, test_reset) {
   Histogram histogram{{1, 2}};
   histogram.ObserveMultiple({5, 9, 3}, 20);
@@ -138,6 +182,105 @@ TEST(HistogramTest, test_reset) {
   EXPECT_EQ(h.sample_sum, 54);
 }
 
+TEST(HistogramTest, linear_buckets) {
+  Histogram histogram{LinearBuckets(1, 2, 3)};
+  histogram.Observe(1);
+  histogram.Observe(4);
+  histogram.Observe(6);
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 4U);
+  EXPECT_EQ(h.bucket.at(0).upper_bound, 1);
+  EXPECT_EQ(h.bucket.at(2).upper_bound, 5);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 1U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 1U);
+  EXPECT_EQ(h.bucket.at(2).cumulative_count, 2U);
+  EXPECT_EQ(h.bucket.at(3).cumulative_count, 3U);
+}
+
+TEST(HistogramTest, exponential_buckets) {
+  Histogram histogram{ExponentialBuckets(1, 10, 3)};
+  histogram.Observe(0.5);
+  histogram.Observe(10);
+  histogram.Observe(11);
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 4U);
+  EXPECT_EQ(h.bucket.at(2).upper_bound, 100);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 1U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 2U);
+  EXPECT_EQ(h.bucket.at(2).cumulative_count, 3U);
+}
+
+TEST(HistogramTest, share_bucket_layout) {
+  const auto layout = detail::BucketLayout{{1, 2}};
+  Histogram histogram1{layout};
+  Histogram histogram2{layout};
+  histogram1.Observe(1.5);
+  auto h1 = histogram1.Collect().histogram;
+  auto h2 = histogram2.Collect().histogram;
+  ASSERT_EQ(h1.bucket.size(), 3U);
+  ASSERT_EQ(h2.bucket.size(), 3U);
+  EXPECT_EQ(h1.bucket.at(1).cumulative_count, 1U);
+  EXPECT_EQ(h2.bucket.at(1).cumulative_count, 0U);
+}
+
+TEST(HistogramTest, sharded_matches_locked) {
+  Histogram sharded{{1, 2}, 4};
+  Histogram locked{{1, 2}};
+  const std::vector<double> values{0, 0.5, 1, 1.5, 2, 3, -1};
+  for (auto* histogram : {&sharded, &locked}) {
+    for (auto value : values) {
+      histogram->Observe(value);
+    }
+    histogram->ObserveBatch(values.data(), values.size());
+    histogram->ObserveMultiple({1, 2, 3}, 10);
+  }
+  auto s = sharded.Collect().histogram;
+  auto l = locked.Collect().histogram;
+  EXPECT_EQ(s.sample_count, 20U);
+  EXPECT_EQ(s.sample_count, l.sample_count);
+  EXPECT_EQ(s.sample_sum, l.sample_sum);
+  ASSERT_EQ(s.bucket.size(), l.bucket.size());
+  for (std::size_t i = 0; i < s.bucket.size(); ++i) {
+    EXPECT_EQ(s.bucket.at(i).upper_bound, l.bucket.at(i).upper_bound);
+    EXPECT_EQ(s.bucket.at(i).cumulative_count, l.bucket.at(i).cumulative_count);
+  }
+}
+
+TEST(HistogramTest, sharded_reset) {
+  Histogram histogram{{1, 2}, 0};
+  histogram.Observe(1.5);
+  histogram.Reset();
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  histogram.Observe(2.5);
+  h = histogram.Collect().histogram;
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 0U);
+  EXPECT_EQ(h.bucket.at(2).cumulative_count, 1U);
+  EXPECT_EQ(h.sample_sum, 2.5);
+}
+
+TEST(HistogramTest, sharded_concurrent_observe) {
+  const auto layout = detail::BucketLayout{{1, 2}};
+  Histogram histogram{layout, 2};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram] {
+      for (int i = 0; i < 1000; ++i) {
+        histogram.Observe(1.5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 4000U);
+  EXPECT_EQ(h.sample_sum, 6000);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 0U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 4000U);
+}
+
 TEST(HistogramTest, sum_can_go_down) {
   Histogram histogram{{1}};
   auto metric1 = histogram.Collect();
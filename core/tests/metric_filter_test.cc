@@ -0,0 +1,101 @@
+#include "prometheus/metric_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace prometheus {
+namespace {
+
+TEST(MetricFilterTest, empty_filter_matches_everything) {
+  MetricFilter filter;
+  EXPECT_TRUE(filter.Empty());
+  EXPECT_TRUE(filter.Matches("any_name"));
+}
+
+TEST(MetricFilterTest, match_name) {
+  MetricFilter filter;
+  filter.AddName("requests_total");
+  EXPECT_FALSE(filter.Empty());
+  EXPECT_TRUE(filter.Matches("requests_total"));
+  EXPECT_FALSE(filter.Matches("requests"));
+  EXPECT_FALSE(filter.Matches("requests_total_2"));
+}
+
+TEST(MetricFilterTest, match_prefix) {
+  MetricFilter filter;
+  filter.AddPrefix("http_");
+  EXPECT_TRUE(filter.Matches("http_requests_total"));
+  EXPECT_TRUE(filter.Matches("http_"));
+  EXPECT_FALSE(filter.Matches("grpc_requests_total"));
+}
+
+TEST(MetricFilterTest, match_pattern) {
+  MetricFilter filter;
+  filter.AddPattern("(http|grpc)_requests_total");
+  EXPECT_TRUE(filter.Matches("http_requests_total"));
+  EXPECT_TRUE(filter.Matches("grpc_requests_total"));
+  EXPECT_FALSE(filter.Matches("http_requests_total_2"));
+  EXPECT_FALSE(filter.Matches("xhttp_requests_total"));
+}
+
+TEST(MetricFilterTest, match_literal_patterns) {
+  MetricFilter filter;
+  filter.AddPattern("up").AddPattern("process_.*");
+  EXPECT_TRUE(filter.Matches("up"));
+  EXPECT_FALSE(filter.Matches("upper"));
+  EXPECT_TRUE(filter.Matches("process_cpu_seconds_total"));
+  EXPECT_FALSE(filter.Matches("go_goroutines"));
+}
+
+TEST(MetricFilterTest, match_any_of_multiple) {
+  MetricFilter filter;
+  filter.AddName("up").AddPrefix("http_").AddPattern(".*_seconds");
+  EXPECT_TRUE(filter.Matches("up"));
+  EXPECT_TRUE(filter.Matches("http_requests_total"));
+  EXPECT_TRUE(filter.Matches("latency_seconds"));
+  EXPECT_FALSE(filter.Matches("latency_seconds_total"));
+}
+
+TEST(MetricFilterTest, match_wildcards) {
+  MetricFilter filter;
+  filter.AddPattern("http_.*_(seconds|bytes).*|go_.*.*_total");
+  EXPECT_TRUE(filter.Matches("http_request_seconds"));
+  EXPECT_TRUE(filter.Matches("http_response_bytes_count"));
+  EXPECT_TRUE(filter.Matches("go_gc_total"));
+  EXPECT_FALSE(filter.Matches("http_requests_total"));
+  EXPECT_FALSE(filter.Matches("go_gc_seconds"));
+}
+
+TEST(MetricFilterTest, throw_on_malformed_pattern) {
+  MetricFilter filter;
+  EXPECT_THROW(filter.AddPattern("(unbalanced"), std::invalid_argument);
+  EXPECT_THROW(filter.AddPattern("unbalanced)"), std::invalid_argument);
+}
+
+TEST(MetricFilterTest, throw_on_backtracking_pattern) {
+  MetricFilter filter;
+  EXPECT_THROW(filter.AddPattern("(a+)+b"), std::invalid_argument);
+  EXPECT_THROW(filter.AddPattern("((a|b)|c)"), std::invalid_argument);
+  EXPECT_THROW(filter.AddPattern("a{1,100}"), std::invalid_argument);
+  EXPECT_THROW(filter.AddPattern("(.*)*x"), std::invalid_argument);
+  EXPECT_TRUE(filter.Empty());
+}
+
+TEST(MetricFilterTest, throw_on_oversized_pattern) {
+  MetricFilter filter;
+  EXPECT_THROW(filter.AddPattern(std::string(1025, 'a')),
+               std::invalid_argument);
+  // 2^7 alternatives
+  auto pattern = std::string{};
+  for (int i = 0; i < 7; ++i) pattern += "(a|b)";
+  EXPECT_THROW(filter.AddPattern(pattern), std::invalid_argument);
+  EXPECT_TRUE(filter.Empty());
+
+  filter.AddPattern(std::string(1024, 'a'));
+  EXPECT_TRUE(filter.Matches(std::string(1024, 'a')));
+}
+
+}  // namespace
+}  // namespace prometheus
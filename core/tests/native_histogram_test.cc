@@ -0,0 +1,159 @@
+#include "prometheus/native_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace prometheus {
+namespace {
+
+TEST(NativeHistogramTest, initialize_with_zero) {
+  NativeHistogram histogram;
+  auto metric = histogram.Collect();
+  auto h = metric.histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  EXPECT_EQ(h.schema, 3);
+  EXPECT_EQ(h.zero_count, 0U);
+  EXPECT_TRUE(h.bucket.empty());
+  ASSERT_EQ(h.positive_span.size(), 1U);
+  EXPECT_EQ(h.positive_span[0].offset, 0);
+  EXPECT_EQ(h.positive_span[0].length, 0U);
+  EXPECT_TRUE(h.positive_delta.empty());
+}
+
+TEST(NativeHistogramTest, sample_count_and_sum) {
+  NativeHistogram histogram;
+  histogram.Observe(0);
+  histogram.Observe(1);
+  histogram.Observe(101);
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 3U);
+  EXPECT_EQ(h.sample_sum, 102);
+}
+
+TEST(NativeHistogramTest, powers_of_two_are_upper_bounds) {
+  NativeHistogram histogram{0};
+  histogram.Observe(1);
+  histogram.Observe(2);
+  histogram.Observe(3);
+  histogram.Observe(4);
+  auto h = histogram.Collect().histogram;
+  // buckets (0.5, 1], (1, 2] and (2, 4] with counts 1, 1 and 2
+  ASSERT_EQ(h.positive_span.size(), 1U);
+  EXPECT_EQ(h.positive_span[0].offset, 0);
+  EXPECT_EQ(h.positive_span[0].length, 3U);
+  ASSERT_EQ(h.positive_delta.size(), 3U);
+  EXPECT_EQ(h.positive_delta[0], 1);
+  EXPECT_EQ(h.positive_delta[1], 0);
+  EXPECT_EQ(h.positive_delta[2], 1);
+}
+
+TEST(NativeHistogramTest, bucket_index_for_positive_schema) {
+  NativeHistogram histogram{3};
+  const auto base = std::exp2(1.0 / 8);
+  histogram.Observe(1.0);
+  histogram.Observe(base * 1.01);
+  auto h = histogram.Collect().histogram;
+  // indices 0 and 2
+  ASSERT_EQ(h.positive_span.size(), 2U);
+  EXPECT_EQ(h.positive_span[0].offset, 0);
+  EXPECT_EQ(h.positive_span[0].length, 1U);
+  EXPECT_EQ(h.positive_span[1].offset, 1);
+  EXPECT_EQ(h.positive_span[1].length, 1U);
+}
+
+TEST(NativeHistogramTest, sparse_spans) {
+  NativeHistogram histogram{0};
+  histogram.Observe(0.25);
+  histogram.Observe(1024);
+  histogram.Observe(1024);
+  auto h = histogram.Collect().histogram;
+  // index -2 and index 10
+  ASSERT_EQ(h.positive_span.size(), 2U);
+  EXPECT_EQ(h.positive_span[0].offset, -2);
+  EXPECT_EQ(h.positive_span[0].length, 1U);
+  EXPECT_EQ(h.positive_span[1].offset, 11);
+  EXPECT_EQ(h.positive_span[1].length, 1U);
+  ASSERT_EQ(h.positive_delta.size(), 2U);
+  EXPECT_EQ(h.positive_delta[0], 1);
+  EXPECT_EQ(h.positive_delta[1], 1);
+}
+
+TEST(NativeHistogramTest, negative_and_zero_buckets) {
+  NativeHistogram histogram{0, 0, 0.001};
+  histogram.Observe(-3);
+  histogram.Observe(0);
+  histogram.Observe(-0.0005);
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.zero_count, 2U);
+  EXPECT_EQ(h.zero_threshold, 0.001);
+  EXPECT_TRUE(h.positive_span.empty());
+  ASSERT_EQ(h.negative_span.size(), 1U);
+  EXPECT_EQ(h.negative_span[0].offset, 2);
+  EXPECT_EQ(h.negative_span[0].length, 1U);
+  ASSERT_EQ(h.negative_delta.size(), 1U);
+  EXPECT_EQ(h.negative_delta[0], 1);
+}
+
+TEST(NativeHistogramTest, nan_and_infinity) {
+  NativeHistogram histogram;
+  histogram.Observe(std::numeric_limits<double>::quiet_NaN());
+  histogram.Observe(std::numeric_limits<double>::infinity());
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 2U);
+  ASSERT_EQ(h.positive_span.size(), 1U);
+  EXPECT_EQ(h.positive_span[0].length, 1U);
+}
+
+TEST(NativeHistogramTest, reduce_resolution) {
+  NativeHistogram histogram{3, 4};
+  for (int i = 0; i < 100; ++i) {
+    histogram.Observe(1 + i * 0.1);
+  }
+  auto h = histogram.Collect().histogram;
+  EXPECT_LT(h.schema, 3);
+  EXPECT_EQ(h.schema, histogram.Schema());
+
+  auto buckets = 0U;
+  std::int64_t count = 0;
+  std::int64_t total = 0;
+  for (auto& span : h.positive_span) {
+    buckets += span.length;
+  }
+  for (auto delta : h.positive_delta) {
+    count += delta;
+    total += count;
+  }
+  EXPECT_LE(buckets, 4U);
+  EXPECT_EQ(total, 100);
+}
+
+TEST(NativeHistogramTest, reset) {
+  NativeHistogram histogram{3, 2};
+  histogram.Observe(1);
+  histogram.Observe(10);
+  histogram.Observe(100);
+  histogram.Reset();
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+  EXPECT_EQ(h.schema, 3);
+  EXPECT_TRUE(h.positive_delta.empty());
+}
+
+TEST(NativeHistogramTest, throw_on_invalid_arguments) {
+  EXPECT_THROW(NativeHistogram{NativeHistogram::kMinSchema - 1},
+               std::invalid_argument);
+  EXPECT_THROW(NativeHistogram{NativeHistogram::kMaxSchema + 1},
+               std::invalid_argument);
+  EXPECT_THROW((NativeHistogram{3, 10, -1.0}), std::invalid_argument);
+  EXPECT_THROW(
+      (NativeHistogram{3, 10, std::numeric_limits<double>::quiet_NaN()}),
+      std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace prometheus
@@ -0,0 +1,264 @@
+#include "prometheus/protobuf_serializer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "prometheus/client_metric.h"
+#include "prometheus/metric_family.h"
+#include "prometheus/metric_type.h"
+#include "prometheus/native_histogram.h"
+
+namespace prometheus {
+namespace {
+
+// Minimal reader of the protobuf wire format to inspect the output
+struct Field {
+  std::uint32_t number;
+  std::uint64_t varint;
+  double fixed64;
+  std::string bytes;
+};
+
+class Reader {
+ public:
+  explicit Reader(const std::string& data) : data_(data) {}
+
+  bool Done() const { return pos_ == data_.size(); }
+
+  std::uint64_t ReadVarint() {
+    std::uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      const auto byte = static_cast<unsigned char>(data_.at(pos_++));
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+  }
+
+  std::string ReadBytes() {
+    const auto size = ReadVarint();
+    auto result = data_.substr(pos_, size);
+    pos_ += size;
+    return result;
+  }
+
+  Field ReadField() {
+    Field field{};
+    const auto tag = ReadVarint();
+    field.number = static_cast<std::uint32_t>(tag >> 3);
+    switch (tag & 7) {
+      case 0:
+        field.varint = ReadVarint();
+        break;
+      case 1:
+        std::memcpy(&field.fixed64, data_.data() + pos_, sizeof(double));
+        pos_ += sizeof(double);
+        break;
+      case 2:
+        field.bytes = ReadBytes();
+        break;
+      default:
+        ADD_FAILURE() << "unexpected wire type";
+        pos_ = data_.size();
+    }
+    return field;
+  }
+
+ private:
+  const std::string& data_;
+  std::size_t pos_ = 0;
+};
+
+std::vector<Field> ReadFields(const std::string& message) {
+  std::vector<Field> fields;
+  Reader reader{message};
+  while (!reader.Done()) {
+    fields.push_back(reader.ReadField());
+  }
+  return fields;
+}
+
+std::int64_t ZigZag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+class ProtobufSerializerTest : public testing::Test {
+ public:
+  std::vector<Field> SerializeSingle(MetricType type) const {
+    MetricFamily family;
+    family.name = "my_metric";
+    family.help = "my metric help text";
+    family.type = type;
+    family.metric = std::vector<ClientMetric>{metric};
+
+    const auto output = serializer.Serialize({family});
+    Reader reader{output};
+    auto message = reader.ReadBytes();
+    EXPECT_TRUE(reader.Done());
+    return ReadFields(message);
+  }
+
+  ClientMetric metric;
+  ProtobufSerializer serializer;
+};
+
+TEST_F(ProtobufSerializerTest, shouldSerializeCounter) {
+  metric.counter.value = 42;
+  auto label = ClientMetric::Label{};
+  label.name = "key";
+  label.value = "value";
+  metric.label.push_back(label);
+
+  auto family = SerializeSingle(MetricType::Counter);
+  ASSERT_EQ(family.size(), 4U);
+  EXPECT_EQ(family[0].number, 1U);
+  EXPECT_EQ(family[0].bytes, "my_metric");
+  EXPECT_EQ(family[1].number, 2U);
+  EXPECT_EQ(family[1].bytes, "my metric help text");
+  EXPECT_EQ(family[2].number, 3U);
+  EXPECT_EQ(family[2].varint, 0U);
+  EXPECT_EQ(family[3].number, 4U);
+
+  auto m = ReadFields(family[3].bytes);
+  ASSERT_EQ(m.size(), 2U);
+  EXPECT_EQ(m[0].number, 1U);
+  auto l = ReadFields(m[0].bytes);
+  ASSERT_EQ(l.size(), 2U);
+  EXPECT_EQ(l[0].bytes, "key");
+  EXPECT_EQ(l[1].bytes, "value");
+  EXPECT_EQ(m[1].number, 3U);
+  auto counter = ReadFields(m[1].bytes);
+  ASSERT_EQ(counter.size(), 1U);
+  EXPECT_EQ(counter[0].fixed64, 42);
+}
+
+TEST_F(ProtobufSerializerTest, shouldSerializeInfoAsGauge) {
+  auto family = SerializeSingle(MetricType::Info);
+  EXPECT_EQ(family[0].bytes, "my_metric_info");
+  EXPECT_EQ(family[2].varint, 1U);
+  auto m = ReadFields(family[3].bytes);
+  ASSERT_EQ(m.size(), 1U);
+  EXPECT_EQ(m[0].number, 2U);
+  EXPECT_EQ(ReadFields(m[0].bytes)[0].fixed64, 1);
+}
+
+TEST_F(ProtobufSerializerTest, shouldSerializeSummary) {
+  metric.summary.sample_count = 3;
+  metric.summary.sample_sum = 6;
+  auto quantile = ClientMetric::Quantile{};
+  quantile.quantile = 0.5;
+  quantile.value = 2;
+  metric.summary.quantile.push_back(quantile);
+
+  auto family = SerializeSingle(MetricType::Summary);
+  EXPECT_EQ(family[2].varint, 2U);
+  auto m = ReadFields(family[3].bytes);
+  ASSERT_EQ(m.size(), 1U);
+  EXPECT_EQ(m[0].number, 4U);
+  auto s = ReadFields(m[0].bytes);
+  ASSERT_EQ(s.size(), 3U);
+  EXPECT_EQ(s[0].varint, 3U);
+  EXPECT_EQ(s[1].fixed64, 6);
+  auto q = ReadFields(s[2].bytes);
+  EXPECT_EQ(q[0].fixed64, 0.5);
+  EXPECT_EQ(q[1].fixed64, 2);
+}
+
+TEST_F(ProtobufSerializerTest, shouldSerializeTimestamp) {
+  metric.timestamp_ms = 1234;
+  auto m = ReadFields(SerializeSingle(MetricType::Gauge)[3].bytes);
+  ASSERT_EQ(m.size(), 2U);
+  EXPECT_EQ(m[1].number, 6U);
+  EXPECT_EQ(m[1].varint, 1234U);
+}
+
+TEST_F(ProtobufSerializerTest, shouldSerializeNativeHistogram) {
+  NativeHistogram histogram{0};
+  histogram.Observe(0.25);
+  histogram.Observe(1024);
+  histogram.Observe(-3);
+  metric = histogram.Collect();
+
+  auto family = SerializeSingle(MetricType::Histogram);
+  EXPECT_EQ(family[2].varint, 4U);
+  auto m = ReadFields(family[3].bytes);
+  ASSERT_EQ(m.size(), 1U);
+  EXPECT_EQ(m[0].number, 7U);
+
+  std::vector<std::pair<std::int64_t, std::uint64_t>> positive_spans;
+  std::vector<std::int64_t> positive_deltas;
+  std::vector<std::int64_t> negative_deltas;
+  bool has_schema = false;
+  for (auto& field : ReadFields(m[0].bytes)) {
+    switch (field.number) {
+      case 1:
+        EXPECT_EQ(field.varint, 3U);
+        break;
+      case 5:
+        has_schema = true;
+        EXPECT_EQ(ZigZag(field.varint), 0);
+        break;
+      case 10:
+        negative_deltas.push_back(ZigZag(field.varint));
+        break;
+      case 12: {
+        auto span = ReadFields(field.bytes);
+        ASSERT_EQ(span.size(), 2U);
+        positive_spans.emplace_back(ZigZag(span[0].varint), span[1].varint);
+        break;
+      }
+      case 13:
+        positive_deltas.push_back(ZigZag(field.varint));
+        break;
+    }
+  }
+
+  EXPECT_TRUE(has_schema);
+  ASSERT_EQ(positive_spans.size(), 2U);
+  EXPECT_EQ(positive_spans[0].first, -2);
+  EXPECT_EQ(positive_spans[1].first, 11);
+  EXPECT_EQ(positive_deltas, (std::vector<std::int64_t>{1, 0}));
+  EXPECT_EQ(negative_deltas, (std::vector<std::int64_t>{1}));
+}
+
+TEST_F(ProtobufSerializerTest, shouldOmitNativeFieldsOfClassicHistogram) {
+  auto bucket = ClientMetric::Bucket{};
+  bucket.cumulative_count = 1;
+  bucket.upper_bound = 2;
+  metric.histogram.bucket.push_back(bucket);
+
+  auto m = ReadFields(SerializeSingle(MetricType::Histogram)[3].bytes);
+  auto h = ReadFields(m[0].bytes);
+  ASSERT_EQ(h.size(), 3U);
+  EXPECT_EQ(h[2].number, 3U);
+  auto b = ReadFields(h[2].bytes);
+  EXPECT_EQ(b[0].varint, 1U);
+  EXPECT_EQ(b[1].fixed64, 2);
+}
+
+TEST_F(ProtobufSerializerTest, shouldDelimitFamilies) {
+  MetricFamily family;
+  family.name = "a";
+  family.type = MetricType::Untyped;
+  family.metric.emplace_back();
+
+  const auto output = serializer.Serialize({family, family});
+  Reader reader{output};
+  auto first = ReadFields(reader.ReadBytes());
+  auto second = ReadFields(reader.ReadBytes());
+  EXPECT_TRUE(reader.Done());
+  ASSERT_EQ(first.size(), 3U);
+  EXPECT_EQ(first[0].bytes, "a");
+  EXPECT_EQ(first[1].varint, 3U);
+  EXPECT_EQ(second.size(), 3U);
+}
+
+}  // namespace
+}  // namespace prometheus
@@ -9,6 +9,8 @@
 #include "prometheus/gauge.h"
 #include "prometheus/histogram.h"
 #include "prometheus/info.h"
+#include "prometheus/metric_filter.h"
+#include "prometheus/native_histogram.h"
 #include "prometheus/summary.h"
 
 namespace prometheus {
@@ -31,6 +33,22 @@ TEST(RegistryTest, collect_single_metric_family) {
   EXPECT_EQ(collected[0].metric.at(1).label.at(0).name, "name");
 }
 
+TEST(RegistryTest, collect_matching_metric_families) {
+  Registry registry{};
+  BuildCounter().Name("http_requests_total").Register(registry).Add({});
+  BuildGauge().Name("http_connections").Register(registry).Add({});
+  BuildGauge().Name("queue_length").Register(registry).Add({});
+
+  MetricFilter filter;
+  filter.AddPrefix("http_");
+  auto collected = registry.CollectMatching(filter);
+  ASSERT_EQ(collected.size(), 2U);
+  EXPECT_EQ(collected[0].name, "http_requests_total");
+  EXPECT_EQ(collected[1].name, "http_connections");
+
+  EXPECT_EQ(registry.CollectMatching(MetricFilter{}).size(), 3U);
+}
+
 TEST(RegistryTest, build_histogram_family) {
   Registry registry{};
   auto& histogram_family =
@@ -111,6 +129,18 @@ TEST(RegistryTest, reject_different_type_than_summary) {
   EXPECT_ANY_THROW(BuildInfo().Name(same_name).Register(registry));
 }
 
+TEST(RegistryTest, reject_different_type_than_native_histogram) {
+  const auto same_name = std::string{"same_name"};
+  Registry registry{};
+
+  EXPECT_NO_THROW(BuildNativeHistogram().Name(same_name).Register(registry));
+  EXPECT_ANY_THROW(BuildCounter().Name(same_name).Register(registry));
+  EXPECT_ANY_THROW(BuildGauge().Name(same_name).Register(registry));
+  EXPECT_ANY_THROW(BuildHistogram().Name(same_name).Register(registry));
+  EXPECT_ANY_THROW(BuildInfo().Name(same_name).Register(registry));
+  EXPECT_ANY_THROW(BuildSummary().Name(same_name).Register(registry));
+}
+
 TEST(RegistryTest, throw_for_same_family_name) {
   const auto same_name = std::string{"same_name"};
   Registry registry{Registry::InsertBehavior::Throw};
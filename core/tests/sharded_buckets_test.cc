@@ -0,0 +1,64 @@
+#include "prometheus/detail/sharded_buckets.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace prometheus {
+namespace detail {
+namespace {
+
+TEST(ShardedBucketsTest, initialize_with_zero) {
+  ShardedBuckets buckets{3, 4};
+  EXPECT_EQ(buckets.ShardCount(), 4U);
+  EXPECT_EQ(buckets.Counts(), std::vector<std::uint64_t>(3));
+  EXPECT_EQ(buckets.Sum(), 0);
+}
+
+TEST(ShardedBucketsTest, default_shard_count) {
+  ShardedBuckets buckets{3, 0};
+  EXPECT_GE(buckets.ShardCount(), 1U);
+}
+
+TEST(ShardedBucketsTest, increment) {
+  ShardedBuckets buckets{3, 4};
+  buckets.Increment(0, 1);
+  buckets.Increment(2, 5);
+  buckets.IncrementSum(1.5);
+  buckets.IncrementSum(-0.5);
+  EXPECT_EQ(buckets.Counts(), (std::vector<std::uint64_t>{1, 0, 5}));
+  EXPECT_EQ(buckets.Sum(), 1);
+}
+
+TEST(ShardedBucketsTest, reset) {
+  ShardedBuckets buckets{2, 4};
+  buckets.Increment(1, 3);
+  buckets.IncrementSum(2);
+  buckets.Reset();
+  EXPECT_EQ(buckets.Counts(), std::vector<std::uint64_t>(2));
+  EXPECT_EQ(buckets.Sum(), 0);
+}
+
+TEST(ShardedBucketsTest, sum_up_shards_of_all_threads) {
+  ShardedBuckets buckets{1, 3};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&buckets] {
+      for (int i = 0; i < 1000; ++i) {
+        buckets.Increment(0, 1);
+        buckets.IncrementSum(0.5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(buckets.Counts(), std::vector<std::uint64_t>{8000});
+  EXPECT_EQ(buckets.Sum(), 4000);
+}
+
+}  // namespace
+}  // namespace detail
+}  // namespace prometheus
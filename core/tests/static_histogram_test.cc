@@ -0,0 +1,146 @@
+#include "prometheus/static_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <ratio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "prometheus/histogram.h"
+#include "prometheus/registry.h"
+
+namespace prometheus {
+namespace {
+
+using OneTwo = StaticHistogram<std::ratio<1>, std::ratio<2>>;
+
+TEST(StaticHistogramTest, initialize_with_zero) {
+  OneTwo histogram;
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+}
+
+TEST(StaticHistogramTest, bucket_bounds) {
+  StaticHistogram<std::milli, std::ratio<1, 4>, std::ratio<3>> histogram;
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 4U);
+  EXPECT_EQ(h.bucket.at(0).upper_bound, 0.001);
+  EXPECT_EQ(h.bucket.at(1).upper_bound, 0.25);
+  EXPECT_EQ(h.bucket.at(2).upper_bound, 3);
+  EXPECT_EQ(h.bucket.at(3).upper_bound,
+            std::numeric_limits<double>::infinity());
+}
+
+TEST(StaticHistogramTest, without_boundaries) {
+  StaticHistogram<> histogram;
+  histogram.Observe(42);
+  auto h = histogram.Collect().histogram;
+  ASSERT_EQ(h.bucket.size(), 1U);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 1U);
+}
+
+TEST(StaticHistogramTest, same_as_histogram) {
+  OneTwo static_histogram;
+  Histogram histogram{{1, 2}};
+  const std::vector<double> values{
+      -1, 0, 0.5, 1, 1.5, 2, 3, std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::infinity()};
+  for (auto value : values) {
+    static_histogram.Observe(value);
+    histogram.Observe(value);
+  }
+  auto s = static_histogram.Collect().histogram;
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(s.sample_count, h.sample_count);
+  ASSERT_EQ(s.bucket.size(), h.bucket.size());
+  for (std::size_t i = 0; i < s.bucket.size(); ++i) {
+    EXPECT_EQ(s.bucket.at(i).cumulative_count, h.bucket.at(i).cumulative_count);
+    EXPECT_EQ(s.bucket.at(i).upper_bound, h.bucket.at(i).upper_bound);
+  }
+}
+
+TEST(StaticHistogramTest, reset) {
+  OneTwo histogram;
+  histogram.Observe(1.5);
+  histogram.Reset();
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 0U);
+  EXPECT_EQ(h.sample_sum, 0);
+}
+
+TEST(StaticHistogramTest, register_family) {
+  Registry registry;
+  auto& family = BuildStaticHistogram<OneTwo>()
+                     .Name("latency")
+                     .Help("help")
+                     .Register(registry);
+  auto& histogram = static_cast<OneTwo&>(family.Add({{"method", "GET"}}));
+  histogram.Observe(1.5);
+
+  auto collected = registry.Collect();
+  ASSERT_EQ(collected.size(), 1U);
+  EXPECT_EQ(collected.at(0).type, MetricType::Histogram);
+  ASSERT_EQ(collected.at(0).metric.size(), 1U);
+  auto h = collected.at(0).metric.at(0).histogram;
+  ASSERT_EQ(h.bucket.size(), 3U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 1U);
+
+  EXPECT_ANY_THROW(BuildHistogram().Name("latency").Register(registry));
+  EXPECT_TRUE(registry.Remove(family));
+}
+
+TEST(StaticHistogramTest, register_family_with_same_boundaries) {
+  Registry registry;
+  auto& family =
+      BuildStaticHistogram<OneTwo>().Name("latency").Register(registry);
+  auto& same = BuildStaticHistogram<
+                   StaticHistogram<std::ratio<2, 2>, std::ratio<4, 2>>>()
+                   .Name("latency")
+                   .Register(registry);
+  EXPECT_EQ(&family, &same);
+}
+
+TEST(StaticHistogramTest, throw_on_other_boundaries) {
+  Registry registry;
+  auto& family =
+      BuildStaticHistogram<OneTwo>().Name("latency").Register(registry);
+  using OneThree = StaticHistogram<std::ratio<1>, std::ratio<3>>;
+  EXPECT_THROW(
+      BuildStaticHistogram<OneThree>().Name("latency").Register(registry),
+      std::invalid_argument);
+
+  // the layout is forgotten along with the family
+  EXPECT_TRUE(registry.Remove(family));
+  EXPECT_NO_THROW(
+      BuildStaticHistogram<OneThree>().Name("latency").Register(registry));
+}
+
+TEST(StaticHistogramTest, concurrently_register_other_boundaries) {
+  using OneThree = StaticHistogram<std::ratio<1>, std::ratio<3>>;
+  for (int round = 0; round < 100; ++round) {
+    Registry registry;
+    int registered[2] = {0, 0};
+    std::thread other{[&registry, &registered] {
+      try {
+        BuildStaticHistogram<OneThree>().Name("latency").Register(registry);
+        ++registered[1];
+      } catch (const std::invalid_argument&) {
+      }
+    }};
+    try {
+      BuildStaticHistogram<OneTwo>().Name("latency").Register(registry);
+      ++registered[0];
+    } catch (const std::invalid_argument&) {
+    }
+    other.join();
+
+    // exactly one of the boundaries wins
+    ASSERT_EQ(registered[0] + registered[1], 1);
+  }
+}
+
+}  // namespace
+}  // namespace prometheus
@@ -0,0 +1,78 @@
+#include "prometheus/stopwatch.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "prometheus/detail/tsc_clock.h"
+#include "prometheus/hdr_histogram.h"
+#include "prometheus/histogram.h"
+#include "prometheus/scoped_timer.h"
+#include "prometheus/summary.h"
+
+namespace prometheus {
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+TEST(StopwatchTest, calibration_is_stable) {
+  const auto& calibration = detail::TscClock::GetCalibration();
+  EXPECT_EQ(&calibration, &detail::TscClock::GetCalibration());
+  if (calibration.available) {
+    // between 0.1 and 100 GHz
+    EXPECT_GT(calibration.nanoseconds_per_tick, 0.01);
+    EXPECT_LT(calibration.nanoseconds_per_tick, 10);
+  }
+}
+
+TEST(StopwatchTest, measure_elapsed_time) {
+  const auto start = steady_clock::now();
+  Stopwatch stopwatch;
+  std::this_thread::sleep_for(milliseconds{5});
+  const auto elapsed = stopwatch.Elapsed();
+  const auto upper_bound = steady_clock::now() - start;
+
+  // allow for a calibration error of 1%
+  EXPECT_GE(elapsed, milliseconds{5} * 99 / 100);
+  EXPECT_LE(elapsed, upper_bound * 101 / 100);
+  EXPECT_NEAR(stopwatch.ElapsedSeconds(), 0.005, 0.5);
+}
+
+TEST(StopwatchTest, restart) {
+  Stopwatch stopwatch;
+  std::this_thread::sleep_for(milliseconds{20});
+  stopwatch.Restart();
+  EXPECT_LT(stopwatch.Elapsed(), milliseconds{20});
+}
+
+TEST(StopwatchTest, scoped_timer_observes_seconds) {
+  Histogram histogram{{0.001, 60}};
+  Summary summary{Summary::Quantiles{}};
+  HdrHistogram hdr_histogram{1e-6, 60, 3, {60}};
+  {
+    ScopedTimer histogram_timer{histogram};
+    ScopedTimer summary_timer{summary};
+    ScopedTimer hdr_histogram_timer{hdr_histogram};
+    std::this_thread::sleep_for(milliseconds{2});
+  }
+
+  auto h = histogram.Collect().histogram;
+  EXPECT_EQ(h.sample_count, 1U);
+  EXPECT_EQ(h.bucket.at(0).cumulative_count, 0U);
+  EXPECT_EQ(h.bucket.at(1).cumulative_count, 1U);
+  EXPECT_GT(h.sample_sum, 0.001);
+  EXPECT_LT(h.sample_sum, 60);
+
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, 1U);
+  EXPECT_GT(s.sample_sum, 0.001);
+
+  auto hdr = hdr_histogram.Collect().histogram;
+  EXPECT_EQ(hdr.sample_count, 1U);
+  EXPECT_GT(hdr.sample_sum, 0.001);
+}
+
+}  // namespace
+}  // namespace prometheus
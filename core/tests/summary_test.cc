@@ -6,7 +6,10 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace prometheus {
 namespace {
@@ -71,6 +74,73 @@ TEST(SummaryTest, quantile_values) {
   EXPECT_NEAR(s.quantile.at(2).value, 0.99 * SAMPLES, 0.001 * SAMPLES);
 }
 
+TEST(SummaryTest, weighted_count_and_sum) {
+  Summary summary{Summary::Quantiles{{0.5, 0.05}}};
+  summary.Observe(2, 3);
+  summary.Observe(5, 0);
+  summary.Observe(1, 1);
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, 4U);
+  EXPECT_EQ(s.sample_sum, 7);
+}
+
+TEST(SummaryTest, weighted_quantile_values) {
+  static const int VALUES = 1000;
+  static const int WEIGHT = 100;
+
+  Summary summary{Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}},
+                  std::chrono::hours{1}};  // prevent rotation on slow CPUs
+  for (int i = 1; i <= VALUES; ++i) summary.Observe(i, WEIGHT);
+
+  auto s = summary.Collect().summary;
+  ASSERT_EQ(s.quantile.size(), 3U);
+  EXPECT_EQ(s.sample_count, static_cast<std::uint64_t>(VALUES * WEIGHT));
+
+  // one value covers WEIGHT ranks, allow for one value on top of the error
+  EXPECT_NEAR(s.quantile.at(0).value, 0.5 * VALUES, 0.05 * VALUES + 1);
+  EXPECT_NEAR(s.quantile.at(1).value, 0.9 * VALUES, 0.01 * VALUES + 1);
+  EXPECT_NEAR(s.quantile.at(2).value, 0.99 * VALUES, 0.001 * VALUES + 1);
+}
+
+TEST(SummaryTest, weighted_observations_beyond_int_range) {
+  const auto weight =
+      static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+
+  Summary summary{Summary::Quantiles{{0.5, 0.05}, {0.99, 0.001}},
+                  std::chrono::hours{1}};
+  summary.Observe(1, weight);
+  summary.Observe(2, weight);
+
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, 2 * weight);
+  EXPECT_GE(s.quantile.at(0).value, 1);
+  EXPECT_LE(s.quantile.at(0).value, 2);
+  EXPECT_EQ(s.quantile.at(1).value, 2);
+
+  Summary target{Summary::Quantiles{{0.5, 0.05}, {0.99, 0.001}},
+                 std::chrono::hours{1}};
+  target.Merge(summary.Snapshot());
+  target.Merge(summary.Snapshot());
+
+  s = target.Collect().summary;
+  EXPECT_EQ(s.sample_count, 4 * weight);
+  EXPECT_GE(s.quantile.at(0).value, 1);
+  EXPECT_LE(s.quantile.at(0).value, 2);
+  EXPECT_EQ(s.quantile.at(1).value, 2);
+}
+
+TEST(SummaryTest, weighted_and_single_observations) {
+  Summary summary{Summary::Quantiles{{0.5, 0.05}, {0.99, 0.001}}};
+  for (int i = 1; i <= 10; ++i) summary.Observe(i);
+  summary.Observe(100, 1000);
+  summary.Observe(1000);
+
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, 1011U);
+  EXPECT_EQ(s.quantile.at(0).value, 100);
+  EXPECT_EQ(s.quantile.at(1).value, 100);
+}
+
 TEST(SummaryTest, max_age) {
   Summary summary{Summary::Quantiles{{0.99, 0.001}}, std::chrono::seconds(1),
                   2};
@@ -94,6 +164,19 @@ TEST(SummaryTest, max_age) {
   test_value(std::numeric_limits<double>::quiet_NaN());
 }
 
+TEST(SummaryTest, max_age_with_coarse_clock) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.99, 0.001}});
+  Summary summary{quantiles, std::chrono::seconds(1), 2,
+                  detail::CKMSQuantiles::kDefaultBufferSize,
+                  Summary::ClockSource::Coarse};
+  summary.Observe(8.0);
+
+  EXPECT_DOUBLE_EQ(summary.Collect().summary.quantile.at(0).value, 8.0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+  EXPECT_TRUE(std::isnan(summary.Collect().summary.quantile.at(0).value));
+}
+
 TEST(SummaryTest, construction_with_dynamic_quantile_vector) {
   auto quantiles = Summary::Quantiles{{0.99, 0.001}};
   quantiles.push_back({0.5, 0.05});
@@ -102,5 +185,199 @@ TEST(SummaryTest, construction_with_dynamic_quantile_vector) {
   summary.Observe(8.0);
 }
 
+TEST(SummaryTest, shared_quantiles) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}});
+
+  Summary first{quantiles};
+  Summary second{quantiles};
+  first.Observe(1.0);
+  second.Observe(2.0);
+
+  EXPECT_EQ(quantiles.use_count(), 3);
+  EXPECT_DOUBLE_EQ(first.Collect().summary.quantile.at(0).value, 1.0);
+  EXPECT_DOUBLE_EQ(second.Collect().summary.quantile.at(0).value, 2.0);
+}
+
+TEST(SummaryTest, reject_null_quantiles) {
+  EXPECT_THROW(Summary{std::shared_ptr<const Summary::Quantiles>{}},
+               std::invalid_argument);
+}
+
+TEST(SummaryTest, reject_zero_buffer_size) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}});
+  EXPECT_THROW(Summary(quantiles, std::chrono::seconds{60}, 5, 0),
+               std::invalid_argument);
+}
+
+TEST(SummaryTest, buffers_are_allocated_lazily) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}});
+
+  Summary summary{quantiles};
+  const auto idle = summary.MemoryUsage();
+  EXPECT_LT(idle, 1024U);
+
+  summary.Observe(1.0);
+  EXPECT_GT(summary.MemoryUsage(), idle);
+}
+
+TEST(SummaryTest, smaller_buffer_size_uses_less_memory) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}});
+
+  Summary large{quantiles, std::chrono::seconds{60}, 5, 500};
+  Summary small{quantiles, std::chrono::seconds{60}, 5, 16};
+  large.Observe(1.0);
+  small.Observe(1.0);
+
+  EXPECT_LT(small.MemoryUsage(), large.MemoryUsage());
+}
+
+TEST(SummaryTest, quantile_values_with_small_buffer_size) {
+  static const int SAMPLES = 100000;
+
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}});
+  Summary summary{quantiles, std::chrono::hours{1}, 5, 8};
+  for (int i = 1; i <= SAMPLES; ++i) summary.Observe(i);
+
+  auto metric = summary.Collect();
+  auto s = metric.summary;
+  ASSERT_EQ(s.quantile.size(), 3U);
+
+  EXPECT_NEAR(s.quantile.at(0).value, 0.5 * SAMPLES, 0.05 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(1).value, 0.9 * SAMPLES, 0.01 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(2).value, 0.99 * SAMPLES, 0.001 * SAMPLES);
+}
+
+TEST(SummaryTest, collect_includes_buffered_observations) {
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}});
+  Summary summary{quantiles, std::chrono::hours{1}, 5, 1000};
+
+  for (int i = 1; i <= 10; ++i) summary.Observe(i);
+
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, 10U);
+  EXPECT_NEAR(s.quantile.at(0).value, 5, 1);
+}
+
+TEST(SummaryTest, concurrent_observe_and_collect) {
+  static const int THREADS = 4;
+  static const int SAMPLES = 20000;
+
+  const auto quantiles = std::make_shared<const Summary::Quantiles>(
+      Summary::Quantiles{{0.5, 0.05}, {0.99, 0.001}});
+  Summary summary{quantiles, std::chrono::hours{1}, 5, 64};
+
+  std::vector<std::thread> observers;
+  for (int t = 0; t < THREADS; ++t) {
+    observers.emplace_back([&summary] {
+      for (int i = 1; i <= SAMPLES; ++i) summary.Observe(i);
+    });
+  }
+
+  std::uint64_t previous_count = 0;
+  for (int i = 0; i < 100; ++i) {
+    const auto s = summary.Collect().summary;
+    EXPECT_GE(s.sample_count, previous_count);
+    previous_count = s.sample_count;
+  }
+
+  for (auto& observer : observers) observer.join();
+
+  auto s = summary.Collect().summary;
+  EXPECT_EQ(s.sample_count, static_cast<std::uint64_t>(THREADS * SAMPLES));
+  EXPECT_NEAR(s.quantile.at(0).value, 0.5 * SAMPLES, 0.05 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(1).value, 0.99 * SAMPLES, 0.001 * SAMPLES);
+}
+
+TEST(SummaryTest, merge_snapshot_of_empty_summary) {
+  Summary source{Summary::Quantiles{{0.5, 0.05}}};
+  Summary target{Summary::Quantiles{{0.5, 0.05}}};
+
+  target.Merge(source.Snapshot());
+
+  auto s = target.Collect().summary;
+  EXPECT_EQ(s.sample_count, 0U);
+  EXPECT_EQ(s.sample_sum, 0);
+  EXPECT_TRUE(std::isnan(s.quantile.at(0).value));
+}
+
+TEST(SummaryTest, merge_snapshot_count_and_sum) {
+  Summary source{Summary::Quantiles{{0.5, 0.05}}};
+  source.Observe(1);
+  source.Observe(2);
+  Summary target{Summary::Quantiles{{0.5, 0.05}}};
+  target.Observe(4);
+
+  target.Merge(source.Snapshot());
+
+  auto s = target.Collect().summary;
+  EXPECT_EQ(s.sample_count, 3U);
+  EXPECT_EQ(s.sample_sum, 7);
+}
+
+TEST(SummaryTest, merge_snapshots_of_shards) {
+  static const int SAMPLES = 100000;
+  const auto quantiles = Summary::Quantiles{
+      {0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}};
+
+  // interleave the samples to make both shards cover the whole range
+  Summary even{quantiles, std::chrono::hours{1}};
+  Summary odd{quantiles, std::chrono::hours{1}};
+  for (int i = 1; i <= SAMPLES; ++i) {
+    (i % 2 ? odd : even).Observe(i);
+  }
+
+  Summary combined{quantiles, std::chrono::hours{1}};
+  combined.Merge(even.Snapshot());
+  combined.Merge(odd.Snapshot());
+
+  auto s = combined.Collect().summary;
+  EXPECT_EQ(s.sample_count, static_cast<std::uint64_t>(SAMPLES));
+  ASSERT_EQ(s.quantile.size(), 3U);
+  EXPECT_NEAR(s.quantile.at(0).value, 0.5 * SAMPLES, 0.05 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(1).value, 0.9 * SAMPLES, 0.01 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(2).value, 0.99 * SAMPLES, 0.001 * SAMPLES);
+}
+
+TEST(SummaryTest, merge_snapshots_of_disjoint_shards) {
+  static const int SAMPLES = 10000;
+  const auto quantiles = Summary::Quantiles{{0.25, 0.01}, {0.75, 0.01}};
+
+  Summary lower{quantiles, std::chrono::hours{1}};
+  Summary upper{quantiles, std::chrono::hours{1}};
+  for (int i = 1; i <= SAMPLES; ++i) {
+    lower.Observe(i);
+    upper.Observe(SAMPLES + i);
+  }
+
+  Summary combined{quantiles, std::chrono::hours{1}};
+  combined.Merge(upper.Snapshot());
+  combined.Merge(lower.Snapshot());
+
+  auto s = combined.Collect().summary;
+  EXPECT_NEAR(s.quantile.at(0).value, 0.5 * SAMPLES, 0.02 * 2 * SAMPLES);
+  EXPECT_NEAR(s.quantile.at(1).value, 1.5 * SAMPLES, 0.02 * 2 * SAMPLES);
+}
+
+TEST(SummaryTest, reject_malformed_snapshot) {
+  Summary source{Summary::Quantiles{{0.5, 0.05}}};
+  source.Observe(1);
+  const auto snapshot = source.Snapshot();
+
+  Summary target{Summary::Quantiles{{0.5, 0.05}}};
+  EXPECT_THROW(target.Merge(""), std::invalid_argument);
+  EXPECT_THROW(target.Merge(snapshot.substr(0, snapshot.size() - 1)),
+               std::invalid_argument);
+  EXPECT_THROW(target.Merge(snapshot + '\0'), std::invalid_argument);
+  EXPECT_THROW(target.Merge(std::string(1, '\x7F')), std::invalid_argument);
+
+  EXPECT_EQ(target.Collect().summary.sample_count, 0U);
+}
+
 }  // namespace
 }  // namespace prometheus
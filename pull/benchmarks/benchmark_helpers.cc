@@ -0,0 +1,196 @@
+#include "benchmark_helpers.h"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "prometheus/counter.h"
+#include "prometheus/family.h"
+#include "prometheus/histogram.h"
+#include "prometheus/summary.h"
+
+SocketAddress LoopbackAddress(const int port) {
+  auto address = SocketAddress{};
+  auto& inet = reinterpret_cast<sockaddr_in&>(address.storage);
+  inet.sin_family = AF_INET;
+  inet.sin_port = htons(static_cast<std::uint16_t>(port));
+  inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.length = sizeof(inet);
+  return address;
+}
+
+SocketAddress AbstractSocketAddress(const std::string& name) {
+  auto address = SocketAddress{};
+  auto& unix = reinterpret_cast<sockaddr_un&>(address.storage);
+  unix.sun_family = AF_UNIX;
+  // leading '\0' instead of '@'
+  std::memcpy(unix.sun_path + 1, name.data(), name.size());
+  address.length =
+      static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size());
+  return address;
+}
+
+ScrapeConnection::ScrapeConnection(const SocketAddress& address,
+                                   const bool accept_gzip)
+    : address_(address),
+      request_(std::string{"GET /metrics HTTP/1.1\r\nHost: localhost\r\n"} +
+               (accept_gzip ? "Accept-Encoding: gzip\r\n" : "") + "\r\n") {
+  Connect();
+}
+
+ScrapeConnection::~ScrapeConnection() { close(fd_); }
+
+void ScrapeConnection::SendRequest() {
+  if (send(fd_, request_.data(), request_.size(), MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(request_.size())) {
+    throw std::runtime_error("failed to send request");
+  }
+}
+
+std::size_t ScrapeConnection::Receive() {
+  char chunk[65536];
+  const auto count = recv(fd_, chunk, sizeof(chunk), 0);
+  if (count <= 0) {
+    throw std::runtime_error("connection closed before response");
+  }
+  buffer_.append(chunk, static_cast<std::size_t>(count));
+
+  const auto head_end = buffer_.find("\r\n\r\n");
+  if (head_end == std::string::npos) {
+    return 0;
+  }
+  const auto length_header = buffer_.find("Content-Length: ");
+  if (length_header > head_end) {
+    throw std::runtime_error("response without Content-Length");
+  }
+  const auto size =
+      head_end + 4 +
+      std::strtoul(buffer_.c_str() + length_header + 16, nullptr, 10);
+  if (buffer_.size() < size) {
+    return 0;
+  }
+
+  const auto keep_alive = buffer_.find("Connection: close") > head_end;
+  buffer_.clear();
+  if (!keep_alive) {
+    close(fd_);
+    Connect();
+  }
+  return size;
+}
+
+void ScrapeConnection::Connect() {
+  fd_ = socket(address_.storage.ss_family, SOCK_STREAM, 0);
+  if (fd_ < 0 ||
+      connect(fd_, reinterpret_cast<const sockaddr*>(&address_.storage),
+              address_.length) != 0) {
+    throw std::runtime_error("failed to connect");
+  }
+}
+
+std::size_t ScrapeConcurrently(
+    std::vector<std::unique_ptr<ScrapeConnection>>& connections,
+    std::vector<double>* latencies) {
+  const auto number_of_connections = connections.size();
+  const auto start = std::chrono::steady_clock::now();
+  for (auto& connection : connections) {
+    connection->SendRequest();
+  }
+
+  auto bytes = std::size_t{0};
+  auto fds = std::vector<pollfd>(number_of_connections);
+  auto pending = std::vector<bool>(number_of_connections, true);
+  auto remaining = number_of_connections;
+  while (remaining > 0) {
+    for (std::size_t i = 0; i < number_of_connections; ++i) {
+      fds[i].fd = pending[i] ? connections[i]->fd() : -1;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    poll(fds.data(), fds.size(), -1);
+    for (std::size_t i = 0; i < number_of_connections; ++i) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      const auto size = connections[i]->Receive();
+      if (size > 0) {
+        bytes += size;
+        pending[i] = false;
+        --remaining;
+        if (latencies) {
+          latencies->push_back(std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count());
+        }
+      }
+    }
+  }
+  return bytes;
+}
+
+std::shared_ptr<prometheus::Registry> BuildRegistry(
+    const MetricKind kind, const std::size_t families,
+    const std::size_t children) {
+  using prometheus::BuildCounter;
+  using prometheus::BuildHistogram;
+  using prometheus::BuildSummary;
+  using prometheus::Histogram;
+  using prometheus::Summary;
+
+  auto registry = std::make_shared<prometheus::Registry>();
+  for (std::size_t family = 0; family < families; ++family) {
+    const auto name = "metric_" + std::to_string(family);
+    for (std::size_t child = 0; child < children; ++child) {
+      const auto labels =
+          prometheus::Labels{{"label", std::to_string(child)}};
+      switch (kind) {
+        case MetricKind::kCounter:
+          BuildCounter()
+              .Name(name + "_total")
+              .Help("")
+              .Register(*registry)
+              .Add(labels)
+              .Increment();
+          break;
+        case MetricKind::kHistogram:
+          BuildHistogram()
+              .Name(name + "_seconds")
+              .Help("")
+              .Register(*registry)
+              .Add(labels, Histogram::BucketBoundaries{0.005, 0.01, 0.025,
+                                                       0.05, 0.1, 0.25, 0.5,
+                                                       1, 2.5, 5, 10})
+              .Observe(0.1);
+          break;
+        case MetricKind::kSummary:
+          BuildSummary()
+              .Name(name + "_seconds")
+              .Help("")
+              .Register(*registry)
+              .Add(labels, Summary::Quantiles{{0.5, 0.05}, {0.99, 0.001}})
+              .Observe(0.1);
+          break;
+      }
+    }
+  }
+  return registry;
+}
+
+double PeakResidentSetMegabytes() {
+  auto usage = rusage{};
+  getrusage(RUSAGE_SELF, &usage);
+  // in kilobytes on Linux
+  return static_cast<double>(usage.ru_maxrss) / 1024.0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "prometheus/registry.h"
+
+struct SocketAddress {
+  sockaddr_storage storage;
+  socklen_t length;
+};
+
+SocketAddress LoopbackAddress(int port);
+SocketAddress AbstractSocketAddress(const std::string& name);
+
+// one keep-alive connection of a scraper, reconnects whenever the server
+// closes the connection after a response
+class ScrapeConnection {
+ public:
+  explicit ScrapeConnection(const SocketAddress& address,
+                            bool accept_gzip = false);
+  ~ScrapeConnection();
+
+  ScrapeConnection(const ScrapeConnection&) = delete;
+  ScrapeConnection& operator=(const ScrapeConnection&) = delete;
+
+  int fd() const { return fd_; }
+
+  void SendRequest();
+
+  // returns the size of the response once it is complete, 0 before
+  std::size_t Receive();
+
+ private:
+  void Connect();
+
+  const SocketAddress address_;
+  const std::string request_;
+  int fd_ = -1;
+  std::string buffer_;
+};
+
+// every connection scrapes once at the same time, returns the bytes received
+// and appends the latency of each scrape in seconds, if given
+std::size_t ScrapeConcurrently(
+    std::vector<std::unique_ptr<ScrapeConnection>>& connections,
+    std::vector<double>* latencies = nullptr);
+
+enum class MetricKind { kCounter, kHistogram, kSummary };
+
+std::shared_ptr<prometheus::Registry> BuildRegistry(MetricKind kind,
+                                                    std::size_t families,
+                                                    std::size_t children);
+
+// high-water mark of the resident set of the whole process
+double PeakResidentSetMegabytes();
+
+#endif
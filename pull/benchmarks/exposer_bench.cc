@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+
+#ifdef __linux__
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_helpers.h"
+#include "prometheus/counter.h"
+#include "prometheus/detail/future_std.h"
+#include "prometheus/exposer.h"
+#include "prometheus/family.h"
+#include "prometheus/registry.h"
+
+static void BM_Exposer_Scrape(benchmark::State& state) {
+  using prometheus::BuildCounter;
+  using prometheus::Exposer;
+  using prometheus::Registry;
+  const auto backend = state.range(0) == 0 ? Exposer::Backend::kCivetweb
+                                           : Exposer::Backend::kEventLoop;
+  const auto number_of_connections = static_cast<std::size_t>(state.range(1));
+
+  auto registry = std::make_shared<Registry>();
+  for (int family = 0; family < 10; ++family) {
+    auto& counter_family = BuildCounter()
+                               .Name("counter_" + std::to_string(family))
+                               .Help("")
+                               .Register(*registry);
+    for (int counter = 0; counter < 10; ++counter) {
+      counter_family.Add({{"label", std::to_string(counter)}});
+    }
+  }
+
+  std::unique_ptr<Exposer> exposer;
+  std::vector<std::unique_ptr<ScrapeConnection>> connections;
+  try {
+    exposer = prometheus::detail::make_unique<Exposer>("127.0.0.1:0", 2,
+                                                       backend);
+    exposer->RegisterCollectable(registry);
+    const auto address = LoopbackAddress(exposer->GetListeningPorts().at(0));
+    for (std::size_t i = 0; i < number_of_connections; ++i) {
+      connections.push_back(
+          prometheus::detail::make_unique<ScrapeConnection>(address));
+    }
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+
+  auto bytes = std::size_t{0};
+  try {
+    while (state.KeepRunning()) {
+      bytes += ScrapeConcurrently(connections);
+    }
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+  }
+
+  state.SetItemsProcessed(state.iterations() * number_of_connections);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Exposer_Scrape)
+    ->ArgNames({"event_loop", "connections"})
+    ->ArgsProduct({{0, 1}, {1, 16, 128}})
+    ->UseRealTime();
+
+// round trip of a minimal scrape, dominated by the transport
+static void BM_Exposer_ScrapeLocal(benchmark::State& state) {
+  using prometheus::BuildCounter;
+  using prometheus::Exposer;
+  using prometheus::Registry;
+  const auto unix_socket = state.range(0) != 0;
+  const auto name = "prometheus-cpp-bench-" + std::to_string(getpid());
+
+  auto registry = std::make_shared<Registry>();
+  BuildCounter().Name("counter").Help("").Register(*registry).Add({});
+
+  Exposer exposer{unix_socket ? "unix:@" + name : "127.0.0.1:0", 1,
+                  Exposer::Backend::kEventLoop};
+  exposer.RegisterCollectable(registry);
+  ScrapeConnection connection{
+      unix_socket ? AbstractSocketAddress(name)
+                  : LoopbackAddress(exposer.GetListeningPorts().at(0))};
+
+  try {
+    while (state.KeepRunning()) {
+      connection.SendRequest();
+      while (connection.Receive() == 0) {
+        // intentionally empty block
+      }
+    }
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+  }
+}
+BENCHMARK(BM_Exposer_ScrapeLocal)->ArgName("unix_socket")->Arg(0)->Arg(1);
+
+#endif
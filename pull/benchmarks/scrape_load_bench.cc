@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_helpers.h"
+#include "prometheus/detail/future_std.h"
+#include "prometheus/exposer.h"
+
+namespace {
+
+double Percentile(const std::vector<double>& sorted, const double quantile) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const auto index = static_cast<std::size_t>(
+      quantile * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+}  // namespace
+
+// scrapes registries of a given shape from several clients at once, the
+// latency of a scrape includes the time it waits behind the others
+static void BM_Exposer_ScrapeLoad(benchmark::State& state) {
+  using prometheus::Exposer;
+  const auto kind = static_cast<MetricKind>(state.range(0));
+  const auto families = static_cast<std::size_t>(state.range(1));
+  const auto children = static_cast<std::size_t>(state.range(2));
+  const auto gzip = state.range(3) != 0;
+  const auto clients = static_cast<std::size_t>(state.range(4));
+
+  auto registry = BuildRegistry(kind, families, children);
+
+  std::unique_ptr<Exposer> exposer;
+  std::vector<std::unique_ptr<ScrapeConnection>> connections;
+  try {
+    exposer = prometheus::detail::make_unique<Exposer>(
+        "127.0.0.1:0", 2, Exposer::Backend::kEventLoop);
+    exposer->RegisterCollectable(registry);
+    const auto address = LoopbackAddress(exposer->GetListeningPorts().at(0));
+    for (std::size_t i = 0; i < clients; ++i) {
+      connections.push_back(
+          prometheus::detail::make_unique<ScrapeConnection>(address, gzip));
+    }
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+
+  auto bytes = std::size_t{0};
+  std::vector<double> latencies;
+  try {
+    while (state.KeepRunning()) {
+      bytes += ScrapeConcurrently(connections, &latencies);
+    }
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  state.counters["p50_ms"] = Percentile(latencies, 0.5) * 1e3;
+  state.counters["p90_ms"] = Percentile(latencies, 0.9) * 1e3;
+  state.counters["p99_ms"] = Percentile(latencies, 0.99) * 1e3;
+  state.counters["max_ms"] = Percentile(latencies, 1.0) * 1e3;
+  state.counters["response_kB"] =
+      static_cast<double>(bytes) / 1e3 / static_cast<double>(latencies.size());
+  // of the whole process, i.e., never below that of an earlier benchmark
+  state.counters["peak_rss_MB"] = PeakResidentSetMegabytes();
+  state.SetItemsProcessed(state.iterations() * clients);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Exposer_ScrapeLoad)
+    ->ArgNames({"type", "families", "children", "gzip", "clients"})
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (const auto kind : {MetricKind::kCounter, MetricKind::kHistogram,
+                              MetricKind::kSummary}) {
+        for (const auto size : {10, 100}) {
+          for (const auto gzip : {0, 1}) {
+            for (const auto clients : {1, 16}) {
+              benchmark->Args(
+                  {static_cast<int>(kind), size, size, gzip, clients});
+            }
+          }
+        }
+      }
+    })
+    ->UseRealTime();
+
+#endif
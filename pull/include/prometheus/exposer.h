@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <memory>
@@ -10,21 +11,40 @@
 #include "prometheus/collectable.h"
 #include "prometheus/detail/pull_export.h"
 
-class CivetServer;
 struct CivetCallbacks;
 
 namespace prometheus {
 
 namespace detail {
 class Endpoint;
+class Server;
+class ThreadPool;
 }  // namespace detail
 
 class PROMETHEUS_CPP_PULL_EXPORT Exposer {
  public:
+  /// \brief The HTTP server implementation serving the metrics.
+  enum class Backend {
+    /// \brief civetweb, blocking a worker thread per open connection.
+    kCivetweb,
+    /// \brief Built-in event loop multiplexing all connections with epoll.
+    ///
+    /// Each of the threads serves any number of keep-alive connections,
+    /// i.e., idle or slowly reading scrapers don't starve the others. Only
+    /// available on Linux.
+    ///
+    /// Besides TCP addresses, the bind address may list unix domain sockets
+    /// for scrapers on the same host, "unix:/path/to/socket" for a socket
+    /// file and "unix:@name" for a name in the abstract namespace.
+    kEventLoop,
+  };
+
   explicit Exposer(const std::string& bind_address, std::size_t num_threads = 2,
                    const CivetCallbacks* callbacks = nullptr);
   explicit Exposer(std::vector<std::string> options,
                    const CivetCallbacks* callbacks = nullptr);
+  explicit Exposer(const std::string& bind_address, std::size_t num_threads,
+                   Backend backend);
   ~Exposer();
 
   Exposer(const Exposer&) = delete;
@@ -45,11 +65,65 @@ class PROMETHEUS_CPP_PULL_EXPORT Exposer {
 
   std::vector<int> GetListeningPorts() const;
 
+  /// \brief Collect up to the given number of collectables of a scrape at
+  /// once.
+  ///
+  /// By default the collectables of an endpoint are collected one after
+  /// another by the server thread handling the scrape, i.e., the scrape takes
+  /// as long as all of them together. Given a parallelism of n > 1, the
+  /// Exposer runs a pool of n - 1 threads, which is shared by all endpoints
+  /// and concurrent scrapes, and the server thread collects alongside the
+  /// pool. The metric families are returned in the order of registration
+  /// either way.
+  void SetCollectionParallelism(std::size_t parallelism);
+
+  /// \brief Answer scrapes after the given timeout the latest, zero disables
+  /// it.
+  ///
+  /// A scrape sending X-Prometheus-Scrape-Timeout-Seconds, as Prometheus
+  /// does, is answered within its timeout, less half a second for the
+  /// transfer if it is longer than a second, unless the configured timeout
+  /// is shorter. The response then contains what was
+  /// collected in time and the gauge exposer_scrape_skipped_collectables
+  /// counting the collectables left out.
+  ///
+  /// Only with a collection parallelism > 1 a slow collectable is left
+  /// behind: it keeps its thread, which the pool replaces, and is skipped by
+  /// the following scrapes until it finishes. Otherwise the scrape waits for
+  /// the running collectable and skips the remaining ones.
+  void SetScrapeTimeout(std::chrono::milliseconds timeout);
+
+  /// \brief Render the response of each endpoint in the background at the
+  /// given interval, zero disables it.
+  ///
+  /// A low-priority thread per endpoint collects, serializes and compresses
+  /// the metrics once per interval. A scrape is then answered at once with
+  /// the latest body and an Age header telling its age in seconds, i.e., the
+  /// scrape latency no longer depends on the number of metrics. Scrapes
+  /// asking for a subset of the metrics or for the protobuf format, and
+  /// those arriving before the first rendering, are still collected on
+  /// demand.
+  void SetPrerenderInterval(std::chrono::milliseconds interval);
+
+  /// \brief Keep the text of each metric family between scrapes, disabled by
+  /// default.
+  ///
+  /// A family whose samples did not change since the previous scrape is then
+  /// not serialized again, at the cost of keeping a copy of all families and
+  /// their text. The event loop backend writes the text of the families
+  /// without copying it, civetweb writes each family on its own. Only
+  /// complete scrapes in the text format use the cache.
+  void SetRenderedFamilyCache(bool enabled);
+
  private:
   detail::Endpoint& GetEndpointForUri(const std::string& uri);
 
-  std::unique_ptr<CivetServer> server_;
+  std::unique_ptr<detail::Server> server_;
   std::vector<std::unique_ptr<detail::Endpoint>> endpoints_;
+  std::shared_ptr<detail::ThreadPool> collection_pool_;
+  std::chrono::milliseconds scrape_timeout_{0};
+  std::chrono::milliseconds prerender_interval_{0};
+  bool rendered_family_cache_ = false;
   std::mutex mutex_;
 };
 
@@ -0,0 +1,117 @@
+#include "civetweb_server.h"
+
+#include <string>
+#include <utility>
+
+#include "basic_auth.h"
+#include "civetweb.h"
+#include "handler.h"
+#include "http_connection.h"
+#include "prometheus/detail/future_std.h"
+
+namespace prometheus {
+namespace detail {
+
+namespace {
+class CivetConnection : public HttpConnection {
+ public:
+  explicit CivetConnection(struct mg_connection* conn) : conn_(conn) {}
+
+  const char* GetHeader(const char* name) const override {
+    return mg_get_header(conn_, name);
+  }
+
+  const char* GetQueryString() const override {
+    return mg_get_request_info(conn_)->query_string;
+  }
+
+  void Write(const HttpResponse& response) override {
+    auto head = FormatResponseHead(response);
+    head += "\r\n";
+    mg_write(conn_, head.data(), head.size());
+    mg_write(conn_, response.body.data(), response.body.size());
+    // civetweb has no vectored write, the segments are written one by one
+    // instead of being joined first
+    for (const auto& segment : response.body_segments) {
+      mg_write(conn_, segment->data(), segment->size());
+    }
+  }
+
+ private:
+  struct mg_connection* conn_;
+};
+
+class AlwaysAllowAccessHandler : public CivetAuthHandler {
+  bool authorize(CivetServer*, struct mg_connection*) override { return true; }
+};
+
+AlwaysAllowAccessHandler alwaysAllowAccessHandler;
+}  // namespace
+
+class CivetwebServer::CivetMetricsHandler : public CivetHandler {
+ public:
+  explicit CivetMetricsHandler(MetricsHandler& handler) : handler_(handler) {}
+
+  bool handleGet(CivetServer*, struct mg_connection* conn) override {
+    CivetConnection connection{conn};
+    handler_.HandleGet(connection);
+    return true;
+  }
+
+ private:
+  MetricsHandler& handler_;
+};
+
+class CivetwebServer::CivetBasicAuthHandler : public CivetAuthHandler {
+ public:
+  explicit CivetBasicAuthHandler(BasicAuthHandler& handler)
+      : handler_(handler) {}
+
+  bool authorize(CivetServer*, struct mg_connection* conn) override {
+    CivetConnection connection{conn};
+    return handler_.Authorize(connection);
+  }
+
+ private:
+  BasicAuthHandler& handler_;
+};
+
+CivetwebServer::CivetwebServer(std::vector<std::string> options,
+                               const CivetCallbacks* callbacks)
+    : server_(detail::make_unique<CivetServer>(std::move(options), callbacks)) {
+}
+
+CivetwebServer::~CivetwebServer() = default;
+
+void CivetwebServer::AddHandler(const std::string& uri,
+                                MetricsHandler& handler) {
+  auto adapter = detail::make_unique<CivetMetricsHandler>(handler);
+  server_->addHandler(uri, adapter.get());
+  handlers_[uri] = std::move(adapter);
+}
+
+void CivetwebServer::RemoveHandler(const std::string& uri) {
+  server_->removeHandler(uri);
+  handlers_.erase(uri);
+}
+
+void CivetwebServer::AddAuthHandler(const std::string& uri,
+                                    BasicAuthHandler& handler) {
+  auto adapter = detail::make_unique<CivetBasicAuthHandler>(handler);
+  server_->addAuthHandler(uri, adapter.get());
+  auth_handlers_[uri] = std::move(adapter);
+}
+
+void CivetwebServer::RemoveAuthHandler(const std::string& uri) {
+  // work-around https://github.com/civetweb/civetweb/issues/941
+  // server_->removeAuthHandler(uri);
+  server_->addAuthHandler(uri, alwaysAllowAccessHandler);
+  auth_handlers_.erase(uri);
+}
+
+std::vector<int> CivetwebServer::GetListeningPorts() const {
+  return server_->getListeningPorts();
+}
+
+}  // namespace detail
+}  // namespace prometheus
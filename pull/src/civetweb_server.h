@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CivetServer.h"
+#include "server.h"
+
+namespace prometheus {
+namespace detail {
+
+/// \brief Server backend with a fixed pool of civetweb worker threads.
+///
+/// Each worker serves one connection at a time, i.e., a scraper which keeps
+/// its connection open occupies a worker until it disconnects.
+class CivetwebServer : public Server {
+ public:
+  CivetwebServer(std::vector<std::string> options,
+                 const CivetCallbacks* callbacks);
+  ~CivetwebServer() override;
+
+  CivetwebServer(const CivetwebServer&) = delete;
+  CivetwebServer(CivetwebServer&&) = delete;
+  CivetwebServer& operator=(const CivetwebServer&) = delete;
+  CivetwebServer& operator=(CivetwebServer&&) = delete;
+
+  void AddHandler(const std::string& uri, MetricsHandler& handler) override;
+  void RemoveHandler(const std::string& uri) override;
+  void AddAuthHandler(const std::string& uri,
+                      BasicAuthHandler& handler) override;
+  void RemoveAuthHandler(const std::string& uri) override;
+
+  std::vector<int> GetListeningPorts() const override;
+
+ private:
+  class CivetMetricsHandler;
+  class CivetBasicAuthHandler;
+
+  std::map<std::string, std::unique_ptr<CivetMetricsHandler>> handlers_;
+  std::map<std::string, std::unique_ptr<CivetBasicAuthHandler>>
+      auth_handlers_;
+  // declared last to stop serving before the adapters are destroyed
+  std::unique_ptr<CivetServer> server_;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace prometheus {
+namespace detail {
+
+/// \brief A fixed number of threads running posted tasks in FIFO order.
+///
+/// Tasks must not throw, wrap them in a std::packaged_task to get hold of
+/// their result or exception. Pending tasks are still run on destruction.
+///
+/// A task which blocks for too long can be left behind: AddThread() restores
+/// the capacity of the pool at once, and the blocked task calls
+/// RetireCurrentThread() to give up its thread once it returns.
+class ThreadPool {
+ public:
+  explicit ThreadPool(const std::size_t num_threads) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (std::size_t i = 0; i < num_threads; ++i) {
+      StartThread();
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopping_ = true;
+    }
+    task_posted_.notify_all();
+    // no thread is started or retired while stopping
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    for (auto& thread : retired_threads_) {
+      thread.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  void Post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    task_posted_.notify_one();
+  }
+
+  void AddThread() {
+    std::list<std::thread> retired_threads;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      StartThread();
+      retired_threads.swap(retired_threads_);
+    }
+    for (auto& thread : retired_threads) {
+      thread.join();
+    }
+  }
+
+  /// \brief Must only be called by a task, which is the last one run by its
+  /// thread then.
+  void RetireCurrentThread() { RetiringThread() = true; }
+
+  std::size_t ThreadCount() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return threads_.size();
+  }
+
+ private:
+  using ThreadHandle = std::list<std::thread>::iterator;
+
+  static bool& RetiringThread() {
+    static thread_local bool retiring = false;
+    return retiring;
+  }
+
+  // requires mutex_, which also keeps the new thread from using its handle
+  // before it is assigned
+  void StartThread() {
+    auto handle = threads_.emplace(threads_.end());
+    *handle = std::thread(&ThreadPool::Work, this, handle);
+  }
+
+  void Work(const ThreadHandle handle) {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        task_posted_.wait(lock,
+                          [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+
+      if (RetiringThread()) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!stopping_) {
+          retired_threads_.splice(retired_threads_.end(), threads_, handle);
+          return;
+        }
+      }
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable task_posted_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+  std::list<std::thread> threads_;
+  std::list<std::thread> retired_threads_;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -9,30 +9,20 @@
 namespace prometheus {
 namespace detail {
 
-namespace {
-class AlwaysAllowAccessHandler : public CivetAuthHandler {
-  bool authorize(CivetServer*, struct mg_connection*) override { return true; }
-};
-
-AlwaysAllowAccessHandler alwaysAllowAccessHandler;
-}  // namespace
-
-Endpoint::Endpoint(CivetServer& server, std::string uri)
+Endpoint::Endpoint(Server& server, std::string uri)
     : server_(server),
       uri_(std::move(uri)),
       endpoint_registry_(std::make_shared<Registry>()),
       metrics_handler_(
           detail::make_unique<MetricsHandler>(*endpoint_registry_)) {
   RegisterCollectable(endpoint_registry_);
-  server_.addHandler(uri_, metrics_handler_.get());
+  server_.AddHandler(uri_, *metrics_handler_);
 }
 
 Endpoint::~Endpoint() {
-  server_.removeHandler(uri_);
+  server_.RemoveHandler(uri_);
   if (auth_handler_) {
-    // work-around https://github.com/civetweb/civetweb/issues/941
-    // server_.removeAuthHandler(uri_);
-    server_.addAuthHandler(uri_, alwaysAllowAccessHandler);
+    server_.RemoveAuthHandler(uri_);
   }
 }
 
@@ -48,7 +38,7 @@ void Endpoint::RegisterAuth(
   // being called the second time and the handler is replaced
   auto new_handler =
       detail::make_unique<BasicAuthHandler>(std::move(authCB), realm);
-  server_.addAuthHandler(uri_, new_handler.get());
+  server_.AddAuthHandler(uri_, *new_handler);
   auth_handler_ = std::move(new_handler);
 }
 
@@ -57,6 +47,22 @@ void Endpoint::RemoveCollectable(
   metrics_handler_->RemoveCollectable(collectable);
 }
 
+void Endpoint::SetCollectionPool(std::shared_ptr<ThreadPool> pool) {
+  metrics_handler_->SetCollectionPool(std::move(pool));
+}
+
+void Endpoint::SetScrapeTimeout(const std::chrono::milliseconds timeout) {
+  metrics_handler_->SetScrapeTimeout(timeout);
+}
+
+void Endpoint::SetPrerenderInterval(const std::chrono::milliseconds interval) {
+  metrics_handler_->SetPrerenderInterval(interval);
+}
+
+void Endpoint::SetRenderedFamilyCache(const bool enabled) {
+  metrics_handler_->SetRenderedFamilyCache(enabled);
+}
+
 const std::string& Endpoint::GetURI() const { return uri_; }
 
 }  // namespace detail
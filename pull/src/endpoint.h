@@ -1,21 +1,23 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
 
-#include "CivetServer.h"
 #include "basic_auth.h"
 #include "prometheus/collectable.h"
 #include "prometheus/registry.h"
+#include "server.h"
 
 namespace prometheus {
 namespace detail {
 class MetricsHandler;
+class ThreadPool;
 
 class Endpoint {
  public:
-  explicit Endpoint(CivetServer& server, std::string uri);
+  explicit Endpoint(Server& server, std::string uri);
   ~Endpoint();
 
   Endpoint(const Endpoint&) = delete;
@@ -28,11 +30,15 @@ class Endpoint {
       std::function<bool(const std::string&, const std::string&)> authCB,
       const std::string& realm);
   void RemoveCollectable(const std::weak_ptr<Collectable>& collectable);
+  void SetCollectionPool(std::shared_ptr<ThreadPool> pool);
+  void SetScrapeTimeout(std::chrono::milliseconds timeout);
+  void SetPrerenderInterval(std::chrono::milliseconds interval);
+  void SetRenderedFamilyCache(bool enabled);
 
   const std::string& GetURI() const;
 
  private:
-  CivetServer& server_;
+  Server& server_;
   const std::string uri_;
   // registry for "meta" metrics about the endpoint itself
   std::shared_ptr<Registry> endpoint_registry_;
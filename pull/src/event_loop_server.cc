@@ -0,0 +1,865 @@
+#include "event_loop_server.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "prometheus/detail/future_std.h"
+#endif
+
+#include "basic_auth.h"
+#include "handler.h"
+#include "http_connection.h"
+
+namespace prometheus {
+namespace detail {
+
+#ifdef __linux__
+
+namespace {
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// a request which does not fit is rejected, scrapers send a few hundred bytes
+const std::size_t kMaxRequestHeadSize = 16 * 1024;
+const std::size_t kMaxRequestBodySize = 64 * 1024;
+const std::size_t kReadChunkSize = 16 * 1024;
+const std::size_t kMaxEvents = 64;
+// below IOV_MAX of Linux, a longer response is written with several calls
+const std::size_t kMaxWriteSegments = 1024;
+
+// Prometheus scrapes every few seconds to minutes over the same connection
+const auto kIdleTimeout = std::chrono::seconds{300};
+// bounds both slowly trickling requests and stalled readers of a response
+const auto kRequestTimeout = std::chrono::seconds{30};
+const auto kSweepInterval = std::chrono::seconds{1};
+
+std::string ErrnoMessage(const std::string& what) {
+  return what + ": " + std::strerror(errno);
+}
+
+const char kUnixPrefix[] = "unix:";
+
+bool IsUnixAddress(const std::string& address) {
+  return address.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0;
+}
+
+// a socket file without a listener is left behind by a crashed process
+void RemoveStaleSocketFile(const sockaddr_un& address,
+                           const socklen_t length) {
+  const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return;
+  }
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address), length) != 0 &&
+      errno == ECONNREFUSED) {
+    unlink(address.sun_path);
+  }
+  close(fd);
+}
+
+// "unix:/path" binds a socket file, "unix:@name" a name in the abstract
+// namespace of Linux, which vanishes with the socket
+int ListenUnix(const std::string& address) {
+  const auto path = address.substr(sizeof(kUnixPrefix) - 1);
+  auto socket_address = sockaddr_un{};
+  socket_address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(socket_address.sun_path)) {
+    throw std::runtime_error("invalid bind address: " + address);
+  }
+  std::memcpy(socket_address.sun_path, path.data(), path.size());
+  auto length = offsetof(sockaddr_un, sun_path) + path.size();
+  if (path.front() == '@') {
+    // the name of an abstract socket starts with and is not terminated by '\0'
+    socket_address.sun_path[0] = '\0';
+  } else {
+    length += 1;
+    RemoveStaleSocketFile(socket_address, static_cast<socklen_t>(length));
+  }
+
+  const auto fd =
+      socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::runtime_error(ErrnoMessage("cannot create socket"));
+  }
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&socket_address),
+           static_cast<socklen_t>(length)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    const auto message = ErrnoMessage("cannot listen on " + address);
+    close(fd);
+    throw std::runtime_error(message);
+  }
+  return fd;
+}
+
+int ListenTcp(const std::string& address) {
+  std::string host;
+  std::string port;
+  if (!address.empty() && address.front() == '[') {
+    const auto end = address.find("]:");
+    if (end == std::string::npos) {
+      throw std::runtime_error("invalid bind address: " + address);
+    }
+    host = address.substr(1, end - 1);
+    port = address.substr(end + 2);
+  } else {
+    const auto colon = address.rfind(':');
+    host = colon == std::string::npos ? "0.0.0.0" : address.substr(0, colon);
+    port = colon == std::string::npos ? address : address.substr(colon + 1);
+  }
+
+  auto hints = addrinfo{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+  addrinfo* result = nullptr;
+  const auto error = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                 port.c_str(), &hints, &result);
+  if (error != 0) {
+    throw std::runtime_error("invalid bind address " + address + ": " +
+                             gai_strerror(error));
+  }
+  const auto info = std::unique_ptr<addrinfo, void (*)(addrinfo*)>{
+      result, freeaddrinfo};
+
+  const auto fd = socket(info->ai_family,
+                         info->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                         info->ai_protocol);
+  if (fd < 0) {
+    throw std::runtime_error(ErrnoMessage("cannot create socket"));
+  }
+
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (info->ai_family == AF_INET6) {
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one));
+  }
+
+  if (bind(fd, info->ai_addr, info->ai_addrlen) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    const auto message = ErrnoMessage("cannot listen on " + address);
+    close(fd);
+    throw std::runtime_error(message);
+  }
+  return fd;
+}
+
+std::vector<std::string> SplitBindAddresses(const std::string& addresses) {
+  std::vector<std::string> result;
+  std::string::size_type begin = 0;
+  for (;;) {
+    const auto end = addresses.find(',', begin);
+    const auto address = addresses.substr(begin, end - begin);
+    if (address.empty()) {
+      throw std::runtime_error("invalid bind addresses: " + addresses);
+    }
+    result.push_back(address);
+    if (end == std::string::npos) {
+      return result;
+    }
+    begin = end + 1;
+  }
+}
+
+bool ContainsToken(const char* value, const char* token) {
+  if (!value) {
+    return false;
+  }
+  const auto length = std::strlen(token);
+  for (auto* position = value; *position; ++position) {
+    if (strncasecmp(position, token, length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string Trim(const std::string& value) {
+  const auto begin = value.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return std::string{};
+  }
+  const auto end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+
+}  // namespace
+
+class EventLoopServer::Connection : public HttpConnection {
+ public:
+  Connection(int fd, Clock::time_point now)
+      : fd_(fd), deadline_(now + kIdleTimeout) {}
+
+  ~Connection() override { close(fd_); }
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  const char* GetHeader(const char* name) const override {
+    for (const auto& header : headers_) {
+      if (strcasecmp(header.first.c_str(), name) == 0) {
+        return header.second.c_str();
+      }
+    }
+    return nullptr;
+  }
+
+  const char* GetQueryString() const override {
+    return has_query_string_ ? query_string_.c_str() : nullptr;
+  }
+
+  void Write(const HttpResponse& response) override {
+    auto head = FormatResponseHead(response);
+    const auto connection =
+        std::find_if(response.headers.begin(), response.headers.end(),
+                     [](const std::pair<std::string, std::string>& header) {
+                       return strcasecmp(header.first.c_str(),
+                                         "Connection") == 0;
+                     });
+    if (connection != response.headers.end()) {
+      keep_alive_ = keep_alive_ && !ContainsToken(
+                                       connection->second.c_str(), "close");
+    } else {
+      head += keep_alive_ ? "Connection: keep-alive\r\n"
+                          : "Connection: close\r\n";
+    }
+    head += "\r\n";
+    head += response.body;
+    output_.push_back(std::make_shared<const std::string>(std::move(head)));
+    // queued as they are, the segments are written straight from the caller's
+    // buffers
+    for (const auto& segment : response.body_segments) {
+      if (!segment->empty()) {
+        output_.push_back(segment);
+      }
+    }
+  }
+
+  void Reject(const int status) {
+    auto response = HttpResponse{};
+    response.status = status;
+    keep_alive_ = false;
+    Write(response);
+  }
+
+  bool HasPendingOutput() const { return !output_.empty(); }
+
+  const int fd_;
+  std::string input_;
+  std::string::size_type head_search_offset_ = 0;
+  // the responses not yet written, written_ counts the bytes of the first
+  // segment already sent
+  std::deque<std::shared_ptr<const std::string>> output_;
+  std::string::size_type written_ = 0;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  std::string query_string_;
+  bool has_query_string_ = false;
+  bool keep_alive_ = true;
+  bool peer_closed_ = false;
+  std::uint32_t interest_ = EPOLLIN;
+  Clock::time_point request_start_;
+  Clock::time_point deadline_;
+};
+
+class EventLoopServer::EventLoop {
+ public:
+  explicit EventLoop(EventLoopServer& server)
+      : server_(server), epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epoll_fd_ < 0) {
+      throw std::runtime_error(ErrnoMessage("cannot create epoll instance"));
+    }
+    try {
+      for (const auto fd : server_.listen_fds_) {
+        Watch(fd, EPOLLIN | EPOLLEXCLUSIVE);
+      }
+      // never read, so the level-triggered event wakes up every loop
+      Watch(server_.wakeup_fd_, EPOLLIN);
+      thread_ = std::thread{&EventLoop::Run, this};
+    } catch (...) {
+      close(epoll_fd_);
+      throw;
+    }
+  }
+
+  ~EventLoop() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    connections_.clear();
+    close(epoll_fd_);
+  }
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+ private:
+  enum class ParseResult { kIncomplete, kDone };
+
+  void Watch(const int fd, const std::uint32_t events) {
+    auto event = epoll_event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      throw std::runtime_error(ErrnoMessage("cannot watch descriptor"));
+    }
+  }
+
+  bool IsListening(const int fd) const {
+    return std::find(server_.listen_fds_.begin(), server_.listen_fds_.end(),
+                     fd) != server_.listen_fds_.end();
+  }
+
+  void Run() {
+    auto events = std::array<epoll_event, kMaxEvents>{};
+    auto next_sweep = Clock::now() + kSweepInterval;
+    const auto timeout = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(kSweepInterval)
+            .count());
+
+    for (;;) {
+      const auto count = epoll_wait(epoll_fd_, events.data(),
+                                    static_cast<int>(events.size()), timeout);
+      if (count < 0 && errno != EINTR) {
+        return;
+      }
+
+      const auto now = Clock::now();
+      for (int i = 0; i < count; ++i) {
+        const auto fd = events[i].data.fd;
+        if (fd == server_.wakeup_fd_) {
+          return;
+        }
+        if (IsListening(fd)) {
+          Accept(fd, now);
+          continue;
+        }
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+        auto& connection = *it->second;
+        const auto flags = events[i].events;
+        const auto keep = (flags & (EPOLLERR | EPOLLHUP)) == 0 &&
+                          ((flags & EPOLLIN) == 0 ||
+                           Receive(connection, now)) &&
+                          Serve(connection, now);
+        if (!keep) {
+          connections_.erase(it);
+        }
+      }
+
+      if (now >= next_sweep) {
+        Sweep(now);
+        next_sweep = now + kSweepInterval;
+      }
+    }
+  }
+
+  void Accept(const int listen_fd, const Clock::time_point now) {
+    // one connection per event, the next one may go to another loop
+    const auto fd =
+        accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+          errno == ENOMEM) {
+        // the pending connection would wake us up over and over again
+        PauseAccepting();
+      }
+      return;
+    }
+
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    auto connection = detail::make_unique<Connection>(fd, now);
+    auto event = epoll_event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0) {
+      connections_[fd] = std::move(connection);
+    }
+  }
+
+  void PauseAccepting() {
+    if (!accepting_) {
+      return;
+    }
+    for (const auto fd : server_.listen_fds_) {
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    accepting_ = false;
+  }
+
+  void ResumeAccepting() {
+    if (accepting_) {
+      return;
+    }
+    for (const auto fd : server_.listen_fds_) {
+      auto event = epoll_event{};
+      event.events = EPOLLIN | EPOLLEXCLUSIVE;
+      event.data.fd = fd;
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+    accepting_ = true;
+  }
+
+  void Sweep(const Clock::time_point now) {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+      if (now >= it->second->deadline_) {
+        it = connections_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    ResumeAccepting();
+  }
+
+  // returns false if the connection failed
+  bool Receive(Connection& connection, const Clock::time_point now) {
+    char buffer[kReadChunkSize];
+    const auto was_empty = connection.input_.empty();
+    // leave the rest in the socket, the request is rejected anyway
+    while (connection.input_.size() <=
+           kMaxRequestHeadSize + kMaxRequestBodySize) {
+      const auto count = recv(connection.fd_, buffer, sizeof(buffer), 0);
+      if (count > 0) {
+        connection.input_.append(buffer, static_cast<std::size_t>(count));
+      } else if (count == 0) {
+        connection.peer_closed_ = true;
+        break;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      } else if (errno != EINTR) {
+        return false;
+      }
+    }
+    if (was_empty && !connection.input_.empty()) {
+      connection.request_start_ = now;
+    }
+    return true;
+  }
+
+  // returns false if the connection is to be closed
+  bool Serve(Connection& connection, const Clock::time_point now) {
+    for (;;) {
+      if (connection.HasPendingOutput()) {
+        if (!Flush(connection)) {
+          return false;
+        }
+        if (connection.HasPendingOutput()) {
+          connection.deadline_ = now + kRequestTimeout;
+          return SetInterest(connection, EPOLLOUT);
+        }
+      }
+      if (!connection.keep_alive_) {
+        return false;
+      }
+      if (Parse(connection, now) == ParseResult::kIncomplete) {
+        break;
+      }
+    }
+
+    if (connection.peer_closed_) {
+      return false;
+    }
+    connection.deadline_ = connection.input_.empty()
+                               ? now + kIdleTimeout
+                               : connection.request_start_ + kRequestTimeout;
+    return SetInterest(connection, EPOLLIN);
+  }
+
+  // returns false if the connection failed
+  bool Flush(Connection& connection) {
+    auto& output = connection.output_;
+    while (!output.empty()) {
+      iovec segments[kMaxWriteSegments];
+      auto count = std::size_t{0};
+      for (auto segment = output.begin();
+           segment != output.end() && count < kMaxWriteSegments;
+           ++segment, ++count) {
+        const auto offset = count == 0 ? connection.written_ : 0;
+        segments[count].iov_base =
+            const_cast<char*>((*segment)->data()) + offset;
+        segments[count].iov_len = (*segment)->size() - offset;
+      }
+      auto message = msghdr{};
+      message.msg_iov = segments;
+      message.msg_iovlen = count;
+
+      const auto sent = sendmsg(connection.fd_, &message, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          return true;
+        } else if (errno != EINTR) {
+          return false;
+        }
+        continue;
+      }
+      auto remaining = static_cast<std::size_t>(sent) + connection.written_;
+      while (!output.empty() && remaining >= output.front()->size()) {
+        remaining -= output.front()->size();
+        output.pop_front();
+      }
+      connection.written_ = remaining;
+    }
+    return true;
+  }
+
+  bool SetInterest(Connection& connection, const std::uint32_t events) {
+    if (connection.interest_ == events) {
+      return true;
+    }
+    auto event = epoll_event{};
+    event.events = events;
+    event.data.fd = connection.fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd_, &event) != 0) {
+      return false;
+    }
+    connection.interest_ = events;
+    return true;
+  }
+
+  // parses and serves the next request in the input buffer, if complete
+  ParseResult Parse(Connection& connection, const Clock::time_point now) {
+    auto& input = connection.input_;
+    // empty lines before the request line are ignored, RFC 9112, section 2.2
+    auto empty_lines_end = std::size_t{0};
+    while (input.compare(empty_lines_end, 2, "\r\n") == 0) {
+      empty_lines_end += 2;
+    }
+    if (empty_lines_end > 0) {
+      input.erase(0, empty_lines_end);
+      connection.head_search_offset_ = 0;
+    }
+
+    const auto head_end =
+        input.find("\r\n\r\n", connection.head_search_offset_);
+    if (head_end == std::string::npos) {
+      if (input.size() > kMaxRequestHeadSize) {
+        connection.Reject(431);
+        return ParseResult::kDone;
+      }
+      connection.head_search_offset_ = input.size() < 3 ? 0 : input.size() - 3;
+      return ParseResult::kIncomplete;
+    }
+
+    const auto line_end = input.find("\r\n");
+    const auto method_end = input.find(' ');
+    const auto target_end = input.find(' ', method_end + 1);
+    if (method_end == 0 || target_end == std::string::npos ||
+        target_end >= line_end ||
+        input.compare(target_end + 1, 7, "HTTP/1.") != 0) {
+      connection.Reject(400);
+      return ParseResult::kDone;
+    }
+    const auto method = input.substr(0, method_end);
+    const auto target =
+        input.substr(method_end + 1, target_end - method_end - 1);
+    const auto version =
+        input.substr(target_end + 1, line_end - target_end - 1);
+
+    connection.headers_.clear();
+    for (auto begin = line_end + 2; begin < head_end + 2;) {
+      const auto end = input.find("\r\n", begin);
+      const auto colon = input.find(':', begin);
+      if (colon == std::string::npos || colon >= end || colon == begin) {
+        connection.Reject(400);
+        return ParseResult::kDone;
+      }
+      connection.headers_.emplace_back(
+          input.substr(begin, colon - begin),
+          Trim(input.substr(colon + 1, end - colon - 1)));
+      begin = end + 2;
+    }
+
+    if (connection.GetHeader("Transfer-Encoding")) {
+      connection.Reject(501);
+      return ParseResult::kDone;
+    }
+    auto body_size = std::size_t{0};
+    if (const auto content_length = connection.GetHeader("Content-Length")) {
+      char* end = nullptr;
+      errno = 0;
+      const auto value = std::strtoull(content_length, &end, 10);
+      if (end == content_length || *end != '\0' || errno != 0) {
+        connection.Reject(400);
+        return ParseResult::kDone;
+      }
+      if (value > kMaxRequestBodySize) {
+        connection.Reject(413);
+        return ParseResult::kDone;
+      }
+      body_size = static_cast<std::size_t>(value);
+    }
+    const auto request_size = head_end + 4 + body_size;
+    if (input.size() < request_size) {
+      return ParseResult::kIncomplete;
+    }
+
+    const auto connection_header = connection.GetHeader("Connection");
+    if (version == "HTTP/1.0") {
+      connection.keep_alive_ = ContainsToken(connection_header, "keep-alive");
+    } else {
+      connection.keep_alive_ = !ContainsToken(connection_header, "close");
+    }
+
+    const auto query = target.find('?');
+    connection.has_query_string_ = query != std::string::npos;
+    connection.query_string_ =
+        connection.has_query_string_ ? target.substr(query + 1) : "";
+
+    try {
+      server_.Dispatch(connection, method, target.substr(0, query));
+    } catch (const std::exception&) {
+      connection.output_.clear();
+      connection.Reject(500);
+    }
+
+    input.erase(0, request_size);
+    connection.head_search_offset_ = 0;
+    connection.request_start_ = now;
+    return ParseResult::kDone;
+  }
+
+  EventLoopServer& server_;
+  const int epoll_fd_;
+  bool accepting_ = true;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+  std::thread thread_;
+};
+
+EventLoopServer::EventLoopServer(const std::string& bind_addresses,
+                                 const std::size_t num_threads) {
+  try {
+    for (const auto& address : SplitBindAddresses(bind_addresses)) {
+      if (!IsUnixAddress(address)) {
+        listen_fds_.push_back(ListenTcp(address));
+        continue;
+      }
+      listen_fds_.push_back(ListenUnix(address));
+      const auto path = address.substr(sizeof(kUnixPrefix) - 1);
+      if (path.front() != '@') {
+        socket_files_.push_back(path);
+      }
+    }
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+      throw std::runtime_error(ErrnoMessage("cannot create eventfd"));
+    }
+    for (std::size_t i = 0; i < std::max<std::size_t>(num_threads, 1); ++i) {
+      loops_.push_back(detail::make_unique<EventLoop>(*this));
+    }
+  } catch (...) {
+    Shutdown();
+    throw;
+  }
+}
+
+EventLoopServer::~EventLoopServer() { Shutdown(); }
+
+void EventLoopServer::Shutdown() {
+  if (wakeup_fd_ >= 0) {
+    const auto one = std::uint64_t{1};
+    while (write(wakeup_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+      // intentionally empty block
+    }
+  }
+  loops_.clear();
+  for (const auto fd : listen_fds_) {
+    close(fd);
+  }
+  listen_fds_.clear();
+  for (const auto& path : socket_files_) {
+    unlink(path.c_str());
+  }
+  socket_files_.clear();
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+    wakeup_fd_ = -1;
+  }
+}
+
+std::vector<int> EventLoopServer::GetListeningPorts() const {
+  std::vector<int> ports;
+  for (const auto fd : listen_fds_) {
+    auto address = sockaddr_storage{};
+    auto length = static_cast<socklen_t>(sizeof(address));
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+      continue;
+    }
+    if (address.ss_family == AF_INET) {
+      ports.push_back(
+          ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port));
+    } else if (address.ss_family == AF_INET6) {
+      ports.push_back(
+          ntohs(reinterpret_cast<const sockaddr_in6&>(address).sin6_port));
+    }
+  }
+  return ports;
+}
+
+#else
+
+class EventLoopServer::EventLoop {};
+
+EventLoopServer::EventLoopServer(const std::string&, std::size_t) {
+  throw std::runtime_error("the event loop server requires Linux");
+}
+
+EventLoopServer::~EventLoopServer() = default;
+
+void EventLoopServer::Shutdown() {}
+
+std::vector<int> EventLoopServer::GetListeningPorts() const { return {}; }
+
+#endif
+
+void EventLoopServer::AddHandler(const std::string& uri,
+                                 MetricsHandler& handler) {
+  std::unique_lock<std::mutex> lock{handlers_mutex_};
+  auto& registered = handlers_[uri];
+  const auto replaced = registered;
+  registered = &handler;
+  if (replaced && replaced != &handler) {
+    WaitForReleasedHandler(lock, replaced);
+  }
+}
+
+void EventLoopServer::RemoveHandler(const std::string& uri) {
+  std::unique_lock<std::mutex> lock{handlers_mutex_};
+  auto it = handlers_.find(uri);
+  if (it == handlers_.end()) {
+    return;
+  }
+  const auto removed = it->second;
+  handlers_.erase(it);
+  WaitForReleasedHandler(lock, removed);
+}
+
+void EventLoopServer::AddAuthHandler(const std::string& uri,
+                                     BasicAuthHandler& handler) {
+  std::unique_lock<std::mutex> lock{handlers_mutex_};
+  auto& registered = auth_handlers_[uri];
+  const auto replaced = registered;
+  registered = &handler;
+  if (replaced && replaced != &handler) {
+    WaitForReleasedHandler(lock, replaced);
+  }
+}
+
+void EventLoopServer::RemoveAuthHandler(const std::string& uri) {
+  std::unique_lock<std::mutex> lock{handlers_mutex_};
+  auto it = auth_handlers_.find(uri);
+  if (it == auth_handlers_.end()) {
+    return;
+  }
+  const auto removed = it->second;
+  auth_handlers_.erase(it);
+  WaitForReleasedHandler(lock, removed);
+}
+
+void EventLoopServer::WaitForReleasedHandler(std::unique_lock<std::mutex>& lock,
+                                             const void* handler) {
+  handlers_released_.wait(
+      lock, [this, handler] { return borrowed_handlers_.count(handler) == 0; });
+}
+
+void EventLoopServer::BorrowHandler(const void* handler) {
+  if (handler) {
+    ++borrowed_handlers_[handler];
+  }
+}
+
+void EventLoopServer::ReleaseHandlers(const void* handler,
+                                      const void* auth_handler) {
+  std::lock_guard<std::mutex> lock{handlers_mutex_};
+  auto released = false;
+  for (const auto borrowed : {handler, auth_handler}) {
+    if (!borrowed) {
+      continue;
+    }
+    auto it = borrowed_handlers_.find(borrowed);
+    if (--it->second == 0) {
+      borrowed_handlers_.erase(it);
+      released = true;
+    }
+  }
+  if (released) {
+    handlers_released_.notify_all();
+  }
+}
+
+void EventLoopServer::Dispatch(HttpConnection& conn, const std::string& method,
+                               const std::string& path) {
+  MetricsHandler* handler = nullptr;
+  BasicAuthHandler* auth_handler = nullptr;
+  {
+    std::lock_guard<std::mutex> lock{handlers_mutex_};
+    auto it = handlers_.find(path);
+    if (it != handlers_.end()) {
+      handler = it->second;
+      auto auth_it = auth_handlers_.find(path);
+      if (auth_it != auth_handlers_.end()) {
+        auth_handler = auth_it->second;
+      }
+      BorrowHandler(handler);
+      BorrowHandler(auth_handler);
+    }
+  }
+
+  if (!handler) {
+    auto response = HttpResponse{};
+    response.status = 404;
+    conn.Write(response);
+    return;
+  }
+
+  try {
+    if (method != "GET") {
+      auto response = HttpResponse{};
+      response.status = 405;
+      response.headers.emplace_back("Allow", "GET");
+      conn.Write(response);
+    } else if (!auth_handler || auth_handler->Authorize(conn)) {
+      handler->HandleGet(conn);
+    }
+  } catch (...) {
+    ReleaseHandlers(handler, auth_handler);
+    throw;
+  }
+  ReleaseHandlers(handler, auth_handler);
+}
+
+}  // namespace detail
+}  // namespace prometheus
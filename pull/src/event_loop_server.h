@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "server.h"
+
+namespace prometheus {
+namespace detail {
+
+class HttpConnection;
+
+/// \brief Server backend multiplexing all connections with epoll.
+///
+/// Each thread runs an event loop which accepts connections, parses HTTP/1.1
+/// requests and writes responses without ever blocking on a socket. An idle
+/// keep-alive connection or a scraper which reads slowly therefore costs a
+/// buffer instead of a thread. The handlers run on the event loop thread
+/// itself, i.e., a slow collection delays the other connections of the same
+/// loop, but not those of the other loops.
+///
+/// The bind addresses are a comma-separated list in the format of the
+/// listening_ports option of civetweb, e.g., "127.0.0.1:8080,[::1]:8080". A
+/// port without an address binds all IPv4 interfaces. Local scrapers may
+/// connect via a unix domain socket instead, "unix:/run/app/metrics.sock"
+/// binds a socket file, which is removed again on destruction, and
+/// "unix:@app-metrics" a name in the abstract namespace of Linux.
+///
+/// Only available on Linux, the constructor throws std::runtime_error
+/// elsewhere.
+class EventLoopServer : public Server {
+ public:
+  EventLoopServer(const std::string& bind_addresses, std::size_t num_threads);
+  ~EventLoopServer() override;
+
+  EventLoopServer(const EventLoopServer&) = delete;
+  EventLoopServer(EventLoopServer&&) = delete;
+  EventLoopServer& operator=(const EventLoopServer&) = delete;
+  EventLoopServer& operator=(EventLoopServer&&) = delete;
+
+  void AddHandler(const std::string& uri, MetricsHandler& handler) override;
+  void RemoveHandler(const std::string& uri) override;
+  void AddAuthHandler(const std::string& uri,
+                      BasicAuthHandler& handler) override;
+  void RemoveAuthHandler(const std::string& uri) override;
+
+  std::vector<int> GetListeningPorts() const override;
+
+ private:
+  class Connection;
+  class EventLoop;
+
+  void Dispatch(HttpConnection& conn, const std::string& method,
+                const std::string& path);
+  void BorrowHandler(const void* handler);
+  void ReleaseHandlers(const void* handler, const void* auth_handler);
+  void WaitForReleasedHandler(std::unique_lock<std::mutex>& lock,
+                              const void* handler);
+  void Shutdown();
+
+  std::vector<int> listen_fds_;
+  std::vector<std::string> socket_files_;
+  int wakeup_fd_ = -1;
+  std::vector<std::unique_ptr<EventLoop>> loops_;
+
+  // the handlers are borrowed by the loops while serving a request, so a
+  // removed or replaced handler is only released to the caller once no
+  // request using it is in flight
+  std::mutex handlers_mutex_;
+  std::condition_variable handlers_released_;
+  std::map<std::string, MetricsHandler*> handlers_;
+  std::map<std::string, BasicAuthHandler*> auth_handlers_;
+  std::map<const void*, std::size_t> borrowed_handlers_;
+};
+
+}  // namespace detail
+}  // namespace prometheus
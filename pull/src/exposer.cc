@@ -2,25 +2,51 @@
 
 #include <algorithm>
 #include <iterator>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
-#include "CivetServer.h"
+#include "civetweb_server.h"
+#include "detail/thread_pool.h"
 #include "endpoint.h"
+#include "event_loop_server.h"
 #include "prometheus/detail/future_std.h"
 
 namespace prometheus {
 
+namespace {
+std::vector<std::string> CivetwebOptions(const std::string& bind_address,
+                                         const std::size_t num_threads) {
+  if (bind_address.find("unix:") != std::string::npos) {
+    throw std::invalid_argument(
+        "unix domain sockets require the event loop backend");
+  }
+  return {"listening_ports", bind_address, "num_threads",
+          std::to_string(num_threads)};
+}
+}  // namespace
+
 Exposer::Exposer(const std::string& bind_address, const std::size_t num_threads,
                  const CivetCallbacks* callbacks)
-    : Exposer(
-          std::vector<std::string>{"listening_ports", bind_address,
-                                   "num_threads", std::to_string(num_threads)},
-          callbacks) {}
+    : Exposer(CivetwebOptions(bind_address, num_threads), callbacks) {}
 
 Exposer::Exposer(std::vector<std::string> options,
                  const CivetCallbacks* callbacks)
-    : server_(detail::make_unique<CivetServer>(std::move(options), callbacks)) {
+    : server_(detail::make_unique<detail::CivetwebServer>(std::move(options),
+                                                          callbacks)) {}
+
+Exposer::Exposer(const std::string& bind_address, const std::size_t num_threads,
+                 const Backend backend) {
+  switch (backend) {
+    case Backend::kCivetweb:
+      server_ = detail::make_unique<detail::CivetwebServer>(
+          CivetwebOptions(bind_address, num_threads), nullptr);
+      break;
+    case Backend::kEventLoop:
+      server_ = detail::make_unique<detail::EventLoopServer>(bind_address,
+                                                             num_threads);
+      break;
+  }
 }
 
 Exposer::~Exposer() = default;
@@ -48,7 +74,41 @@ void Exposer::RemoveCollectable(const std::weak_ptr<Collectable>& collectable,
 }
 
 std::vector<int> Exposer::GetListeningPorts() const {
-  return server_->getListeningPorts();
+  return server_->GetListeningPorts();
+}
+
+void Exposer::SetCollectionParallelism(const std::size_t parallelism) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  collection_pool_ =
+      parallelism > 1 ? std::make_shared<detail::ThreadPool>(parallelism - 1)
+                      : nullptr;
+  for (auto& endpoint : endpoints_) {
+    endpoint->SetCollectionPool(collection_pool_);
+  }
+}
+
+void Exposer::SetScrapeTimeout(const std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  scrape_timeout_ = timeout;
+  for (auto& endpoint : endpoints_) {
+    endpoint->SetScrapeTimeout(scrape_timeout_);
+  }
+}
+
+void Exposer::SetPrerenderInterval(const std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  prerender_interval_ = interval;
+  for (auto& endpoint : endpoints_) {
+    endpoint->SetPrerenderInterval(prerender_interval_);
+  }
+}
+
+void Exposer::SetRenderedFamilyCache(const bool enabled) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  rendered_family_cache_ = enabled;
+  for (auto& endpoint : endpoints_) {
+    endpoint->SetRenderedFamilyCache(rendered_family_cache_);
+  }
 }
 
 detail::Endpoint& Exposer::GetEndpointForUri(const std::string& uri) {
@@ -61,6 +121,10 @@ detail::Endpoint& Exposer::GetEndpointForUri(const std::string& uri) {
   }
 
   endpoints_.emplace_back(detail::make_unique<detail::Endpoint>(*server_, uri));
+  endpoints_.back()->SetCollectionPool(collection_pool_);
+  endpoints_.back()->SetScrapeTimeout(scrape_timeout_);
+  endpoints_.back()->SetPrerenderInterval(prerender_interval_);
+  endpoints_.back()->SetRenderedFamilyCache(rendered_family_cache_);
   return *endpoints_.back().get();
 }
 
@@ -2,27 +2,162 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <map>
+#include <stdexcept>
 #include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #ifdef HAVE_ZLIB
 #include <zconf.h>
 #include <zlib.h>
 #endif
 
-#include "civetweb.h"
 #include "metrics_collector.h"
+#include "prometheus/client_metric.h"
 #include "prometheus/counter.h"
+#include "prometheus/gauge.h"
+#include "prometheus/histogram.h"
 #include "prometheus/metric_family.h"
+#include "prometheus/metric_filter.h"
+#include "prometheus/metric_type.h"
+#include "prometheus/protobuf_serializer.h"
 #include "prometheus/summary.h"
 #include "prometheus/text_serializer.h"
 
 namespace prometheus {
 namespace detail {
 
+namespace {
+Histogram::BucketBoundaries PhaseDurationBuckets() {
+  return {0.0001, 0.001, 0.01, 0.1, 1, 10};
+}
+
+double SecondsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+std::size_t CountSeries(const std::vector<MetricFamily>& metrics) {
+  auto series = std::size_t{0};
+  for (const auto& family : metrics) {
+    series += family.metric.size();
+  }
+  return series;
+}
+
+std::size_t TotalSize(
+    const std::vector<std::shared_ptr<const std::string>>& segments) {
+  auto size = std::size_t{0};
+  for (const auto& segment : segments) {
+    size += segment->size();
+  }
+  return size;
+}
+
+// bitwise, so that neither NaN nor a changed sign of zero goes unnoticed
+bool SameValue(const double lhs, const double rhs) {
+  return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+// compares just what the text format exposes of a metric of the given type
+bool SameText(const ClientMetric& lhs, const ClientMetric& rhs,
+              const MetricType type) {
+  if (lhs.label != rhs.label || lhs.timestamp_ms != rhs.timestamp_ms) {
+    return false;
+  }
+  switch (type) {
+    case MetricType::Counter:
+      return SameValue(lhs.counter.value, rhs.counter.value);
+    case MetricType::Gauge:
+      return SameValue(lhs.gauge.value, rhs.gauge.value);
+    case MetricType::Info:
+      return SameValue(lhs.info.value, rhs.info.value);
+    case MetricType::Untyped:
+      return SameValue(lhs.untyped.value, rhs.untyped.value);
+    case MetricType::Summary: {
+      const auto& left = lhs.summary;
+      const auto& right = rhs.summary;
+      if (left.sample_count != right.sample_count ||
+          !SameValue(left.sample_sum, right.sample_sum) ||
+          left.quantile.size() != right.quantile.size()) {
+        return false;
+      }
+      for (std::size_t i = 0; i < left.quantile.size(); ++i) {
+        if (!SameValue(left.quantile[i].quantile, right.quantile[i].quantile) ||
+            !SameValue(left.quantile[i].value, right.quantile[i].value)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case MetricType::Histogram: {
+      const auto& left = lhs.histogram;
+      const auto& right = rhs.histogram;
+      if (left.sample_count != right.sample_count ||
+          !SameValue(left.sample_sum, right.sample_sum) ||
+          left.bucket.size() != right.bucket.size()) {
+        return false;
+      }
+      for (std::size_t i = 0; i < left.bucket.size(); ++i) {
+        if (left.bucket[i].cumulative_count !=
+                right.bucket[i].cumulative_count ||
+            !SameValue(left.bucket[i].upper_bound,
+                       right.bucket[i].upper_bound)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SameText(const MetricFamily& lhs, const MetricFamily& rhs) {
+  if (lhs.name != rhs.name || lhs.help != rhs.help || lhs.type != rhs.type ||
+      lhs.metric.size() != rhs.metric.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.metric.size(); ++i) {
+    if (!SameText(lhs.metric[i], rhs.metric[i], lhs.type)) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+struct MetricsHandler::PrerenderedBody {
+  std::chrono::steady_clock::time_point rendered_at;
+  BodySegments text;
+  // empty unless compression is enabled
+  std::string gzip_text;
+};
+
+// families of the same name may come from several collectables
+struct MetricsHandler::RenderedFamilies {
+  using Key = std::pair<const Collectable*, std::string>;
+  struct Entry {
+    MetricFamily family;
+    std::shared_ptr<const std::string> text;
+  };
+  std::map<Key, Entry> families;
+};
+
 MetricsHandler::MetricsHandler(Registry& registry)
-    : bytes_transferred_family_(
+    : collectables_(
+          std::make_shared<std::vector<std::weak_ptr<Collectable>>>()),
+      late_collections_(std::make_shared<LateCollections>()),
+      bytes_transferred_family_(
           BuildCounter()
               .Name("exposer_transferred_bytes_total")
               .Help("Transferred bytes to metrics services")
@@ -39,19 +174,76 @@ MetricsHandler::MetricsHandler(Registry& registry)
               .Help("Latencies of serving scrape requests, in microseconds")
               .Register(registry)),
       request_latencies_(request_latencies_family_.Add(
-          {}, Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}})) {}
+          {}, Summary::Quantiles{{0.5, 0.05}, {0.9, 0.01}, {0.99, 0.001}})),
+      skipped_collectables_family_(
+          BuildCounter()
+              .Name("exposer_skipped_collectables_total")
+              .Help("Collectables left out of scrapes as they missed the "
+                    "scrape timeout")
+              .Register(registry)),
+      skipped_collectables_(skipped_collectables_family_.Add({})),
+      phase_durations_family_(
+          BuildHistogram()
+              .Name("exposer_scrape_phase_duration_seconds")
+              .Help("Durations of the phases of serving scrapes, including "
+                    "the renderings in the background")
+              .Register(registry)),
+      collect_duration_(phase_durations_family_.Add(
+          {{"phase", "collect"}}, PhaseDurationBuckets())),
+      serialize_duration_(phase_durations_family_.Add(
+          {{"phase", "serialize"}}, PhaseDurationBuckets())),
+      compress_duration_(phase_durations_family_.Add(
+          {{"phase", "compress"}}, PhaseDurationBuckets())),
+      write_duration_(phase_durations_family_.Add({{"phase", "write"}},
+                                                  PhaseDurationBuckets())),
+      uncompressed_bytes_family_(
+          BuildCounter()
+              .Name("exposer_uncompressed_bytes_total")
+              .Help("Bytes of the served responses before compression")
+              .Register(registry)),
+      uncompressed_bytes_(uncompressed_bytes_family_.Add({})),
+      compressed_bytes_family_(
+          BuildCounter()
+              .Name("exposer_compressed_bytes_total")
+              .Help("Bytes of the served compressed responses")
+              .Register(registry)),
+      compressed_bytes_(compressed_bytes_family_.Add({})),
+      scrape_series_family_(
+          BuildGauge()
+              .Name("exposer_scrape_series")
+              .Help("Number of series collected by the latest scrape of all "
+                    "metrics")
+              .Register(registry)),
+      scrape_series_(scrape_series_family_.Add({})),
+      collectable_durations_family_(
+          BuildGauge()
+              .Name("exposer_collectable_duration_seconds")
+              .Help("Duration of the latest collection of each collectable, "
+                    "numbered in the order of registration")
+              .Register(registry)) {}
+
+MetricsHandler::~MetricsHandler() {
+  SetPrerenderInterval(std::chrono::milliseconds::zero());
+}
+
+// like the blackbox exporter, leave part of the timeout of Prometheus for
+// serializing and transferring the response
+static const auto kScrapeTimeoutOffset = std::chrono::milliseconds{500};
+static const auto kMaxScrapeTimeoutSeconds = 86400.0;
 
 #ifdef HAVE_ZLIB
-static bool IsEncodingAccepted(struct mg_connection* conn,
+static bool IsEncodingAccepted(const HttpConnection& conn,
                                const char* encoding) {
-  auto accept_encoding = mg_get_header(conn, "Accept-Encoding");
+  auto accept_encoding = conn.GetHeader("Accept-Encoding");
   if (!accept_encoding) {
     return false;
   }
   return std::strstr(accept_encoding, encoding) != nullptr;
 }
 
-static std::vector<Byte> GZipCompress(const std::string& input) {
+// compresses the segments as one stream without joining them first
+static std::string GZipCompress(
+    const std::vector<std::shared_ptr<const std::string>>& input) {
   auto zs = z_stream{};
   auto windowSize = 16 + MAX_WBITS;
   auto memoryLevel = 9;
@@ -61,21 +253,26 @@ static std::vector<Byte> GZipCompress(const std::string& input) {
     return {};
   }
 
-  zs.next_in = (Bytef*)input.data();
-  zs.avail_in = input.size();
-
   int ret;
-  std::vector<Byte> output;
-  output.reserve(input.size() / 2u);
+  std::string output;
+  output.reserve(TotalSize(input) / 2u);
 
+  auto segment = input.begin();
   do {
     static const auto outputBytesPerRound = std::size_t{32768};
 
+    // deflate makes no progress on empty input unless finishing
+    while (zs.avail_in == 0 && segment != input.end()) {
+      zs.next_in = (Bytef*)(*segment)->data();
+      zs.avail_in = (*segment)->size();
+      ++segment;
+    }
+
     zs.avail_out = outputBytesPerRound;
     output.resize(zs.total_out + zs.avail_out);
-    zs.next_out = reinterpret_cast<Bytef*>(output.data() + zs.total_out);
+    zs.next_out = reinterpret_cast<Bytef*>(&output[0] + zs.total_out);
 
-    ret = deflate(&zs, Z_FINISH);
+    ret = deflate(&zs, segment == input.end() ? Z_FINISH : Z_NO_FLUSH);
 
     output.resize(zs.total_out);
   } while (ret == Z_OK);
@@ -90,39 +287,163 @@ static std::vector<Byte> GZipCompress(const std::string& input) {
 }
 #endif
 
-static std::size_t WriteResponse(struct mg_connection* conn,
-                                 const std::string& body) {
-  mg_printf(conn,
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/plain; charset=utf-8\r\n");
+static bool IsProtobufAccepted(const HttpConnection& conn) {
+  auto accept = conn.GetHeader("Accept");
+  if (!accept) {
+    return false;
+  }
+  return std::strstr(accept, "application/vnd.google.protobuf") != nullptr &&
+         std::strstr(accept, "proto=io.prometheus.client.MetricFamily") !=
+             nullptr;
+}
 
-#ifdef HAVE_ZLIB
-  auto acceptsGzip = IsEncodingAccepted(conn, "gzip");
+static int HexDigitValue(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
 
-  if (acceptsGzip) {
-    auto compressed = GZipCompress(body);
-    if (!compressed.empty()) {
-      mg_printf(conn,
-                "Content-Encoding: gzip\r\n"
-                "Content-Length: %lu\r\n\r\n",
-                static_cast<unsigned long>(compressed.size()));
-      mg_write(conn, compressed.data(), compressed.size());
-      return compressed.size();
+static std::string DecodeQueryComponent(const std::string& component) {
+  std::string decoded;
+  decoded.reserve(component.size());
+  for (std::size_t i = 0; i < component.size(); ++i) {
+    if (component[i] == '+') {
+      decoded += ' ';
+    } else if (component[i] == '%' && i + 2 < component.size() &&
+               HexDigitValue(component[i + 1]) >= 0 &&
+               HexDigitValue(component[i + 2]) >= 0) {
+      decoded += static_cast<char>(HexDigitValue(component[i + 1]) * 16 +
+                                   HexDigitValue(component[i + 2]));
+      i += 2;
+    } else {
+      decoded += component[i];
     }
   }
-#endif
+  return decoded;
+}
+
+// supports the subset of the series selectors of the federation endpoint of
+// Prometheus which selects by name: "name", {__name__="name"} and
+// {__name__=~"pattern"}, see MetricFilter::AddPattern() for the supported
+// patterns
+static void AddSelector(MetricFilter& filter, const std::string& selector) {
+  static const std::string kNameMatcher = "{__name__=";
+
+  if (selector.compare(0, kNameMatcher.size(), kNameMatcher) != 0) {
+    if (selector.find_first_of("{}") != std::string::npos) {
+      throw std::invalid_argument(
+          "only selectors matching just __name__ are supported");
+    }
+    filter.AddName(selector);
+    return;
+  }
+
+  auto begin = kNameMatcher.size();
+  const auto is_pattern = selector.compare(begin, 1, "~") == 0;
+  if (is_pattern) {
+    ++begin;
+  }
+  const auto end = selector.size() - 2;
+  if (selector.size() < begin + 3 || selector[begin] != '"' ||
+      selector.compare(end, 2, "\"}") != 0) {
+    throw std::invalid_argument(
+        "only selectors matching just __name__ are supported");
+  }
+  auto value = std::string{};
+  for (auto i = begin + 1; i < end; ++i) {
+    if (selector[i] == '"') {
+      throw std::invalid_argument(
+          "only selectors matching just __name__ are supported");
+    }
+    if (selector[i] == '\\' && i + 1 < end) {
+      ++i;
+    }
+    value += selector[i];
+  }
+
+  if (is_pattern) {
+    filter.AddPattern(value);
+  } else {
+    filter.AddName(value);
+  }
+}
+
+// name[]=... selects families by their exact name, match[]=... by a series
+// selector, both may be repeated
+static MetricFilter ParseMetricFilter(const char* query_string) {
+  auto filter = MetricFilter{};
+  if (!query_string) {
+    return filter;
+  }
 
-  mg_printf(conn, "Content-Length: %lu\r\n\r\n",
-            static_cast<unsigned long>(body.size()));
-  mg_write(conn, body.data(), body.size());
-  return body.size();
+  const auto query = std::string{query_string};
+  for (std::size_t begin = 0; begin <= query.size();) {
+    auto end = query.find('&', begin);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    const auto parameter = query.substr(begin, end - begin);
+    begin = end + 1;
+
+    const auto equals = parameter.find('=');
+    if (equals == std::string::npos) {
+      continue;
+    }
+    const auto key = DecodeQueryComponent(parameter.substr(0, equals));
+    const auto value = DecodeQueryComponent(parameter.substr(equals + 1));
+    if (key == "name[]") {
+      filter.AddName(value);
+    } else if (key == "match[]") {
+      AddSelector(filter, value);
+    }
+  }
+  return filter;
+}
+
+static MetricFamily SkippedCollectablesFamily(const std::size_t skipped) {
+  auto family = MetricFamily{};
+  family.name = "exposer_scrape_skipped_collectables";
+  family.help = "Collectables left out of this scrape as they missed the "
+                "scrape timeout";
+  family.type = MetricType::Gauge;
+  family.metric.emplace_back();
+  family.metric.back().gauge.value = static_cast<double>(skipped);
+  return family;
 }
 
 void MetricsHandler::RegisterCollectable(
     const std::weak_ptr<Collectable>& collectable) {
   std::lock_guard<std::mutex> lock{collectables_mutex_};
-  CleanupStalePointers(collectables_);
-  collectables_.push_back(collectable);
+  auto collectables =
+      std::make_shared<std::vector<std::weak_ptr<Collectable>>>(
+          *collectables_);
+  CleanupStalePointers(*collectables);
+  collectables->push_back(collectable);
+
+  // the ids of collectables gone meanwhile are dropped, their address may be
+  // reused by the next one
+  auto ids = std::map<const Collectable*, std::size_t>{};
+  for (const auto& wcollectable : *collectables) {
+    auto live = wcollectable.lock();
+    auto it = live ? collectable_ids_.find(live.get()) : collectable_ids_.end();
+    if (it != collectable_ids_.end()) {
+      ids.insert(*it);
+    }
+  }
+  if (auto live = collectable.lock()) {
+    ids[live.get()] = next_collectable_id_;
+  }
+  ++next_collectable_id_;
+
+  collectable_ids_.swap(ids);
+  collectables_ = std::move(collectables);
 }
 
 void MetricsHandler::RemoveCollectable(
@@ -134,24 +455,387 @@ void MetricsHandler::RemoveCollectable(
     return locked == candidate.lock();
   };
 
-  collectables_.erase(std::remove_if(std::begin(collectables_),
-                                     std::end(collectables_), same_pointer),
-                      std::end(collectables_));
+  auto collectables =
+      std::make_shared<std::vector<std::weak_ptr<Collectable>>>(
+          *collectables_);
+  collectables->erase(std::remove_if(std::begin(*collectables),
+                                     std::end(*collectables), same_pointer),
+                      std::end(*collectables));
+  collectable_ids_.erase(locked.get());
+  collectables_ = std::move(collectables);
+}
+
+void MetricsHandler::SetCollectionPool(std::shared_ptr<ThreadPool> pool) {
+  std::lock_guard<std::mutex> lock{collectables_mutex_};
+  collection_pool_ = std::move(pool);
+}
+
+void MetricsHandler::SetScrapeTimeout(
+    const std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> lock{collectables_mutex_};
+  scrape_timeout_ = timeout;
+}
+
+static std::chrono::steady_clock::duration GetScrapeTimeout(
+    const HttpConnection& conn, const std::chrono::milliseconds configured) {
+  auto timeout = std::chrono::steady_clock::duration{configured};
+
+  auto header = conn.GetHeader("X-Prometheus-Scrape-Timeout-Seconds");
+  if (!header) {
+    return timeout;
+  }
+  char* end;
+  const auto seconds = std::strtod(header, &end);
+  if (end == header || !(seconds > 0.0)) {
+    return timeout;
+  }
+
+  using Duration = std::chrono::steady_clock::duration;
+  const auto capped = std::min(seconds, kMaxScrapeTimeoutSeconds);
+  auto requested = std::chrono::duration_cast<Duration>(
+      std::chrono::duration<double>{capped});
+  if (requested > 2 * kScrapeTimeoutOffset) {
+    requested -= kScrapeTimeoutOffset;
+  }
+  if (timeout == timeout.zero() || requested < timeout) {
+    timeout = requested;
+  }
+  return timeout;
+}
+
+void MetricsHandler::SetPrerenderInterval(
+    const std::chrono::milliseconds interval) {
+  std::thread stopped_thread;
+  {
+    std::lock_guard<std::mutex> lock{prerender_mutex_};
+    prerender_interval_ = interval;
+    if (interval == interval.zero()) {
+      stopped_thread = std::move(prerender_thread_);
+      prerendered_.reset();
+    } else if (!prerender_thread_.joinable()) {
+      prerender_thread_ = std::thread(&MetricsHandler::RunPrerenderer, this);
+    }
+  }
+  prerender_changed_.notify_all();
+  if (stopped_thread.joinable()) {
+    stopped_thread.join();
+  }
+}
+
+void MetricsHandler::RunPrerenderer() {
+#ifdef __linux__
+  // best effort, lowering the priority of a thread needs no privileges
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+
+  std::unique_lock<std::mutex> lock{prerender_mutex_};
+  while (prerender_interval_ != prerender_interval_.zero()) {
+    const auto next_rendering =
+        std::chrono::steady_clock::now() + prerender_interval_;
+    lock.unlock();
+    Prerender();
+    lock.lock();
+    // a changed interval takes effect at once
+    const auto interval = prerender_interval_;
+    prerender_changed_.wait_until(lock, next_rendering, [&] {
+      return prerender_interval_ != interval;
+    });
+  }
 }
 
-bool MetricsHandler::handleGet(CivetServer*, struct mg_connection* conn) {
+void MetricsHandler::Prerender() {
+  auto body = std::make_shared<PrerenderedBody>();
+  body->rendered_at = std::chrono::steady_clock::now();
+
+  std::shared_ptr<const std::vector<std::weak_ptr<Collectable>>> collectables;
+  std::shared_ptr<ThreadPool> collection_pool;
+  {
+    std::lock_guard<std::mutex> lock{collectables_mutex_};
+    collectables = collectables_;
+    collection_pool = collection_pool_;
+  }
+
+  try {
+    std::vector<CollectableTiming> timings;
+    auto metrics = CollectMetrics(*collectables, MetricFilter{},
+                                  collection_pool.get(), &timings);
+    collect_duration_.Observe(SecondsSince(body->rendered_at));
+    UpdateCollectableDurations(timings);
+    scrape_series_.Set(static_cast<double>(CountSeries(metrics)));
+
+    const auto serialize_start = std::chrono::steady_clock::now();
+    body->text = RenderText(std::move(metrics), &timings);
+    serialize_duration_.Observe(SecondsSince(serialize_start));
+#ifdef HAVE_ZLIB
+    const auto compress_start = std::chrono::steady_clock::now();
+    body->gzip_text = GZipCompress(body->text);
+    compress_duration_.Observe(SecondsSince(compress_start));
+#endif
+  } catch (const std::exception&) {
+    // keep serving the previous body, it just ages
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock{prerender_mutex_};
+  if (prerender_interval_ != prerender_interval_.zero()) {
+    prerendered_ = std::move(body);
+  }
+}
+
+bool MetricsHandler::ServePrerendered(HttpConnection& conn) {
+  // filtered and protobuf scrapes are collected on demand
+  const auto query_string = conn.GetQueryString();
+  if ((query_string && *query_string) || IsProtobufAccepted(conn)) {
+    return false;
+  }
+
+  std::shared_ptr<const PrerenderedBody> body;
+  {
+    std::lock_guard<std::mutex> lock{prerender_mutex_};
+    body = prerendered_;
+  }
+  if (!body) {
+    return false;
+  }
+
+  const auto age = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::steady_clock::now() - body->rendered_at);
+  HttpResponse response;
+  response.headers.emplace_back("Content-Type", "text/plain; charset=utf-8");
+  response.headers.emplace_back("Age", std::to_string(age.count()));
+  uncompressed_bytes_.Increment(static_cast<double>(TotalSize(body->text)));
+  // the response shares the buffers of the body instead of copying them
+#ifdef HAVE_ZLIB
+  if (!body->gzip_text.empty() && IsEncodingAccepted(conn, "gzip")) {
+    response.headers.emplace_back("Content-Encoding", "gzip");
+    response.body_segments.emplace_back(body, &body->gzip_text);
+    compressed_bytes_.Increment(static_cast<double>(body->gzip_text.size()));
+  } else {
+    response.body_segments = body->text;
+  }
+#else
+  response.body_segments = body->text;
+#endif
+  const auto write_start = std::chrono::steady_clock::now();
+  conn.Write(response);
+  write_duration_.Observe(SecondsSince(write_start));
+
+  bytes_transferred_.Increment(static_cast<double>(GetBodySize(response)));
+  num_scrapes_.Increment();
+  return true;
+}
+
+void MetricsHandler::SetRenderedFamilyCache(const bool enabled) {
+  std::lock_guard<std::mutex> lock{rendered_families_mutex_};
+  cache_rendered_families_ = enabled;
+  rendered_families_.reset();
+}
+
+MetricsHandler::BodySegments MetricsHandler::RenderText(
+    std::vector<MetricFamily> metrics,
+    const std::vector<CollectableTiming>* timings) {
+  const TextSerializer serializer;
+  std::shared_ptr<const RenderedFamilies> previous;
+  bool cache_rendered_families;
+  {
+    std::lock_guard<std::mutex> lock{rendered_families_mutex_};
+    previous = rendered_families_;
+    cache_rendered_families = cache_rendered_families_;
+  }
+
+  // filtered scrapes tell nothing about the collectables of their families
+  if (!cache_rendered_families || !timings) {
+    return {std::make_shared<const std::string>(serializer.Serialize(metrics))};
+  }
+
+  auto rendered = std::make_shared<RenderedFamilies>();
+  auto single_family = std::vector<MetricFamily>(1);
+  auto timing = timings->begin();
+  auto families_of_timing = std::size_t{0};
+  BodySegments body;
+  body.reserve(metrics.size());
+  for (auto& family : metrics) {
+    // the families of the collectables come in the order of the timings,
+    // those added by the handler itself last
+    while (timing != timings->end() && families_of_timing == timing->families) {
+      ++timing;
+      families_of_timing = 0;
+    }
+    const Collectable* collectable = nullptr;
+    if (timing != timings->end()) {
+      collectable = timing->collectable;
+      ++families_of_timing;
+    }
+    auto key = RenderedFamilies::Key{collectable, family.name};
+
+    std::shared_ptr<const std::string> text;
+    if (previous) {
+      const auto it = previous->families.find(key);
+      if (it != previous->families.end() &&
+          SameText(it->second.family, family)) {
+        text = it->second.text;
+      }
+    }
+    if (!text) {
+      single_family.front() = std::move(family);
+      text = std::make_shared<const std::string>(
+          serializer.Serialize(single_family));
+      family = std::move(single_family.front());
+    }
+    body.push_back(text);
+    rendered->families.emplace(
+        std::move(key), RenderedFamilies::Entry{std::move(family), text});
+  }
+
+  std::lock_guard<std::mutex> lock{rendered_families_mutex_};
+  if (cache_rendered_families_) {
+    rendered_families_ = std::move(rendered);
+  }
+  return body;
+}
+
+std::size_t MetricsHandler::WriteResponse(HttpConnection& conn,
+                                          BodySegments body,
+                                          const char* content_type) {
+  HttpResponse response;
+  response.headers.emplace_back("Content-Type", content_type);
+  uncompressed_bytes_.Increment(static_cast<double>(TotalSize(body)));
+
+#ifdef HAVE_ZLIB
+  auto acceptsGzip = IsEncodingAccepted(conn, "gzip");
+
+  if (acceptsGzip) {
+    const auto compress_start = std::chrono::steady_clock::now();
+    auto compressed = GZipCompress(body);
+    compress_duration_.Observe(SecondsSince(compress_start));
+    if (!compressed.empty()) {
+      response.headers.emplace_back("Content-Encoding", "gzip");
+      compressed_bytes_.Increment(static_cast<double>(compressed.size()));
+      body = {std::make_shared<const std::string>(std::move(compressed))};
+    }
+  }
+#endif
+
+  response.body_segments = std::move(body);
+  const auto write_start = std::chrono::steady_clock::now();
+  conn.Write(response);
+  write_duration_.Observe(SecondsSince(write_start));
+  return GetBodySize(response);
+}
+
+void MetricsHandler::UpdateCollectableDurations(
+    const std::vector<CollectableTiming>& timings) {
+  // collectables removed since their collection are left out
+  auto durations = std::map<std::size_t, double>{};
+  {
+    std::lock_guard<std::mutex> lock{collectables_mutex_};
+    for (const auto& timing : timings) {
+      auto it = collectable_ids_.find(timing.collectable);
+      if (it != collectable_ids_.end()) {
+        durations[it->second] =
+            std::chrono::duration<double>(timing.duration).count();
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{collectable_durations_mutex_};
+
+  auto updated = std::map<std::size_t, Gauge*>{};
+  for (const auto& duration : durations) {
+    auto it = collectable_durations_.find(duration.first);
+    auto& gauge = it != collectable_durations_.end()
+                      ? *it->second
+                      : collectable_durations_family_.Add(
+                            {{"collectable", std::to_string(duration.first)}});
+    gauge.Set(duration.second);
+    updated.emplace(duration.first, &gauge);
+  }
+
+  // collectables gone or empty meanwhile
+  for (const auto& entry : collectable_durations_) {
+    if (updated.count(entry.first) == 0) {
+      collectable_durations_family_.Remove(entry.second);
+    }
+  }
+  collectable_durations_.swap(updated);
+}
+
+void MetricsHandler::HandleGet(HttpConnection& conn) {
   auto start_time_of_request = std::chrono::steady_clock::now();
 
+  if (ServePrerendered(conn)) {
+    const auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time_of_request);
+    request_latencies_.Observe(duration.count());
+    return;
+  }
+
+  MetricFilter filter;
+  try {
+    filter = ParseMetricFilter(conn.GetQueryString());
+  } catch (const std::invalid_argument& e) {
+    HttpResponse response;
+    response.status = 400;
+    response.headers.emplace_back("Content-Type", "text/plain; charset=utf-8");
+    response.body = std::string{e.what()} + "\n";
+    conn.Write(response);
+    return;
+  }
+
   std::vector<MetricFamily> metrics;
+  std::size_t skipped = 0;
 
+  std::shared_ptr<const std::vector<std::weak_ptr<Collectable>>> collectables;
+  std::shared_ptr<ThreadPool> collection_pool;
+  std::chrono::milliseconds configured_scrape_timeout;
   {
     std::lock_guard<std::mutex> lock{collectables_mutex_};
-    metrics = CollectMetrics(collectables_);
+    collectables = collectables_;
+    collection_pool = collection_pool_;
+    configured_scrape_timeout = scrape_timeout_;
   }
 
-  const TextSerializer serializer;
+  // the metrics of filtered scrapes tell nothing about the collectables
+  std::vector<CollectableTiming> timings;
+  const auto timings_of_scrape = filter.Empty() ? &timings : nullptr;
+
+  const auto collect_start = std::chrono::steady_clock::now();
+  const auto scrape_timeout =
+      GetScrapeTimeout(conn, configured_scrape_timeout);
+  if (scrape_timeout == scrape_timeout.zero()) {
+    metrics = CollectMetrics(*collectables, filter, collection_pool.get(),
+                             timings_of_scrape);
+  } else {
+    metrics = CollectMetrics(*collectables, filter, collection_pool.get(),
+                             start_time_of_request + scrape_timeout,
+                             late_collections_, skipped, timings_of_scrape);
+    auto skipped_family = SkippedCollectablesFamily(skipped);
+    if (filter.Matches(skipped_family.name)) {
+      metrics.push_back(std::move(skipped_family));
+    }
+  }
+  collect_duration_.Observe(SecondsSince(collect_start));
+  if (timings_of_scrape) {
+    UpdateCollectableDurations(timings);
+    scrape_series_.Set(static_cast<double>(CountSeries(metrics)));
+  }
 
-  auto bodySize = WriteResponse(conn, serializer.Serialize(metrics));
+  const auto serialize_start = std::chrono::steady_clock::now();
+  BodySegments body;
+  const char* content_type;
+  if (IsProtobufAccepted(conn)) {
+    const ProtobufSerializer serializer;
+    body.push_back(
+        std::make_shared<const std::string>(serializer.Serialize(metrics)));
+    content_type = ProtobufSerializer::kContentType;
+  } else {
+    body = RenderText(std::move(metrics), timings_of_scrape);
+    content_type = "text/plain; charset=utf-8";
+  }
+  serialize_duration_.Observe(SecondsSince(serialize_start));
+
+  const auto bodySize = WriteResponse(conn, std::move(body), content_type);
 
   auto stop_time_of_request = std::chrono::steady_clock::now();
   auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -160,7 +844,7 @@ bool MetricsHandler::handleGet(CivetServer*, struct mg_connection* conn) {
 
   bytes_transferred_.Increment(bodySize);
   num_scrapes_.Increment();
-  return true;
+  skipped_collectables_.Increment(static_cast<double>(skipped));
 }
 
 void MetricsHandler::CleanupStalePointers(
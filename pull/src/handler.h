@@ -1,39 +1,115 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
-#include "CivetServer.h"
+#include "http_connection.h"
 #include "prometheus/collectable.h"
 #include "prometheus/counter.h"
 #include "prometheus/family.h"
+#include "prometheus/gauge.h"
+#include "prometheus/histogram.h"
+#include "prometheus/metric_family.h"
 #include "prometheus/registry.h"
 #include "prometheus/summary.h"
 
 namespace prometheus {
 namespace detail {
-class MetricsHandler : public CivetHandler {
+struct CollectableTiming;
+class LateCollections;
+class ThreadPool;
+
+class MetricsHandler {
  public:
   explicit MetricsHandler(Registry& registry);
+  ~MetricsHandler();
+
+  MetricsHandler(const MetricsHandler&) = delete;
+  MetricsHandler(MetricsHandler&&) = delete;
+  MetricsHandler& operator=(const MetricsHandler&) = delete;
+  MetricsHandler& operator=(MetricsHandler&&) = delete;
 
   void RegisterCollectable(const std::weak_ptr<Collectable>& collectable);
   void RemoveCollectable(const std::weak_ptr<Collectable>& collectable);
+  void SetCollectionPool(std::shared_ptr<ThreadPool> pool);
+  void SetScrapeTimeout(std::chrono::milliseconds timeout);
+  void SetPrerenderInterval(std::chrono::milliseconds interval);
+  void SetRenderedFamilyCache(bool enabled);
 
-  bool handleGet(CivetServer* server, struct mg_connection* conn) override;
+  void HandleGet(HttpConnection& conn);
 
  private:
+  struct PrerenderedBody;
+  struct RenderedFamilies;
+  using BodySegments = std::vector<std::shared_ptr<const std::string>>;
+
+  void RunPrerenderer();
+  void Prerender();
+  bool ServePrerendered(HttpConnection& conn);
+  BodySegments RenderText(std::vector<MetricFamily> metrics,
+                          const std::vector<CollectableTiming>* timings);
+  std::size_t WriteResponse(HttpConnection& conn, BodySegments body,
+                            const char* content_type);
+  void UpdateCollectableDurations(
+      const std::vector<CollectableTiming>& timings);
+
   static void CleanupStalePointers(
       std::vector<std::weak_ptr<Collectable>>& collectables);
 
+  // the collectables are published as an immutable snapshot, a scrape keeps
+  // collecting its snapshot while the collectables are changed
   std::mutex collectables_mutex_;
-  std::vector<std::weak_ptr<Collectable>> collectables_;
+  std::shared_ptr<const std::vector<std::weak_ptr<Collectable>>>
+      collectables_;
+  // numbered in the order of registration, labels their collection duration
+  std::map<const Collectable*, std::size_t> collectable_ids_;
+  std::size_t next_collectable_id_ = 0;
+  std::shared_ptr<ThreadPool> collection_pool_;
+  std::chrono::milliseconds scrape_timeout_{0};
+  const std::shared_ptr<LateCollections> late_collections_;
   Family<Counter>& bytes_transferred_family_;
   Counter& bytes_transferred_;
   Family<Counter>& num_scrapes_family_;
   Counter& num_scrapes_;
   Family<Summary>& request_latencies_family_;
   Summary& request_latencies_;
+  Family<Counter>& skipped_collectables_family_;
+  Counter& skipped_collectables_;
+  Family<Histogram>& phase_durations_family_;
+  Histogram& collect_duration_;
+  Histogram& serialize_duration_;
+  Histogram& compress_duration_;
+  Histogram& write_duration_;
+  Family<Counter>& uncompressed_bytes_family_;
+  Counter& uncompressed_bytes_;
+  Family<Counter>& compressed_bytes_family_;
+  Counter& compressed_bytes_;
+  Family<Gauge>& scrape_series_family_;
+  Gauge& scrape_series_;
+  Family<Gauge>& collectable_durations_family_;
+  std::mutex collectable_durations_mutex_;
+  std::map<std::size_t, Gauge*> collectable_durations_;
+
+  // if enabled, the text of each family of the latest complete scrape, a
+  // family whose samples did not change is not rendered again
+  std::mutex rendered_families_mutex_;
+  bool cache_rendered_families_ = false;
+  std::shared_ptr<const RenderedFamilies> rendered_families_;
+
+  // the latest body rendered in the background is swapped in as a whole, a
+  // scrape keeps serving the previous one while the next is published
+  std::mutex prerender_mutex_;
+  std::condition_variable prerender_changed_;
+  std::chrono::milliseconds prerender_interval_{0};
+  std::shared_ptr<const PrerenderedBody> prerendered_;
+  std::thread prerender_thread_;
 };
 }  // namespace detail
 }  // namespace prometheus
@@ -0,0 +1,62 @@
+#include "http_connection.h"
+
+namespace prometheus {
+namespace detail {
+
+const char* GetReasonPhrase(const int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 400:
+      return "Bad Request";
+    case 401:
+      return "Unauthorized";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 408:
+      return "Request Timeout";
+    case 413:
+      return "Payload Too Large";
+    case 431:
+      return "Request Header Fields Too Large";
+    case 500:
+      return "Internal Server Error";
+    case 501:
+      return "Not Implemented";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Unknown";
+  }
+}
+
+std::size_t GetBodySize(const HttpResponse& response) {
+  auto size = response.body.size();
+  for (const auto& segment : response.body_segments) {
+    size += segment->size();
+  }
+  return size;
+}
+
+std::string FormatResponseHead(const HttpResponse& response) {
+  auto head = std::string{"HTTP/1.1 "};
+  head += std::to_string(response.status);
+  head += ' ';
+  head += GetReasonPhrase(response.status);
+  head += "\r\n";
+  for (const auto& header : response.headers) {
+    head += header.first;
+    head += ": ";
+    head += header.second;
+    head += "\r\n";
+  }
+  head += "Content-Length: ";
+  head += std::to_string(GetBodySize(response));
+  head += "\r\n";
+  return head;
+}
+
+}  // namespace detail
+}  // namespace prometheus
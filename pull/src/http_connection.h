@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace prometheus {
+namespace detail {
+
+/// \brief A response to an HTTP request, independent of the server backend.
+///
+/// The Content-Length header is added by the backend when the response is
+/// written. The body segments follow the body. They are shared instead of
+/// copied, so a body assembled from cached parts is written as is, with a
+/// single vectored write where the backend supports it.
+struct HttpResponse {
+  int status = 200;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  std::vector<std::shared_ptr<const std::string>> body_segments;
+};
+
+/// \brief Get the size of the body including all of its segments.
+std::size_t GetBodySize(const HttpResponse& response);
+
+/// \brief Get the reason phrase of an HTTP status code, e.g., "OK" for 200.
+const char* GetReasonPhrase(int status);
+
+/// \brief Format the status line and the headers of a response.
+///
+/// The result ends with the Content-Length header. The backend appends its
+/// own headers, if any, and the empty line terminating the header block.
+std::string FormatResponseHead(const HttpResponse& response);
+
+/// \brief The connection of a single request as seen by the handlers.
+///
+/// Each server backend implements this for its own connection type, so the
+/// same handlers serve both civetweb and the built-in event loop.
+class HttpConnection {
+ public:
+  virtual ~HttpConnection() = default;
+
+  /// \brief Get the value of a request header, nullptr if it is absent.
+  ///
+  /// The lookup of the header name is case-insensitive.
+  virtual const char* GetHeader(const char* name) const = 0;
+
+  /// \brief Get the query string of the request target without the leading
+  /// '?', nullptr if there is none.
+  virtual const char* GetQueryString() const = 0;
+
+  /// \brief Send a complete response to the client.
+  virtual void Write(const HttpResponse& response) = 0;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -1,26 +1,205 @@
 #include "metrics_collector.h"
 
+#include <atomic>
+#include <functional>
+#include <future>
 #include <iterator>
+#include <utility>
 
+#include "detail/thread_pool.h"
 #include "prometheus/collectable.h"
+#include "prometheus/metric_filter.h"
 
 namespace prometheus {
 namespace detail {
 
-std::vector<MetricFamily> CollectMetrics(
-    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables) {
-  auto collected_metrics = std::vector<MetricFamily>{};
+namespace {
+struct Collected {
+  const Collectable* collectable;
+  std::vector<MetricFamily> metrics;
+  std::chrono::steady_clock::duration duration;
+};
+
+void Append(std::vector<MetricFamily>& collected_metrics, Collected&& collected,
+            std::vector<CollectableTiming>* timings) {
+  if (timings && !collected.metrics.empty()) {
+    timings->push_back({collected.duration, collected.collectable,
+                        collected.metrics.size()});
+  }
+  collected_metrics.insert(collected_metrics.end(),
+                           std::make_move_iterator(collected.metrics.begin()),
+                           std::make_move_iterator(collected.metrics.end()));
+}
 
+Collected Collect(const Collectable& collectable, const MetricFilter& filter) {
+  const auto start = std::chrono::steady_clock::now();
+  auto collected = Collected{};
+  collected.collectable = &collectable;
+  collected.metrics = filter.Empty() ? collectable.Collect()
+                                     : collectable.CollectMatching(filter);
+  collected.duration = std::chrono::steady_clock::now() - start;
+  return collected;
+}
+
+std::vector<std::shared_ptr<Collectable>> LockCollectables(
+    const std::vector<std::weak_ptr<Collectable>>& collectables) {
+  auto live_collectables = std::vector<std::shared_ptr<Collectable>>{};
   for (auto&& wcollectable : collectables) {
     auto collectable = wcollectable.lock();
-    if (!collectable) {
+    if (collectable) {
+      live_collectables.push_back(std::move(collectable));
+    }
+  }
+  return live_collectables;
+}
+
+// a collection is run by whoever claims it first, i.e., either a thread of
+// the pool or the scrape taking over or dropping it; the task owns its
+// collectable, so neither an exception nor a missed deadline can leave it
+// with a dangling one
+class Collection {
+ public:
+  explicit Collection(std::function<Collected()> collect)
+      : task_(std::move(collect)), result_(task_.get_future()) {}
+
+  bool Claim() { return !claimed_.test_and_set(); }
+
+  // returns false if the collection was left behind by the scrape while
+  // running
+  bool RunUnlessClaimed() {
+    if (Claim()) {
+      task_();
+    }
+    auto expected = kPending;
+    return state_.compare_exchange_strong(expected, kFinished);
+  }
+
+  // returns true if the collection is still running, i.e., is left behind
+  bool LeaveBehind() {
+    auto expected = kPending;
+    return state_.compare_exchange_strong(expected, kLeftBehind);
+  }
+
+  std::future<Collected>& Result() { return result_; }
+
+ private:
+  enum State { kPending, kFinished, kLeftBehind };
+
+  std::atomic_flag claimed_ = ATOMIC_FLAG_INIT;
+  std::atomic<State> state_{kPending};
+  std::packaged_task<Collected()> task_;
+  std::future<Collected> result_;
+};
+}  // namespace
+
+std::vector<MetricFamily> CollectMetrics(
+    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables,
+    const MetricFilter& filter, ThreadPool* pool,
+    std::vector<CollectableTiming>* timings) {
+  auto collected_metrics = std::vector<MetricFamily>{};
+  const auto live_collectables = LockCollectables(collectables);
+
+  if (!pool || live_collectables.size() < 2) {
+    for (auto&& collectable : live_collectables) {
+      Append(collected_metrics, Collect(*collectable, filter), timings);
+    }
+    return collected_metrics;
+  }
+
+  // the caller takes over all collections still queued before waiting for
+  // those running on the pool
+  const auto shared_filter = std::make_shared<const MetricFilter>(filter);
+  auto collections = std::vector<std::shared_ptr<Collection>>{};
+  for (auto it = std::next(live_collectables.begin());
+       it != live_collectables.end(); ++it) {
+    auto collectable = *it;
+    auto collection = std::make_shared<Collection>(
+        [collectable, shared_filter] {
+          return Collect(*collectable, *shared_filter);
+        });
+    collections.push_back(collection);
+    pool->Post([collection] { collection->RunUnlessClaimed(); });
+  }
+
+  Append(collected_metrics, Collect(*live_collectables.front(), filter),
+         timings);
+  for (auto& collection : collections) {
+    collection->RunUnlessClaimed();
+  }
+  for (auto& collection : collections) {
+    Append(collected_metrics, collection->Result().get(), timings);
+  }
+
+  return collected_metrics;
+}
+
+std::vector<MetricFamily> CollectMetrics(
+    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables,
+    const MetricFilter& filter, ThreadPool* pool,
+    const std::chrono::steady_clock::time_point deadline,
+    const std::shared_ptr<LateCollections>& late_collections,
+    std::size_t& skipped, std::vector<CollectableTiming>* timings) {
+  auto collected_metrics = std::vector<MetricFamily>{};
+  const auto live_collectables = LockCollectables(collectables);
+
+  if (!pool) {
+    for (auto&& collectable : live_collectables) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        ++skipped;
+        continue;
+      }
+      Append(collected_metrics, Collect(*collectable, filter), timings);
+    }
+    return collected_metrics;
+  }
+
+  // the caller never collects itself, as it could not return in time from a
+  // slow collectable
+  const auto shared_filter = std::make_shared<const MetricFilter>(filter);
+  auto collections = std::vector<std::shared_ptr<Collection>>{};
+  for (auto&& collectable : live_collectables) {
+    if (late_collections->Contains(collectable.get())) {
+      collections.push_back(nullptr);
       continue;
     }
+    auto collection =
+        std::make_shared<Collection>([collectable, shared_filter] {
+          return Collect(*collectable, *shared_filter);
+        });
+    collections.push_back(collection);
+    const auto late = late_collections;
+    const auto key = collectable.get();
+    pool->Post([collection, pool, late, key] {
+      if (!collection->RunUnlessClaimed()) {
+        late->Remove(key);
+        pool->RetireCurrentThread();
+      }
+    });
+  }
 
-    auto&& metrics = collectable->Collect();
-    collected_metrics.insert(collected_metrics.end(),
-                             std::make_move_iterator(metrics.begin()),
-                             std::make_move_iterator(metrics.end()));
+  for (std::size_t i = 0; i < collections.size(); ++i) {
+    auto& collection = collections[i];
+    if (!collection) {
+      ++skipped;
+    } else if (collection->Result().wait_until(deadline) ==
+               std::future_status::ready) {
+      Append(collected_metrics, collection->Result().get(), timings);
+    } else {
+      // dropped from the queue of the pool unless already running, a running
+      // one keeps its thread, which is replaced to serve the other scrapes;
+      // it is added before it is left behind, so that it is removed again
+      // only after being added
+      const auto key = live_collectables[i].get();
+      if (!collection->Claim()) {
+        late_collections->Add(key);
+        if (collection->LeaveBehind()) {
+          pool->AddThread();
+        } else {
+          late_collections->Remove(key);
+        }
+      }
+      ++skipped;
+    }
   }
 
   return collected_metrics;
@@ -1,14 +1,88 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "prometheus/metric_family.h"
 
 namespace prometheus {
 class Collectable;
+class MetricFilter;
 namespace detail {
+class ThreadPool;
+
+/// \brief How long the collection of a collectable took.
+///
+/// The collectable returned the given number of families, which follow those
+/// of the collectable timed before.
+struct CollectableTiming {
+  std::chrono::steady_clock::duration duration;
+  const Collectable* collectable;
+  std::size_t families;
+};
+
+/// \brief Collect the metrics of all live collectables in their order.
+///
+/// Only the families accepted by the filter are collected. Given a pool, the
+/// collectables are collected concurrently, the calling thread collects the
+/// first one while the pool works on the others. Given timings, the
+/// duration of each collectable returning metrics is appended.
+std::vector<prometheus::MetricFamily> CollectMetrics(
+    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables,
+    const MetricFilter& filter, ThreadPool* pool = nullptr,
+    std::vector<CollectableTiming>* timings = nullptr);
+
+/// \brief The collectables whose collection is still running on a pool
+/// after missing the deadline of its scrape.
+///
+/// Such a collection can't be interrupted. Its collectable is skipped by the
+/// following scrapes until it finishes, so that a hanging collectable
+/// occupies at most one thread per concurrent scrape.
+class LateCollections {
+ public:
+  bool Contains(const Collectable* collectable) const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return collectables_.count(collectable) > 0;
+  }
+
+  void Add(const Collectable* collectable) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    collectables_.insert(collectable);
+  }
+
+  void Remove(const Collectable* collectable) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto it = collectables_.find(collectable);
+    if (it != collectables_.end()) {
+      collectables_.erase(it);
+    }
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::multiset<const Collectable*> collectables_;
+};
+
+/// \brief Collect the metrics of all live collectables which finish before
+/// the deadline, in their order.
+///
+/// Only the families accepted by the filter are collected.
+///
+/// Given a pool, all collectables are collected on the pool, the calling
+/// thread returns at the deadline the latest. Without a pool, they are
+/// collected one after another and those not started by the deadline are
+/// skipped. The number of skipped collectables is added to skipped, the
+/// timings of those collected in time are appended to timings.
 std::vector<prometheus::MetricFamily> CollectMetrics(
-    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables);
+    const std::vector<std::weak_ptr<prometheus::Collectable>>& collectables,
+    const MetricFilter& filter, ThreadPool* pool,
+    std::chrono::steady_clock::time_point deadline,
+    const std::shared_ptr<LateCollections>& late_collections,
+    std::size_t& skipped, std::vector<CollectableTiming>* timings = nullptr);
 }  // namespace detail
 }  // namespace prometheus
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace prometheus {
+
+class BasicAuthHandler;
+
+namespace detail {
+
+class MetricsHandler;
+
+/// \brief The HTTP server backend of an Exposer.
+///
+/// The Exposer only talks to its backend through this interface, so the
+/// Endpoints and their handlers are shared by all backends. The handlers are
+/// owned by the caller and must outlive their registration.
+class Server {
+ public:
+  virtual ~Server() = default;
+
+  /// \brief Serve GET requests for the uri with the handler.
+  virtual void AddHandler(const std::string& uri, MetricsHandler& handler) = 0;
+
+  /// \brief Stop serving requests for the uri.
+  virtual void RemoveHandler(const std::string& uri) = 0;
+
+  /// \brief Authorize requests for the uri with the handler first.
+  ///
+  /// Replaces the previous handler of the uri, if any.
+  virtual void AddAuthHandler(const std::string& uri,
+                              BasicAuthHandler& handler) = 0;
+
+  /// \brief Stop authorizing requests for the uri.
+  virtual void RemoveAuthHandler(const std::string& uri) = 0;
+
+  virtual std::vector<int> GetListeningPorts() const = 0;
+};
+
+}  // namespace detail
+}  // namespace prometheus
@@ -2,17 +2,25 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "prometheus/collectable.h"
 #include "prometheus/counter.h"
 #include "prometheus/detail/future_std.h"
 #include "prometheus/exposer.h"
 #include "prometheus/family.h"
+#include "prometheus/metric_family.h"
 #include "prometheus/registry.h"
 
 namespace prometheus {
@@ -20,16 +28,84 @@ namespace {
 
 using namespace testing;
 
-class IntegrationTest : public testing::Test {
+// waits in Collect() until the given number of collectables are collected at
+// once, reports in the name of its family whether they ever were
+class RendezvousCollectable : public Collectable {
+ public:
+  struct Rendezvous {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::size_t arrivals = 0;
+    std::size_t expected;
+  };
+
+  RendezvousCollectable(std::string name,
+                        std::shared_ptr<Rendezvous> rendezvous)
+      : name_(std::move(name)), rendezvous_(std::move(rendezvous)) {}
+
+  std::vector<MetricFamily> Collect() const override {
+    auto& rendezvous = *rendezvous_;
+    std::unique_lock<std::mutex> lock{rendezvous.mutex};
+    ++rendezvous.arrivals;
+    rendezvous.arrived.notify_all();
+    const auto met = rendezvous.arrived.wait_for(
+        lock, std::chrono::seconds{2},
+        [&] { return rendezvous.arrivals >= rendezvous.expected; });
+
+    auto family = MetricFamily{};
+    family.name = name_ + (met ? "_concurrent" : "_alone");
+    family.type = MetricType::Untyped;
+    family.metric.emplace_back();
+    return {family};
+  }
+
+ private:
+  const std::string name_;
+  const std::shared_ptr<Rendezvous> rendezvous_;
+};
+
+// blocks in Collect() until released
+class BlockingCollectable : public Collectable {
+ public:
+  std::vector<MetricFamily> Collect() const override {
+    std::unique_lock<std::mutex> lock{mutex_};
+    ++collections_;
+    released_.wait_for(lock, std::chrono::seconds{5},
+                       [this] { return release_; });
+    return {};
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      release_ = true;
+    }
+    released_.notify_all();
+  }
+
+  int Collections() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return collections_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  mutable std::condition_variable released_;
+  mutable int collections_ = 0;
+  bool release_ = false;
+};
+
+class IntegrationTest : public testing::TestWithParam<Exposer::Backend> {
  public:
   void SetUp() override {
-    exposer_ = detail::make_unique<Exposer>("127.0.0.1:0");
+    exposer_ = detail::make_unique<Exposer>("127.0.0.1:0", 2, GetParam());
     auto ports = exposer_->GetListeningPorts();
     base_url_ = std::string("http://127.0.0.1:") + std::to_string(ports.at(0));
   }
 
   struct Response {
     long code = 0;
+    std::string headers;
     std::string body;
     std::string contentType;
   };
@@ -48,6 +124,8 @@ class IntegrationTest : public testing::Test {
     curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response.body);
     curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &response.headers);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, WriteCallback);
 
     if (fetchPrePerform_) {
       fetchPrePerform_(curl.get());
@@ -96,13 +174,13 @@ class IntegrationTest : public testing::Test {
   }
 };
 
-TEST_F(IntegrationTest, doesNotExposeAnythingOnDefaultPath) {
+TEST_P(IntegrationTest, doesNotExposeAnythingOnDefaultPath) {
   const auto metrics = FetchMetrics(default_metrics_path_);
 
   EXPECT_GE(metrics.code, 400);
 }
 
-TEST_F(IntegrationTest, exposeSingleCounter) {
+TEST_P(IntegrationTest, exposeSingleCounter) {
   const std::string counter_name = "example_total";
   auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
 
@@ -112,7 +190,7 @@ TEST_F(IntegrationTest, exposeSingleCounter) {
   EXPECT_THAT(metrics.body, HasSubstr(counter_name));
 }
 
-TEST_F(IntegrationTest, exposesCountersOnDifferentUrls) {
+TEST_P(IntegrationTest, exposesCountersOnDifferentUrls) {
   const std::string first_metrics_path = "/first";
   const std::string second_metrics_path = "/second";
 
@@ -141,7 +219,7 @@ TEST_F(IntegrationTest, exposesCountersOnDifferentUrls) {
   EXPECT_THAT(second_metrics.body, Not(HasSubstr(first_counter_name)));
 }
 
-TEST_F(IntegrationTest, unexposeRegistry) {
+TEST_P(IntegrationTest, unexposeRegistry) {
   const std::string counter_name = "some_counter_total";
   const auto registry =
       RegisterSomeCounter(counter_name, default_metrics_path_);
@@ -153,7 +231,7 @@ TEST_F(IntegrationTest, unexposeRegistry) {
   EXPECT_THAT(metrics.body, Not(HasSubstr(counter_name)));
 }
 
-TEST_F(IntegrationTest, acceptOptionalCompression) {
+TEST_P(IntegrationTest, acceptOptionalCompression) {
   const std::string counter_name = "example_total";
   auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
 
@@ -167,7 +245,7 @@ TEST_F(IntegrationTest, acceptOptionalCompression) {
 }
 
 #if 0  // https://github.com/civetweb/civetweb/issues/954
-TEST_F(IntegrationTest, shouldRejectRequestWithoutAuthorization) {
+TEST_P(IntegrationTest, shouldRejectRequestWithoutAuthorization) {
   const std::string counter_name = "example_total";
   auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
 
@@ -183,7 +261,7 @@ TEST_F(IntegrationTest, shouldRejectRequestWithoutAuthorization) {
 }
 #endif
 
-TEST_F(IntegrationTest, shouldPerformProperAuthentication) {
+TEST_P(IntegrationTest, shouldPerformProperAuthentication) {
   const std::string counter_name = "example_total";
   auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
 
@@ -209,7 +287,7 @@ TEST_F(IntegrationTest, shouldPerformProperAuthentication) {
   EXPECT_THAT(metrics.body, HasSubstr(counter_name));
 }
 
-TEST_F(IntegrationTest, shouldDealWithExpiredCollectables) {
+TEST_P(IntegrationTest, shouldDealWithExpiredCollectables) {
   const std::string first_counter_name = "first_total";
   const std::string second_counter_name = "second_total";
 
@@ -232,7 +310,7 @@ TEST_F(IntegrationTest, shouldDealWithExpiredCollectables) {
   EXPECT_THAT(metrics.body, Not(HasSubstr(second_counter_name)));
 }
 
-TEST_F(IntegrationTest, shouldSendBodyAsUtf8) {
+TEST_P(IntegrationTest, shouldSendBodyAsUtf8) {
   const std::string counter_name = "example_total";
   auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
 
@@ -244,5 +322,295 @@ TEST_F(IntegrationTest, shouldSendBodyAsUtf8) {
   EXPECT_THAT(metrics.contentType, HasSubstr("utf-8"));
 }
 
+TEST_P(IntegrationTest, collectsCollectablesConcurrently) {
+  exposer_->SetCollectionParallelism(3);
+
+  auto rendezvous = std::make_shared<RendezvousCollectable::Rendezvous>();
+  rendezvous->expected = 3;
+  std::vector<std::shared_ptr<Collectable>> collectables;
+  for (const auto name : {"first", "second", "third"}) {
+    collectables.push_back(
+        std::make_shared<RendezvousCollectable>(name, rendezvous));
+    exposer_->RegisterCollectable(collectables.back());
+  }
+
+  const auto metrics = FetchMetrics(default_metrics_path_);
+
+  ASSERT_EQ(metrics.code, 200);
+  const auto first = metrics.body.find("first_concurrent");
+  const auto second = metrics.body.find("second_concurrent");
+  const auto third = metrics.body.find("third_concurrent");
+  ASSERT_NE(first, std::string::npos);
+  ASSERT_NE(second, std::string::npos);
+  ASSERT_NE(third, std::string::npos);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, third);
+}
+
+TEST_P(IntegrationTest, skipsCollectablesMissingScrapeTimeout) {
+  exposer_->SetCollectionParallelism(2);
+  exposer_->SetScrapeTimeout(std::chrono::milliseconds{200});
+
+  const std::string counter_name = "example_total";
+  auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
+  auto blocking = std::make_shared<BlockingCollectable>();
+  exposer_->RegisterCollectable(blocking);
+
+  // the second scrape skips the collectable, which is still collected for
+  // the first one, instead of collecting it again
+  for (int scrape = 0; scrape < 2; ++scrape) {
+    const auto metrics = FetchMetrics(default_metrics_path_);
+
+    ASSERT_EQ(metrics.code, 200);
+    EXPECT_THAT(metrics.body, HasSubstr(counter_name));
+    EXPECT_THAT(metrics.body,
+                HasSubstr("\nexposer_scrape_skipped_collectables 1\n"));
+  }
+  EXPECT_EQ(blocking->Collections(), 1);
+
+  blocking->Release();
+}
+
+TEST_P(IntegrationTest, honorsScrapeTimeoutOfPrometheus) {
+  exposer_->SetCollectionParallelism(2);
+
+  const std::string counter_name = "example_total";
+  auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
+  auto blocking = std::make_shared<BlockingCollectable>();
+  exposer_->RegisterCollectable(blocking);
+
+  auto headers = std::shared_ptr<curl_slist>(
+      curl_slist_append(nullptr, "X-Prometheus-Scrape-Timeout-Seconds: 0.2"),
+      curl_slist_free_all);
+  fetchPrePerform_ = [headers](CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
+  };
+  const auto metrics = FetchMetrics(default_metrics_path_);
+  blocking->Release();
+
+  ASSERT_EQ(metrics.code, 200);
+  EXPECT_THAT(metrics.body, HasSubstr(counter_name));
+  EXPECT_THAT(metrics.body,
+              HasSubstr("\nexposer_scrape_skipped_collectables 1\n"));
+}
+
+TEST_P(IntegrationTest, servesConcurrentScrapesInParallel) {
+  auto rendezvous = std::make_shared<RendezvousCollectable::Rendezvous>();
+  rendezvous->expected = 2;
+  auto collectable =
+      std::make_shared<RendezvousCollectable>("scraped", rendezvous);
+  exposer_->RegisterCollectable(collectable);
+
+  auto first = std::async(std::launch::async, [this] {
+    return FetchMetrics(default_metrics_path_);
+  });
+  {
+    // the first scrape occupies its server thread before the second starts
+    std::unique_lock<std::mutex> lock{rendezvous->mutex};
+    rendezvous->arrived.wait_for(lock, std::chrono::seconds{5},
+                                 [&] { return rendezvous->arrivals > 0; });
+  }
+  const auto second = FetchMetrics(default_metrics_path_);
+
+  EXPECT_THAT(first.get().body, HasSubstr("scraped_concurrent"));
+  EXPECT_THAT(second.body, HasSubstr("scraped_concurrent"));
+}
+
+TEST_P(IntegrationTest, registersCollectablesDuringScrape) {
+  auto blocking = std::make_shared<BlockingCollectable>();
+  exposer_->RegisterCollectable(blocking);
+
+  auto scrape = std::async(std::launch::async, [this] {
+    return FetchMetrics(default_metrics_path_);
+  });
+  while (blocking->Collections() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+
+  const std::string counter_name = "example_total";
+  auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
+  exposer_->RemoveCollectable(blocking);
+  EXPECT_EQ(scrape.wait_for(std::chrono::seconds{0}),
+            std::future_status::timeout);
+
+  blocking->Release();
+  EXPECT_EQ(scrape.get().code, 200);
+  EXPECT_THAT(FetchMetrics(default_metrics_path_).body,
+              HasSubstr(counter_name));
+}
+
+TEST_P(IntegrationTest, servesPrerenderedBody) {
+  auto registry = std::make_shared<Registry>();
+  auto& counter =
+      BuildCounter().Name("example_total").Register(*registry).Add({});
+  exposer_->RegisterCollectable(registry);
+  exposer_->SetPrerenderInterval(std::chrono::hours{1});
+
+  auto metrics = FetchMetrics(default_metrics_path_);
+  for (int i = 0; i < 500 && metrics.headers.find("Age: ") == std::string::npos;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    metrics = FetchMetrics(default_metrics_path_);
+  }
+  ASSERT_THAT(metrics.headers, HasSubstr("Age: 0"));
+  ASSERT_THAT(metrics.body, HasSubstr("example_total 0"));
+
+  // the body rendered before is served until the next interval, unless a
+  // subset of the metrics is requested
+  counter.Increment();
+  EXPECT_THAT(FetchMetrics(default_metrics_path_).body,
+              HasSubstr("example_total 0"));
+  const auto filtered =
+      FetchMetrics(default_metrics_path_ + "?name[]=example_total");
+  EXPECT_THAT(filtered.headers, Not(HasSubstr("Age: ")));
+  EXPECT_THAT(filtered.body, HasSubstr("example_total 1"));
+
+  exposer_->SetPrerenderInterval(std::chrono::milliseconds::zero());
+  EXPECT_THAT(FetchMetrics(default_metrics_path_).body,
+              HasSubstr("example_total 1"));
+}
+
+TEST_P(IntegrationTest, exposesScrapeInstrumentation) {
+  const std::string counter_name = "example_total";
+  auto registry = RegisterSomeCounter(counter_name, default_metrics_path_);
+
+  FetchMetrics(default_metrics_path_);
+  const auto metrics = FetchMetrics(default_metrics_path_);
+
+  ASSERT_EQ(metrics.code, 200);
+  for (const auto phase : {"collect", "serialize", "write"}) {
+    EXPECT_THAT(metrics.body,
+                HasSubstr(std::string{"exposer_scrape_phase_duration_seconds_"
+                                      "count{phase=\""} +
+                          phase + "\"} 1\n"));
+  }
+  EXPECT_THAT(metrics.body, HasSubstr("\nexposer_uncompressed_bytes_total "));
+  EXPECT_THAT(metrics.body, HasSubstr("\nexposer_scrape_series "));
+  // the registry of the endpoint itself is registered first
+  EXPECT_THAT(metrics.body,
+              HasSubstr("exposer_collectable_duration_seconds{collectable="
+                        "\"0\"}"));
+  EXPECT_THAT(metrics.body,
+              HasSubstr("exposer_collectable_duration_seconds{collectable="
+                        "\"1\"}"));
+}
+
+TEST_P(IntegrationTest, timesCollectablesOfSameFamilyNameApart) {
+  auto first = RegisterSomeCounter("example_total", default_metrics_path_);
+  auto second = RegisterSomeCounter("example_total", default_metrics_path_);
+
+  FetchMetrics(default_metrics_path_);
+  auto metrics = FetchMetrics(default_metrics_path_);
+
+  ASSERT_EQ(metrics.code, 200);
+  for (const auto id : {"0", "1", "2"}) {
+    EXPECT_THAT(metrics.body,
+                HasSubstr(std::string{"exposer_collectable_duration_seconds{"
+                                      "collectable=\""} +
+                          id + "\"}"));
+  }
+
+  // the label stays with the registration, not the families returned
+  exposer_->RemoveCollectable(first, default_metrics_path_);
+  FetchMetrics(default_metrics_path_);
+  metrics = FetchMetrics(default_metrics_path_);
+
+  EXPECT_THAT(metrics.body,
+              Not(HasSubstr("exposer_collectable_duration_seconds{"
+                            "collectable=\"1\"}")));
+  EXPECT_THAT(metrics.body,
+              HasSubstr("exposer_collectable_duration_seconds{"
+                        "collectable=\"2\"}"));
+}
+
+TEST_P(IntegrationTest, exposesOnlyRequestedMetrics) {
+  auto registry = std::make_shared<Registry>();
+  for (const auto name :
+       {"http_requests_total", "http_errors_total", "jobs_total"}) {
+    BuildCounter().Name(name).Register(*registry).Add({});
+  }
+  exposer_->RegisterCollectable(registry);
+
+  const auto by_name =
+      FetchMetrics(default_metrics_path_ + "?name[]=jobs_total");
+  ASSERT_EQ(by_name.code, 200);
+  EXPECT_THAT(by_name.body, HasSubstr("jobs_total"));
+  EXPECT_THAT(by_name.body, Not(HasSubstr("http_")));
+  EXPECT_THAT(by_name.body, Not(HasSubstr("exposer_")));
+
+  // match[]={__name__=~"http_.*"}
+  const auto by_selector = FetchMetrics(
+      default_metrics_path_ + "?match[]=%7B__name__%3D~%22http_.*%22%7D");
+  ASSERT_EQ(by_selector.code, 200);
+  EXPECT_THAT(by_selector.body, HasSubstr("http_requests_total"));
+  EXPECT_THAT(by_selector.body, HasSubstr("http_errors_total"));
+  EXPECT_THAT(by_selector.body, Not(HasSubstr("jobs_total")));
+}
+
+TEST_P(IntegrationTest, rejectsUnsupportedSelector) {
+  auto registry = RegisterSomeCounter("up", default_metrics_path_);
+
+  // match[]=up{job="x"}
+  const auto metrics =
+      FetchMetrics(default_metrics_path_ + "?match[]=up%7Bjob%3D%22x%22%7D");
+
+  EXPECT_EQ(metrics.code, 400);
+}
+
+TEST_P(IntegrationTest, rejectsBacktrackingPattern) {
+  auto registry = RegisterSomeCounter("up", default_metrics_path_);
+
+  // match[]={__name__=~"(a+)+b"}
+  const auto pathological = FetchMetrics(
+      default_metrics_path_ + "?match[]=%7B__name__%3D~%22(a%2B)%2Bb%22%7D");
+  EXPECT_EQ(pathological.code, 400);
+
+  const auto oversized =
+      FetchMetrics(default_metrics_path_ + "?match[]=%7B__name__%3D~%22" +
+                   std::string(2000, 'a') + "%22%7D");
+  EXPECT_EQ(oversized.code, 400);
+}
+
+TEST_P(IntegrationTest, exposesChangedFamiliesOnly) {
+  auto registry = std::make_shared<Registry>();
+  auto& changing =
+      BuildCounter().Name("changing_total").Register(*registry).Add({});
+  auto& removed_family =
+      BuildCounter().Name("removed_total").Register(*registry);
+  removed_family.Add({});
+  BuildCounter().Name("unchanged_total").Register(*registry).Add({});
+  exposer_->RegisterCollectable(registry);
+  // a family of the same name in another collectable is cached on its own
+  auto other_registry = std::make_shared<Registry>();
+  auto& other_changing =
+      BuildCounter().Name("changing_total").Register(*other_registry).Add({});
+  other_changing.Increment(5);
+  exposer_->RegisterCollectable(other_registry);
+  exposer_->SetRenderedFamilyCache(true);
+
+  const auto first = FetchMetrics(default_metrics_path_);
+  ASSERT_EQ(first.code, 200);
+  EXPECT_THAT(first.body, HasSubstr("\nchanging_total 0\n"));
+  EXPECT_THAT(first.body, HasSubstr("\nchanging_total 5\n"));
+  EXPECT_THAT(first.body, HasSubstr("\nremoved_total 0\n"));
+
+  // the families rendered before are reused, also when compressed
+  changing.Increment();
+  registry->Remove(removed_family);
+  fetchPrePerform_ = [](CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "gzip");
+  };
+  const auto second = FetchMetrics(default_metrics_path_);
+  ASSERT_EQ(second.code, 200);
+  EXPECT_THAT(second.body, HasSubstr("\nchanging_total 1\n"));
+  EXPECT_THAT(second.body, HasSubstr("\nchanging_total 5\n"));
+  EXPECT_THAT(second.body, HasSubstr("\nunchanged_total 0\n"));
+  EXPECT_THAT(second.body, Not(HasSubstr("removed_total")));
+}
+
+INSTANTIATE_TEST_SUITE_P(AllBackends, IntegrationTest,
+                         testing::Values(Exposer::Backend::kCivetweb,
+                                         Exposer::Backend::kEventLoop));
+
 }  // namespace
 }  // namespace prometheus
@@ -0,0 +1,103 @@
+#include "detail/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prometheus {
+namespace {
+
+TEST(ThreadPoolTest, runsPostedTasks) {
+  std::atomic<int> runs{0};
+  {
+    detail::ThreadPool pool{2};
+    EXPECT_EQ(pool.ThreadCount(), 2u);
+    for (int i = 0; i < 100; ++i) {
+      pool.Post([&runs] { ++runs; });
+    }
+  }
+  EXPECT_EQ(runs, 100);
+}
+
+TEST(ThreadPoolTest, runsTasksConcurrently) {
+  const std::size_t threads = 3;
+  std::mutex mutex;
+  std::condition_variable arrived;
+  std::size_t arrivals = 0;
+  std::atomic<std::size_t> met{0};
+
+  {
+    detail::ThreadPool pool{threads};
+    for (std::size_t i = 0; i < threads; ++i) {
+      pool.Post([&] {
+        std::unique_lock<std::mutex> lock{mutex};
+        ++arrivals;
+        arrived.notify_all();
+        if (arrived.wait_for(lock, std::chrono::seconds{5},
+                             [&] { return arrivals == threads; })) {
+          ++met;
+        }
+      });
+    }
+  }
+  EXPECT_EQ(met, threads);
+}
+
+TEST(ThreadPoolTest, runsTasksInOrderOnSingleThread) {
+  std::vector<int> order;
+  {
+    detail::ThreadPool pool{1};
+    for (int i = 0; i < 10; ++i) {
+      pool.Post([&order, i] { order.push_back(i); });
+    }
+  }
+  ASSERT_EQ(order.size(), 10u);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST(ThreadPoolTest, replacesThreadLeftBehind) {
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  std::atomic<int> runs{0};
+
+  detail::ThreadPool pool{1};
+  pool.Post([&] {
+    std::unique_lock<std::mutex> lock{mutex};
+    released.wait_for(lock, std::chrono::seconds{5}, [&] { return release; });
+    pool.RetireCurrentThread();
+  });
+  pool.AddThread();
+  EXPECT_EQ(pool.ThreadCount(), 2u);
+
+  std::promise<void> done;
+  pool.Post([&] {
+    ++runs;
+    done.set_value();
+  });
+  EXPECT_EQ(done.get_future().wait_for(std::chrono::seconds{5}),
+            std::future_status::ready);
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    release = true;
+  }
+  released.notify_all();
+  for (int i = 0; i < 500 && pool.ThreadCount() > 1; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_EQ(pool.ThreadCount(), 1u);
+  EXPECT_EQ(runs, 1);
+}
+
+}  // namespace
+}  // namespace prometheus
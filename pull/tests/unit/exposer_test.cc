@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <stdexcept>
+
 namespace prometheus {
 namespace {
 
@@ -21,5 +23,35 @@ TEST(ExposerTest, listenOnDistinctPorts) {
   EXPECT_NE(firstExposerPorts, secondExposerPorts);
 }
 
+TEST(ExposerTest, civetwebRejectsUnixDomainSocket) {
+  EXPECT_THROW(Exposer{"unix:/tmp/metrics.sock"}, std::invalid_argument);
+}
+
+#ifdef __linux__
+TEST(ExposerTest, eventLoopListensOnDistinctPorts) {
+  Exposer firstExposer{"127.0.0.1:0", 1, Exposer::Backend::kEventLoop};
+  auto firstExposerPorts = firstExposer.GetListeningPorts();
+  ASSERT_EQ(1u, firstExposerPorts.size());
+  EXPECT_NE(0, firstExposerPorts.front());
+
+  Exposer secondExposer{"127.0.0.1:0,127.0.0.1:0", 2,
+                        Exposer::Backend::kEventLoop};
+  auto secondExposerPorts = secondExposer.GetListeningPorts();
+  ASSERT_EQ(2u, secondExposerPorts.size());
+  EXPECT_NE(firstExposerPorts.front(), secondExposerPorts.front());
+}
+
+TEST(ExposerTest, eventLoopRejectsInvalidBindAddress) {
+  EXPECT_THROW((Exposer{"127.0.0.1:http", 1, Exposer::Backend::kEventLoop}),
+               std::runtime_error);
+  EXPECT_THROW((Exposer{"[::1:0", 1, Exposer::Backend::kEventLoop}),
+               std::runtime_error);
+  EXPECT_THROW((Exposer{"127.0.0.1:0,", 1, Exposer::Backend::kEventLoop}),
+               std::runtime_error);
+  EXPECT_THROW((Exposer{"unix:", 1, Exposer::Backend::kEventLoop}),
+               std::runtime_error);
+}
+#endif
+
 }  // namespace
 }  // namespace prometheus